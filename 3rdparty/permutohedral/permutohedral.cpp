@@ -25,14 +25,32 @@
     SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "permutohedral.h"
-#include <unordered_map>
 #include "macroses.h"
 
+namespace {
+	// Default (serial and scalar) backend
+	void serialFor(int n, const std::function<void(int, int)> &body) { body(0, n); }
+	void scalarAxpy(float a, const float *v, float *dst, int n, float b) { for (int x = 0; x < n; x++) dst[x] += a * v[x] * b; }
+	void scalarBlur(const float *v, const float *n1, const float *n2, float *dst, int n) { for (int x = 0; x < n; x++) dst[x] = v[x] + 0.5f * (n1[x] + n2[x]); }
+}
+
+// Constructor
+CPermutohedral::CPermutohedral(void)
+	: m_parallelFor(serialFor)
+	, m_axpy(scalarAxpy)
+	, m_blur(scalarBlur)
+{}
+
 // Copy constructor
 CPermutohedral::CPermutohedral(const CPermutohedral &rhs)
     : m_nFeatures(rhs.m_nFeatures)
 	, m_M(rhs.m_M)
 	, m_featureSize(rhs.m_featureSize)
+	, m_splatBegin(rhs.m_splatBegin)
+	, m_splatIdx(rhs.m_splatIdx)
+	, m_parallelFor(rhs.m_parallelFor)
+	, m_axpy(rhs.m_axpy)
+	, m_blur(rhs.m_blur)
 {
 	if (!rhs.m_offset.empty()) rhs.m_offset.copyTo(m_offset); 
 	if (!rhs.m_barycentric.empty()) rhs.m_barycentric.copyTo(m_barycentric);
@@ -53,63 +71,112 @@ CPermutohedral & CPermutohedral::operator= (const CPermutohedral &rhs)
 	m_barycentric	= rhs.m_barycentric.empty()		? Mat() : rhs.m_barycentric.clone();
 	m_blurNeighbor1 = rhs.m_blurNeighbor1.empty()	? Mat() : rhs.m_blurNeighbor1.clone();
 	m_blurNeighbor2 = rhs.m_blurNeighbor2.empty()	? Mat() : rhs.m_blurNeighbor2.clone();
+	m_splatBegin	= rhs.m_splatBegin;
+	m_splatIdx		= rhs.m_splatIdx;
+	m_parallelFor	= rhs.m_parallelFor;
+	m_axpy			= rhs.m_axpy;
+	m_blur			= rhs.m_blur;
 
 	return *this;
 }
 
-struct Key {
-	Mat mat;
+void CPermutohedral::setBackend(const parallel_for_t &parallelFor, axpy_t axpy, blur_t blur)
+{
+	m_parallelFor	= parallelFor ? parallelFor : serialFor;
+	m_axpy			= axpy ? axpy : scalarAxpy;
+	m_blur			= blur ? blur : scalarBlur;
+}
 
-	bool operator==(const Key& other) const {
-		if (mat.size() != other.mat.size()) return false;
-		if (mat.type() != other.mat.type()) return false;
+namespace {
+	// Hash table with open addressing (linear probing), which stores the keys of the lattice points contiguously
+	class CHashTable
+	{
+	public:
+		CHashTable(int keySize, size_t capacity) : m_keySize(keySize)
+		{
+			size_t tableSize = 64;
+			while (tableSize < 2 * capacity) tableSize <<= 1;
+			m_table.assign(tableSize, -1);
+			m_keys.reserve(capacity * keySize);
+		}
 
-		for (int y = 0; y < mat.rows; y++) {
-			const short* pMat = mat.ptr<short>(y);
-			const short* pMatOther = other.mat.ptr<short>(y);
-			for (int x = 0; x < mat.cols; x++)
-				if (pMat[x] != pMatOther[x]) return false;
+		int size(void) const { return static_cast<int>(m_keys.size() / m_keySize); }
+		const short * getKey(int i) const { return m_keys.data() + static_cast<size_t>(i) * m_keySize; }
+
+		// Returns the index of the key or -1 if the key is not in the table
+		int find(const short *key) const
+		{
+			const size_t mask = m_table.size() - 1;
+			for (size_t h = hash(key) & mask; ; h = (h + 1) & mask) {
+				int i = m_table[h];
+				if (i < 0 || std::equal(key, key + m_keySize, getKey(i))) return i;
+			}
 		}
-		return true;
-	}
-};
 
-struct hashFunc
-{
-	std::size_t operator()(const Key &key) const
-	{
-		std::size_t res = 0;
-		const short* ptr = key.mat.ptr<short>(0);
-		for (int i = 0; i < key.mat.cols; i++) {
-			res += static_cast<size_t>(ptr[i]);
-			res *= 1664525;
+		// Returns the index of the key, adding the key to the table if needed
+		int insert(const short *key)
+		{
+			if (2 * static_cast<size_t>(size() + 1) > m_table.size()) grow();
+			const size_t mask = m_table.size() - 1;
+			for (size_t h = hash(key) & mask; ; h = (h + 1) & mask) {
+				int i = m_table[h];
+				if (i < 0) {
+					i = size();
+					m_keys.insert(m_keys.end(), key, key + m_keySize);
+					m_table[h] = i;
+					return i;
+				}
+				if (std::equal(key, key + m_keySize, getKey(i))) return i;
+			}
 		}
-		return res;
-	}
-};
+
+
+	private:
+		size_t hash(const short *key) const
+		{
+			size_t res = 0;
+			for (int i = 0; i < m_keySize; i++) {
+				res += static_cast<size_t>(key[i]);
+				res *= 1664525;
+			}
+			return res ^ (res >> 16);
+		}
+
+		void grow(void)
+		{
+			m_table.assign(2 * m_table.size(), -1);
+			const size_t mask = m_table.size() - 1;
+			for (int i = 0; i < size(); i++) {
+				size_t h = hash(getKey(i)) & mask;
+				while (m_table[h] >= 0) h = (h + 1) & mask;
+				m_table[h] = i;
+			}
+		}
+
+
+	private:
+		int					m_keySize;
+		std::vector<int>	m_table;		// Indices of the keys or -1 for the empty slots
+		std::vector<short>	m_keys;			// The keys in the order of insertion
+	};
+}
 
 void CPermutohedral::init(const Mat &features)
 {
 	// Compute the lattice coordinates for each feature [there is going to be a lot of magic here
     m_nFeatures = features.rows;
     m_featureSize = features.cols;
-	std::unordered_map<Key, int, hashFunc> hash_table;
-	hash_table.reserve(m_nFeatures * (m_featureSize + 1));
-	Mat allKeys;
 
     // Allocate the class memory
 	m_offset		= Mat(m_nFeatures, m_featureSize + 1, CV_32SC1); 
     m_barycentric	= Mat(m_nFeatures, m_featureSize + 1, CV_32FC1);
 
-    
+	// Keys of the d + 1 vertices of the simplex of every feature
+	std::vector<short> vKeys(static_cast<size_t>(m_nFeatures) * (m_featureSize + 1) * m_featureSize);
+
     // Allocate the local memory
     vec_float_t scale_factor(m_featureSize);
-    vec_float_t elevated(m_featureSize + 1);
-    vec_float_t rem0(m_featureSize + 1);
-    vec_float_t barycentric(m_featureSize + 2);
-    std::vector<short> rank(m_featureSize + 1);
     std::vector<short> canonical((m_featureSize + 1) * (m_featureSize + 1));
-	Mat key(1, m_featureSize + 1, CV_16SC1);
     
     // Compute the canonical simplex
     for(int i = 0; i <= m_featureSize; i++) {
@@ -125,172 +192,202 @@ void CPermutohedral::init(const Mat &features)
     for(int i = 0; i < m_featureSize; i++)
         scale_factor[i] = 1.f / sqrtf((i + 2.f) * (i + 1.f)) * inv_std_dev;
     
-    // Compute the simplex each feature lies in
-    for(int k = 0; k < m_nFeatures; k++) {
-        // Elevate the feature ( y = Ep, see p.5 in [Adams etal 2010])
-        const float *f = features.ptr<float>(k);
+    // Compute the simplex each feature lies in (independently for every feature)
+	m_parallelFor(m_nFeatures, [&](int begin, int end) {
+		vec_float_t elevated(m_featureSize + 1);
+		vec_float_t rem0(m_featureSize + 1);
+		vec_float_t barycentric(m_featureSize + 2);
+		std::vector<short> rank(m_featureSize + 1);
+
+		for (int k = begin; k < end; k++) {
+			// Elevate the feature ( y = Ep, see p.5 in [Adams etal 2010])
+			const float *f = features.ptr<float>(k);
         
-        // sm contains the sum of 1..n of our faeture vector
-        float sm = 0;
-        for(int j = m_featureSize; j > 0; j--){
-            float cf = f[j-1]*scale_factor[j-1];
-            elevated[j] = sm - j*cf;
-            sm += cf;
-        }
-        elevated[0] = sm;
+			// sm contains the sum of 1..n of our faeture vector
+			float sm = 0;
+			for(int j = m_featureSize; j > 0; j--){
+				float cf = f[j-1]*scale_factor[j-1];
+				elevated[j] = sm - j*cf;
+				sm += cf;
+			}
+			elevated[0] = sm;
         
-        // Find the closest 0-colored simplex through rounding
-        float down_factor = 1.0f / (m_featureSize + 1);
-        float up_factor = static_cast<float>(m_featureSize + 1);
-        int sum = 0;
-        for(int i = 0; i <= m_featureSize; i++) {
-            int rd = static_cast<int>(round( down_factor * elevated[i]));
-            rem0[i] = rd*up_factor;
-            sum += rd;
-        }
+			// Find the closest 0-colored simplex through rounding
+			float down_factor = 1.0f / (m_featureSize + 1);
+			float up_factor = static_cast<float>(m_featureSize + 1);
+			int sum = 0;
+			for(int i = 0; i <= m_featureSize; i++) {
+				int rd = static_cast<int>(round( down_factor * elevated[i]));
+				rem0[i] = rd*up_factor;
+				sum += rd;
+			}
         
-        // Find the simplex we are in and store it in rank (where rank describes what position coorinate i has in the sorted order of the features values)
-        for(int i = 0; i <= m_featureSize; i++)
-            rank[i] = 0;
-        for(int i = 0; i < m_featureSize; i++) {
-            double di = elevated[i] - rem0[i];
-            for(int j = i + 1; j <= m_featureSize; j++)
-                if (di < elevated[j] - rem0[j])    rank[i]++;
-                else                            rank[j]++;
-        }
+			// Find the simplex we are in and store it in rank (where rank describes what position coorinate i has in the sorted order of the features values)
+			for(int i = 0; i <= m_featureSize; i++)
+				rank[i] = 0;
+			for(int i = 0; i < m_featureSize; i++) {
+				double di = elevated[i] - rem0[i];
+				for(int j = i + 1; j <= m_featureSize; j++)
+					if (di < elevated[j] - rem0[j])    rank[i]++;
+					else                            rank[j]++;
+			}
         
-        // If the point doesn't lie on the plane (sum != 0) bring it back
-        for(int i = 0; i <= m_featureSize; i++) {
-            rank[i] += sum;
-            if ( rank[i] < 0 ){
-                rank[i] += m_featureSize + 1;
-                rem0[i] += m_featureSize + 1;
-            }
-            else if (rank[i] > m_featureSize) {
-                rank[i] -= m_featureSize + 1;
-                rem0[i] -= m_featureSize + 1;
-            }
-        }
+			// If the point doesn't lie on the plane (sum != 0) bring it back
+			for(int i = 0; i <= m_featureSize; i++) {
+				rank[i] += sum;
+				if ( rank[i] < 0 ){
+					rank[i] += m_featureSize + 1;
+					rem0[i] += m_featureSize + 1;
+				}
+				else if (rank[i] > m_featureSize) {
+					rank[i] -= m_featureSize + 1;
+					rem0[i] -= m_featureSize + 1;
+				}
+			}
         
-        // Compute the barycentric coordinates (p.10 in [Adams etal 2010])
-        for(int i = 0; i <= m_featureSize + 1; i++)
-            barycentric[i] = 0;
-        for(int i = 0; i <= m_featureSize; i++) {
-            float v = (elevated[i] - rem0[i])*down_factor;
-            barycentric[m_featureSize - rank[i]  ] += v;
-            barycentric[m_featureSize - rank[i] + 1] -= v;
-        }
-        // Wrap around
-        barycentric[0] += 1.0f + barycentric[m_featureSize + 1];
+			// Compute the barycentric coordinates (p.10 in [Adams etal 2010])
+			for(int i = 0; i <= m_featureSize + 1; i++)
+				barycentric[i] = 0;
+			for(int i = 0; i <= m_featureSize; i++) {
+				float v = (elevated[i] - rem0[i])*down_factor;
+				barycentric[m_featureSize - rank[i]  ] += v;
+				barycentric[m_featureSize - rank[i] + 1] -= v;
+			}
+			// Wrap around
+			barycentric[0] += 1.0f + barycentric[m_featureSize + 1];
         
-        // Compute all vertices and their offset
-		int		*pOffset		= m_offset.ptr<int>(k);
-		float	*pBarycentric	= m_barycentric.ptr<float>(k);
-		for(int remainder = 0; remainder <= m_featureSize; remainder++) {
-            for(int i = 0; i < m_featureSize; i++)
-                key.at<short>(0, i) = static_cast<short>(rem0[i] + canonical[ remainder * (m_featureSize + 1) + rank[i]]);		// TODO
-			
-			auto it = hash_table.find({ key(Rect(0, 0, m_featureSize, 1)) });
-			int val = it == hash_table.end() ? -1 : it->second;
-			if (val == -1) {
-				val = static_cast<int>(hash_table.size());
-				hash_table[{ key(Rect(0, 0, m_featureSize, 1)).clone() }] = val;
-				allKeys.push_back(key(Rect(0, 0, m_featureSize, 1)));
+			// Compute all vertices
+			float	*pBarycentric	= m_barycentric.ptr<float>(k);
+			short	*pKey			= vKeys.data() + static_cast<size_t>(k) * (m_featureSize + 1) * m_featureSize;
+			for(int remainder = 0; remainder <= m_featureSize; remainder++) {
+				for(int i = 0; i < m_featureSize; i++)
+					pKey[i] = static_cast<short>(rem0[i] + canonical[ remainder * (m_featureSize + 1) + rank[i]]);
+				pBarycentric[remainder]	= barycentric[remainder];
+				pKey += m_featureSize;
 			}
-			pOffset[remainder]		= val;	
-			pBarycentric[remainder]	= barycentric[remainder];		
-        }
-    } // k
+		} // k
+	});
+
+	// Merge the vertices into the lattice: the lattice points are indexed in the order of their first appearance
+	CHashTable hash_table(m_featureSize, static_cast<size_t>(m_nFeatures) * (m_featureSize + 1) / 4);
+	for (int k = 0; k < m_nFeatures; k++) {
+		int			*pOffset	= m_offset.ptr<int>(k);
+		const short	*pKey		= vKeys.data() + static_cast<size_t>(k) * (m_featureSize + 1) * m_featureSize;
+		for (int remainder = 0; remainder <= m_featureSize; remainder++, pKey += m_featureSize)
+			pOffset[remainder] = hash_table.insert(pKey);
+	} // k
+	std::vector<short>().swap(vKeys);
     
     // Find the Neighbors of each lattice point
     // Get the number of vertices in the lattice
-	m_M = static_cast<int>(hash_table.size());
+	m_M = hash_table.size();
     
     // Create the neighborhood structure
 	m_blurNeighbor1 = Mat(m_M, m_featureSize + 1, CV_32SC1);
 	m_blurNeighbor2 = Mat(m_M, m_featureSize + 1, CV_32SC1);
     
-    Mat n1(1, m_featureSize + 1, CV_16SC1);
-    Mat n2(1, m_featureSize + 1, CV_16SC1);
-    
     // For each of d+1 axes,
-	for (int i = 0; i < m_M; i++) {
-		int *pBlurNeighbor1 = m_blurNeighbor1.ptr<int>(i);
-		int *pBlurNeighbor2 = m_blurNeighbor2.ptr<int>(i);
-		
-		Mat key = allKeys.row(i); 
-
-		for(int j = 0; j <= m_featureSize; j++) {
-
-			for(int k = 0; k < m_featureSize; k++) {
-                n1.at<short>(0, k) = key.at<short>(0, k) - 1;	// TODO
-                n2.at<short>(0, k) = key.at<short>(0, k) + 1;	// TODO
-            }
-            n1.at<short>(0, j) = key.at<short>(0, std::min(j, m_featureSize - 1)) + m_featureSize;	// TODO
-            n2.at<short>(0, j) = key.at<short>(0, std::min(j, m_featureSize - 1)) - m_featureSize;	// TODO
-            
-			auto it = hash_table.find({ n1(Rect(0, 0, m_featureSize, 1)) });
-			pBlurNeighbor1[j] = it == hash_table.end() ? -1 : it->second;
-			it = hash_table.find({ n2(Rect(0, 0, m_featureSize, 1)) });
-			pBlurNeighbor2[j] = it == hash_table.end() ? -1 : it->second;
-        }
-    }
+	m_parallelFor(m_M, [&](int begin, int end) {
+		std::vector<short> n1(m_featureSize);
+		std::vector<short> n2(m_featureSize);
+
+		for (int i = begin; i < end; i++) {
+			int *pBlurNeighbor1 = m_blurNeighbor1.ptr<int>(i);
+			int *pBlurNeighbor2 = m_blurNeighbor2.ptr<int>(i);
+			const short *key = hash_table.getKey(i);
+
+			for (int j = 0; j <= m_featureSize; j++) {
+				for (int k = 0; k < m_featureSize; k++) {
+					n1[k] = static_cast<short>(key[k] - 1);
+					n2[k] = static_cast<short>(key[k] + 1);
+				}
+				if (j < m_featureSize) {
+					n1[j] = static_cast<short>(key[j] + m_featureSize);
+					n2[j] = static_cast<short>(key[j] - m_featureSize);
+				}
+
+				pBlurNeighbor1[j] = hash_table.find(n1.data());
+				pBlurNeighbor2[j] = hash_table.find(n2.data());
+			}
+		} // i
+	});
+
+	// Inverse of the offsets (counting sort), which allows to splat the features to the lattice points concurrently
+	m_splatBegin.assign(m_M + 1, 0);
+	for (int k = 0; k < m_nFeatures; k++) {
+		const int *pOffset = m_offset.ptr<int>(k);
+		for (int j = 0; j <= m_featureSize; j++) m_splatBegin[pOffset[j] + 1]++;
+	}
+	for (int i = 0; i < m_M; i++) m_splatBegin[i + 1] += m_splatBegin[i];
+	m_splatIdx.resize(m_splatBegin[m_M]);
+	std::vector<int> pos(m_splatBegin.begin(), m_splatBegin.end() - 1);
+	for (int k = 0; k < m_nFeatures; k++) {
+		const int *pOffset = m_offset.ptr<int>(k);
+		for (int j = 0; j <= m_featureSize; j++) m_splatIdx[pos[pOffset[j]]++] = k * (m_featureSize + 1) + j;
+	}
 }
 
 void CPermutohedral::compute(const Mat &src, Mat &dst, int in_offset, int out_offset, size_t in_size, size_t out_size) const
+{
+	Mat values, newValues;
+	compute(src, dst, values, newValues, in_offset, out_offset, in_size, out_size);
+}
+
+void CPermutohedral::compute(const Mat &src, Mat &dst, Mat &values, Mat &newValues, int in_offset, int out_offset, size_t in_size, size_t out_size) const
 {
 	if (in_size  == 0) in_size  = m_nFeatures - in_offset;
     if (out_size == 0) out_size = m_nFeatures - out_offset;
-	if (dst.empty())   dst		= Mat(static_cast<int>(out_size), src.cols, CV_32FC1);
+	dst.create(static_cast<int>(out_size), src.cols, CV_32FC1);
+
+	const int nValues = src.cols;
 
     // Shift all values by 1 such that -1 -> 0 (used for blurring)
-	Mat values(m_M + 2, src.cols, CV_32FC1, Scalar(0));
-    Mat newValues(m_M + 2, src.cols, CV_32FC1, Scalar(0));
-
-    // Splatting
-    for(int i = 0; i < in_size; i++) {
-        const float *pIn			= src.ptr<float>(i);
-		const int	*pOffset		= m_offset.ptr<int>(in_offset + i);
-		const float	*pBarycentric	= m_barycentric.ptr<float>(in_offset + i);
-		for(int j = 0; j <= m_featureSize; j++) {
-            int   o	= pOffset[j] + 1;
-            float w = pBarycentric[j];	
-			float *pValues = values.ptr<float>(o);
-			for(int k = 0; k < src.cols; k++)
-				pValues[k] += w * pIn[k];
-        }
-    }
+	// Only the row 0 must be zero in advance: the other rows are overwritten by splatting and blurring
+	values.create(m_M + 2, nValues, CV_32FC1);
+	newValues.create(m_M + 2, nValues, CV_32FC1);
+	std::fill(values.ptr<float>(0), values.ptr<float>(0) + nValues, 0.0f);
+	std::fill(newValues.ptr<float>(0), newValues.ptr<float>(0) + nValues, 0.0f);
+
+    // Splatting: every lattice point gathers the values of its features in the increasing order of the features, 
+	// thus the result does not depend on the number of threads
+	const int	 in_begin		= in_offset * (m_featureSize + 1);
+	const int	 in_end			= (in_offset + static_cast<int>(in_size)) * (m_featureSize + 1);
+	const float *pBarycentric	= m_barycentric.ptr<float>(0);
+	m_parallelFor(m_M, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			float *pValues = values.ptr<float>(i + 1);
+			std::fill(pValues, pValues + nValues, 0.0f);
+			for (int s = m_splatBegin[i]; s < m_splatBegin[i + 1]; s++) {
+				const int idx = m_splatIdx[s];
+				if (idx < in_begin || idx >= in_end) continue;
+				m_axpy(pBarycentric[idx], src.ptr<float>(idx / (m_featureSize + 1) - in_offset), pValues, nValues, 1.0f);
+			}
+		} // i
+	});
     
+	// Blurring along each of d+1 axes
     for(int j = 0; j <= m_featureSize; j++) {
-        for(int i = 0; i < m_M; i++) {
-            float *pValues		= values.ptr<float>(i + 1);
-            float *pNewValues	= newValues.ptr<float>(i + 1);
-            
-            int n1 = m_blurNeighbor1.at<int>(i, j) + 1;
-            int n2 = m_blurNeighbor2.at<int>(i, j) + 1;
-            float *n1_val = values.ptr<float>(n1);
-            float *n2_val = values.ptr<float>(n2);
-            for(int k = 0; k < src.cols; k++)
-				pNewValues[k] = pValues[k] + 0.5f * (n1_val[k] + n2_val[k]);
-        }
+		m_parallelFor(m_M, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				int n1 = m_blurNeighbor1.at<int>(i, j) + 1;
+				int n2 = m_blurNeighbor2.at<int>(i, j) + 1;
+				m_blur(values.ptr<float>(i + 1), values.ptr<float>(n1), values.ptr<float>(n2), newValues.ptr<float>(i + 1), nValues);
+			} // i
+		});
 		swap(values, newValues);
     }
     // Alpha is a magic scaling constant (write Andrew if you really wanna understand this)
     float alpha = 1.0f / (1.0f + powf(2.0f, -static_cast<float>(m_featureSize)));
     
     // Slicing
-    for(int i = 0; i < out_size; i++) {
-        float		*pOut			= dst.ptr<float>(i);
-		const int	*pOffset		= m_offset.ptr<int>(in_offset + i);
-		const float	*pBarycentric	= m_barycentric.ptr<float>(in_offset + i);
-		for(int k = 0; k < src.cols; k++)
-            pOut[k] = 0;
-        for(int j = 0; j <= m_featureSize; j++) {
-            int   o = pOffset[j] + 1;		
-            float w = pBarycentric[j];	
-			float *pValues = values.ptr<float>(o);
-			for(int k = 0; k < src.cols; k++)
-                pOut[k] += w * pValues[k] * alpha;
-        }
-    }
+	m_parallelFor(static_cast<int>(out_size), [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			float		*pOut			= dst.ptr<float>(i);
+			const int	*pOffset		= m_offset.ptr<int>(in_offset + i);
+			const float	*pBarycentric	= m_barycentric.ptr<float>(in_offset + i);
+			std::fill(pOut, pOut + nValues, 0.0f);
+			for(int j = 0; j <= m_featureSize; j++)
+				m_axpy(pBarycentric[j], values.ptr<float>(pOffset[j] + 1), pOut, nValues, alpha);
+		} // i
+	});
 }
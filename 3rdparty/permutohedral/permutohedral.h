@@ -30,6 +30,7 @@
 #pragma once
 
 #include "types.h"
+#include <functional>
 
 /************************************************/
 /***          Permutohedral Lattice           ***/
@@ -37,13 +38,26 @@
 class CPermutohedral
 {
 public:
-    CPermutohedral(void) = default;
+	// Parallel loop: calls body(begin, end) for the disjoint sub-ranges, covering [0; n), possibly concurrently
+	using parallel_for_t	= std::function<void(int n, const std::function<void(int begin, int end)> &body)>;
+	// Inner loop of splatting and slicing: dst[x] += a * v[x] * b for x in [0; n)
+	using axpy_t			= void (*)(float a, const float *v, float *dst, int n, float b);
+	// Inner loop of blurring: dst[x] = v[x] + 0.5 * (n1[x] + n2[x]) for x in [0; n)
+	using blur_t			= void (*)(const float *v, const float *n1, const float *n2, float *dst, int n);
+
+public:
+    CPermutohedral(void);
     CPermutohedral(const CPermutohedral& rhs);
     CPermutohedral& operator= (const CPermutohedral& rhs);
 	~CPermutohedral(void) = default;
 
+	// Replaces the serial loops and the scalar inner loops (e.g. with the multi-threaded and vectorized ones). Must be called before init()
+	// The replacements must perform the same floating-point operations, so that the results do not change
+	void setBackend(const parallel_for_t &parallelFor, axpy_t axpy, blur_t blur);
     void init(const Mat& features);
     void compute(const Mat& src, Mat& dst, int in_offset = 0, int out_offset = 0, size_t in_size = 0, size_t out_size = 0) const;
+	// The same as above, but with the work buffers for the lattice values, which may be re-used between the calls
+	void compute(const Mat& src, Mat& dst, Mat& values, Mat& newValues, int in_offset = 0, int out_offset = 0, size_t in_size = 0, size_t out_size = 0) const;
 
     
 private:
@@ -55,4 +69,13 @@ private:
     Mat	m_barycentric       = Mat();
     Mat	m_blurNeighbor1		= Mat();
 	Mat	m_blurNeighbor2		= Mat();
+
+	// Splatting as gathering: for every lattice point i the elements m_splatIdx[m_splatBegin[i] .. m_splatBegin[i + 1]) of m_offset and 
+	// m_barycentric (in the row-major order), which refer to this point, in the increasing order of the features
+	std::vector<int> m_splatBegin;
+	std::vector<int> m_splatIdx;
+
+	parallel_for_t	m_parallelFor;
+	axpy_t			m_axpy;
+	blur_t			m_blur;
 };
@@ -8,7 +8,7 @@
 #pragma once
 
 #include <assert.h>
-#include <ppl.h>
+#include "DGM/parallel.h"
 
 #include <vector>
 #include <string>
@@ -140,7 +140,7 @@ namespace MicrosoftResearch { namespace Cambridge { namespace Sherwood
 
 					
 			//for (int threadIndex = 0; threadIndex < maxThreads_; threadIndex++) {
-			concurrency::parallel_for(0, maxThreads_, [&](int threadIndex) {
+			DirectGraphicalModels::parallel::parallel_for(0, maxThreads_, [&](int threadIndex) {
 				ThreadLocalData &tl = threadLocalData_[threadIndex]; // shorthand
 
 				tl.Clear();
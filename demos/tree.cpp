@@ -33,13 +33,14 @@ void CTree::buildTree(CGraphPairwise &graph)
 	for (size_t n = 0; n < nNodes; n++)	graph.addNode(nPot);
 
 	// Create weighted edges with random weights
-	std::vector<std::pair<ptr_edge_t, float>> edges; 
+	using edge_t = std::pair<size_t, size_t>;
+	std::vector<std::pair<edge_t, float>> edges; 
 	for (size_t n1 = 0; n1 < nNodes; n1++) 
 		for (size_t n2 = n1 + 1; n2 < nNodes; n2++) 
-			edges.push_back(std::make_pair(ptr_edge_t(new Edge(n1, n2)), static_cast<float>(rand()) / RAND_MAX));
+			edges.push_back(std::make_pair(edge_t(n1, n2), static_cast<float>(rand()) / RAND_MAX));
 
 	// Sort these edges by weight
-	std::sort(edges.begin(), edges.end(), [](std::pair<ptr_edge_t, float> &left, std::pair<ptr_edge_t, float> &right) { return left.second < right.second; });
+	std::sort(edges.begin(), edges.end(), [](std::pair<edge_t, float> &left, std::pair<edge_t, float> &right) { return left.second < right.second; });
 	
 	Mat edgePot;													// Default symmetric edge potentials
 	addWeighted(getEdgePot(), 0.5, getEdgePot().t(), 0.5, 0.0, edgePot);
@@ -48,10 +49,10 @@ void CTree::buildTree(CGraphPairwise &graph)
 	std::vector<bool> N(nNodes, false);							// Accounted nodes
 	N[0] = true;												// Start from the first node
 	while (std::find(N.begin(), N.end(), false) != N.end()) {	// while there is at least one non-accounted node
-		std::vector<std::pair<ptr_edge_t, float>>::iterator it;		// Find an edge with minimal weight, such that one node is accounted and the second is not
-		while ((it = std::find_if(edges.begin(), edges.end(), [&](std::pair<ptr_edge_t, float> &edge) { return N[edge.first->node1] ^ N[edge.first->node2]; })) != edges.end()) {
-			size_t n1 = it->first->node1;
-			size_t n2 = it->first->node2;
+		std::vector<std::pair<edge_t, float>>::iterator it;		// Find an edge with minimal weight, such that one node is accounted and the second is not
+		while ((it = std::find_if(edges.begin(), edges.end(), [&](std::pair<edge_t, float> &edge) { return N[edge.first.first] ^ N[edge.first.second]; })) != edges.end()) {
+			size_t n1 = it->first.first;
+			size_t n2 = it->first.second;
 			graph.addArc(n1, n2, edgePot);						// Add an arc to the tree
 			N[n1] = N[n2] = true;								// Now both nodes are accounted
 		}
@@ -52,6 +52,7 @@
 #include "DGM/GraphDense.h"
 #include "DGM/IGraphPairwise.h"
 #include "DGM/GraphPairwise.h"
+#include "DGM/GraphGrid.h"
 #include "DGM/GraphWeiss.h"
 #include "DGM/Graph3.h"
 
@@ -62,13 +63,22 @@
 #include "DGM/InferExact.h"
 #include "DGM/InferDense.h"
 #include "DGM/InferChain.h"
+#include "DGM/InferChainBatch.h"
 #include "DGM/InferTree.h"
+#include "DGM/InferJunctionTree.h"
 #include "DGM/InferLBP.h"
+#include "DGM/InferMultiScaleBP.h"
+#include "DGM/InferRedBlackBP.h"
+#include "DGM/InferResidualBP.h"
 #include "DGM/InferTRW.h"
 #include "DGM/InferViterbi.h"
+#include "DGM/InferGraphCut.h"
+#include "DGM/InferICM.h"
+#include "DGM/InferMeanField.h"
 
 #include "DGM/Decode.h"
 #include "DGM/DecodeExact.h"
+#include "DGM/DecodeICM.h"
 
 #include "DGM/ParamEstimationPSO.h"
 #include "DGM/ParamEstimation.h"
@@ -127,10 +137,18 @@ DGM implements the following inference and decoding methods:
 @subsubsection sec_main_decode_inference Inference
 - <b>Exact:</b> Exact inferece for small graphs with an exhaustive search @ref DirectGraphicalModels::CInferExact
 - <b>Chain:</b> Exact inferece for Markov chains (chain-structured graphs) @ref DirectGraphicalModels::CInferChain
+- <b>Chain Batch:</b> Exact inference and decoding for large batches of independent chains with shared edge potentials @ref DirectGraphicalModels::CInferChainBatch
 - <b>Tree:</b> Exact inferece for undirected graphs without loops (tree-structured graphs) @ref DirectGraphicalModels::CInferTree
+- <b>Junction Tree:</b> Exact inferece for graphs with small treewidth (\a e.g. ladders, strips and layered graphs) @ref DirectGraphicalModels::CInferJunctionTree
 - <b>LBP:</b> Approximate inference based on the Loopy Belief Propagation (\a sum-product message-passing) algorithm @ref DirectGraphicalModels::CInferLBP 
+- <b>Residual BP:</b> Approximate inference based on the Residual Belief Propagation (\a sum-product message-passing with informed scheduling) algorithm @ref DirectGraphicalModels::CInferResidualBP 
+- <b>Red-Black BP:</b> Approximate inference based on the Loopy Belief Propagation algorithm with in-place checkerboard scheduling of the messages @ref DirectGraphicalModels::CInferRedBlackBP 
+- <b>Multi-scale BP:</b> Approximate inference for grid graphs based on the coarse-to-fine Loopy Belief Propagation algorithm @ref DirectGraphicalModels::CInferMultiScaleBP 
 - <b>TRW:</b> Approximate inference based on the (<a href="http://pub.ist.ac.at/~vnk/papers/TRW-S-PAMI.pdf" target="_blank">Convergent Tree-Reweighted</a>) (\a max-sum message-passing) algorithm @ref DirectGraphicalModels::CInferTRW 
 - <b>Viterbi:</b> Approximate inference based on Viterbi (\a max-sum message-passing) algorithm @ref DirectGraphicalModels::CInferViterbi 
+- <b>Graph Cut:</b> Approximate inference based on the \f$\alpha\f$-expansion (max-flow / min-cut) algorithm @ref DirectGraphicalModels::CInferGraphCut 
+- <b>ICM:</b> Fast approximate inference based on the Iterated Conditional Modes algorithm @ref DirectGraphicalModels::CInferICM 
+- <b>Mean Field:</b> Approximate inference based on the (parallel) mean-field approximation of the marginals @ref DirectGraphicalModels::CInferMeanField 
 - <b>Dense:</b> Efficient inference for \a dense CRFs with Gaussian edge potentials (<a href="http://vladlen.info/publications/efficient-inference-in-fully-connected-crfs-with-gaussian-edge-potentials/" target="_blank">paper</a>) @ref DirectGraphicalModels::CInferDense
 
 The corresponding classes are @b CInfer* (where @b * is the name of the method above). 
@@ -139,6 +157,7 @@ All of the inference classes may be also used for approximate decoding via funct
 
 @subsubsection sec_main_decode_decoding Decoding
 - <b>Exact:</b> Exact decoding for small graphs with an exhaustive search @ref DirectGraphicalModels::CDecodeExact
+- <b>ICM:</b> Fast approximate decoding with the (parallel) Iterated Conditional Modes algorithm @ref DirectGraphicalModels::CDecodeICM
 
 The corresponding classes are @b CDecode* (where @b * is the name of the method above). 
 
@@ -1,6 +1,6 @@
 #include "DecodeExact.h"
+#include "parallel.h"
 #include "macroses.h"
-#include <numeric>
 
 namespace DirectGraphicalModels
 {
@@ -8,30 +8,8 @@ namespace DirectGraphicalModels
 	{
 		DGM_IF_WARNING(!lossMatrix.empty(), "The Loss Matrix is not supported by the algorithm.");
 
-		size_t			nNodes = getGraph().getNumNodes();
-		vec_byte_t		state(nNodes);
-
-		// Calculating the potentials for every possible configuration
-		vec_float_t     P = calculatePotentials();
-
-#ifdef DEBUG_PRINT_INFO
-		// Printing out
-		printf("nConfigurations = %zd\n", P.size());
-
-        // Calculating the partition function
-        float Z = std::accumulate(P.cbegin(), P.cend(), 0.0f);
-        
-        setState(state, 0);
-        for (float &p: P) {
-			for (size_t n = 0; n < nNodes; n++) printf("%d ", state[n]);
-			printf(":-> %2.1f\t| %2.1f %% \n", p, p * 100 / Z);
-			incState(state);
-		}
-#endif
-
-		// Finding the most probable configuration
-		qword c = std::max_element(P.cbegin(), P.cend()) - P.begin();
-		setState(state, c);
+		vec_byte_t state;
+		enumerate(&state, NULL);
 		return state;
 	}
 
@@ -45,47 +23,174 @@ namespace DirectGraphicalModels
 		}
 	}
 
-	// Increases the <state> by one
-	void CDecodeExact::incState(vec_byte_t &state) const
+	// Enumerates all possible configurations
+	void CDecodeExact::enumerate(vec_byte_t *pState, vec_float_t *pMarginals) const
 	{
-		size_t nNodes = getGraph().getNumNodes();
-		for (size_t n = 0; n < nNodes; n++)
-			if (++state[n] >= getGraph().getNumStates()) state[n] = 0;
-			else break;
-	}
+		const size_t	nNodes	= getGraph().getNumNodes();
+		const byte		nStates	= getGraph().getNumStates();
+		const long double nConfigurations = powl(nStates, static_cast<long double>(nNodes));
+		DGM_ASSERT_MSG(nConfigurations < static_cast<long double>(std::numeric_limits<qword>::max()), "The number of configurations %d^%zu exceeds the maximal possible number", nStates, nNodes);
 
-	// Calculates potentials for all possible configurations
-	vec_float_t CDecodeExact::calculatePotentials(void) const
-	{
-		size_t		nNodes = getGraph().getNumNodes();
-		size_t		nConfigurations = static_cast<size_t> (powl(getGraph().getNumStates(), static_cast<long double>(nNodes)));
-		vec_byte_t	state(nNodes);
-
-		vec_float_t		  res;
-		DGM_ASSERT_MSG(nConfigurations < res.max_size(), "The number of configurations %d^%zu exceeds the maximal possible size of container.", getGraph().getNumStates(), nNodes);
-		res.resize(nConfigurations, 1.0f);
-
-		setState(state, 0);
-        Mat nPot, ePot;
-        vec_size_t vChildNodes;
-		for (float &p: res) {
-            for (size_t n = 0; n < nNodes; n++) {
-                getGraph().getNode(n, nPot);
-                p *= nPot.at<float>(state[n], 0);
-                vec_size_t vChilds;
-                getGraph().getChildNodes(n, vChilds);
-                for (size_t c: vChilds) {
-                    getGraphPairwise().getEdge(n, c, ePot);
-                    p *= ePot.at<float>(state[n], state[c]);
-                }
-            }
-            
-            // Old implementation with direct access to CGraphPairwise private member variables
-            // for (ptr_node_t &node : getGraphPairwise().m_vNodes) p *= node->Pot.at<float>(state[node->id], 0);
-            // for (ptr_edge_t &edge : getGraphPairwise().m_vEdges) p *= edge->Pot.at<float>(state[edge->node1], state[edge->node2]);
-			incState(state);
+		// ------------------------------------- Potentials snapshot -------------------------------------
+		// Every potential is stored as its logarithm, the zero potentials are counted separately
+		struct SEdge {
+			size_t	src;
+			size_t	dst;
+			size_t	offset;					// Offset of the edge potential in the vLogEdgePot array
+		};
+		std::vector<double>		vLogNodePot(nNodes * nStates);
+		vec_byte_t				vZeroNodePot(nNodes * nStates);
+		std::vector<double>		vLogEdgePot;
+		vec_byte_t				vZeroEdgePot;
+		std::vector<SEdge>		vEdges;
+		std::vector<vec_size_t>	vvNodeEdges(nNodes);			// Edges, incident to every node
+		
+		Mat pot;
+		vec_size_t vChilds;
+		for (size_t n = 0; n < nNodes; n++) {
+			getGraph().getNode(n, pot);
+			for (byte s = 0; s < nStates; s++) {
+				const float p = pot.at<float>(s, 0);
+				vZeroNodePot[n * nStates + s] = p <= 0;
+				vLogNodePot[n * nStates + s]  = p > 0 ? log(p) : 0;
+			}
+			vChilds.clear();														// some graphs append the child nodes to the vector
+			getGraph().getChildNodes(n, vChilds);
+			for (size_t c : vChilds) {
+				getGraphPairwise().getEdge(n, c, pot);
+				vvNodeEdges[n].push_back(vEdges.size());
+				if (c != n) vvNodeEdges[c].push_back(vEdges.size());
+				vEdges.push_back({ n, c, vLogEdgePot.size() });
+				for (byte x = 0; x < nStates; x++)
+					for (byte y = 0; y < nStates; y++) {
+						const float p = pot.at<float>(x, y);
+						vZeroEdgePot.push_back(p <= 0);
+						vLogEdgePot.push_back(p > 0 ? log(p) : 0);
+					}
+			} // c
+		} // n
+
+		// ------------------------------------- Partitioning -------------------------------------
+		// The states of the last nFixed nodes are fixed in every partition
+		size_t nFixed = 0;
+		qword  nPartitions = 1;
+		const size_t nThreads = parallel::getNumThreads();
+		while (nFixed < nNodes && nThreads > 1 && nPartitions < 16 * nThreads && nConfigurations / nPartitions > 4096) {
+			nFixed++;
+			nPartitions *= nStates;
 		}
+		const size_t nFree = nNodes - nFixed;
+		const qword	 nPartitionConfigurations = static_cast<qword>(powl(nStates, static_cast<long double>(nFree)));
+
+		struct SResult {
+			double			bestLogP = -std::numeric_limits<double>::infinity();	// Logarithm of the probability of the most probable configuration
+			qword			best	 = 0;											// Index of the most probable configuration
+			double			offset	 = -std::numeric_limits<double>::infinity();	// The marginals are scaled with exp(-offset)
+			std::vector<double> vMarginals;
+		};
+		std::vector<SResult> vResults(static_cast<size_t>(nPartitions));
 
-		return res;
+		// ------------------------------------- Enumeration -------------------------------------
+		parallel::parallel_for(qword(0), nPartitions, [&, nStates](qword partition) {
+			SResult		&res = vResults[static_cast<size_t>(partition)];
+			vec_byte_t	state(nNodes, 0);
+			std::vector<signed char> vDir(nFree, 1);										// Directions of the Gray code
+			std::vector<qword> vWeight(nNodes);													// Weights of the nodes in the configuration index
+			for (size_t n = 0; n < nNodes; n++) vWeight[n] = n ? vWeight[n - 1] * nStates : 1;
+
+			qword idx = partition * nPartitionConfigurations;
+			for (size_t n = nFree; n < nNodes; n++) state[n] = static_cast<byte>((idx / vWeight[n]) % nStates);
+
+			// Potential of the first configuration
+			double	logP   = 0;
+			int		nZeros = 0;
+			auto addNode = [&](size_t n, int sign) {
+				const size_t i = n * nStates + state[n];
+				logP   += sign * vLogNodePot[i];
+				nZeros += sign * vZeroNodePot[i];
+			};
+			auto addEdge = [&](const SEdge &edge, int sign) {
+				const size_t i = edge.offset + state[edge.src] * nStates + state[edge.dst];
+				logP   += sign * vLogEdgePot[i];
+				nZeros += sign * vZeroEdgePot[i];
+			};
+			for (size_t n = 0; n < nNodes; n++) addNode(n, 1);
+			for (const SEdge &edge : vEdges) addEdge(edge, 1);
+
+			// Marginals: the sum of the probabilities of all visited configurations is accumulated in S, and the marginal of the state of
+			// a node is increased by the part of S, accumulated since the node has switched to this state
+			double		 S = 0;
+			std::vector<double> vS(pMarginals ? nNodes : 0, 0.0);
+			if (pMarginals) res.vMarginals.assign(nNodes * nStates, 0.0);
+
+			for (qword c = 0; ; c++) {
+				if (nZeros == 0) {
+					if (pState && (logP > res.bestLogP || (logP == res.bestLogP && idx < res.best))) {
+						res.bestLogP = logP;
+						res.best	 = idx;
+					}
+					if (pMarginals) {
+						if (logP > res.offset + 64) {											// rescaling to avoid overflow
+							const double k = exp(res.offset - logP);
+							S *= k;
+							for (double &s : vS) s *= k;
+							for (double &m : res.vMarginals) m *= k;
+							res.offset = logP;
+						}
+						S += exp(logP - res.offset);
+					}
+				}
+				if (c + 1 == nPartitionConfigurations) break;
+
+				// Next configuration of the reflected Gray code
+				size_t n = 0;
+				while (state[n] + vDir[n] < 0 || state[n] + vDir[n] >= nStates) {
+					vDir[n] = -vDir[n];
+					n++;
+				}
+				if (pMarginals) {
+					res.vMarginals[n * nStates + state[n]] += S - vS[n];
+					vS[n] = S;
+				}
+				addNode(n, -1);
+				for (size_t e : vvNodeEdges[n]) addEdge(vEdges[e], -1);
+				state[n] += vDir[n];
+				addNode(n, 1);
+				for (size_t e : vvNodeEdges[n]) addEdge(vEdges[e], 1);
+				if (vDir[n] > 0) idx += vWeight[n];
+				else			 idx -= vWeight[n];
+			} // c
+
+			if (pMarginals)
+				for (size_t n = 0; n < nNodes; n++)
+					res.vMarginals[n * nStates + state[n]] += S - vS[n];
+		});
+
+		// ------------------------------------- Merging -------------------------------------
+		if (pState) {
+			const SResult *best = &vResults[0];
+			for (const SResult &res : vResults)
+				if (res.bestLogP > best->bestLogP || (res.bestLogP == best->bestLogP && res.best < best->best)) best = &res;
+			pState->resize(nNodes);
+			setState(*pState, best->best);
+		}
+
+		if (pMarginals) {
+			double offset = -std::numeric_limits<double>::infinity();
+			for (const SResult &res : vResults) offset = MAX(offset, res.offset);
+			std::vector<double> vMarginals(nNodes * nStates, 0.0);
+			for (const SResult &res : vResults) {
+				if (res.offset == -std::numeric_limits<double>::infinity()) continue;
+				const double k = exp(res.offset - offset);
+				for (size_t i = 0; i < vMarginals.size(); i++) vMarginals[i] += k * res.vMarginals[i];
+			}
+			pMarginals->resize(nNodes * nStates);
+			for (size_t n = 0; n < nNodes; n++) {
+				double Z = 0;
+				for (byte s = 0; s < nStates; s++) Z += vMarginals[n * nStates + s];
+				for (byte s = 0; s < nStates; s++)
+					(*pMarginals)[n * nStates + s] = Z > 0 ? static_cast<float>(vMarginals[n * nStates + s] / Z) : 1.0f / nStates;
+			}
+		}
 	}
 }
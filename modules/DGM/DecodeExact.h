@@ -46,17 +46,16 @@ namespace DirectGraphicalModels
 		*/
 		void			setState(vec_byte_t &state, qword configuration) const;
 		/**
-		* @brief Increases the \a state by one, \a i.e. switches the \a state array to the consequent configuration
-		* @details This function is used in exact inference / decoding
-		* @param state Array of \a nNodes elements with the current configuration (states destributed along the nodes)
-		*/
-		void			incState(vec_byte_t &state) const;
-		/**
-		* @brief Calculates potentials for all possible configurations
-		* @details This function is used in exact inference / decoding
-		* @return \f$nStates^{nNodes}\f$ potentials, corresponding to the all possible configurations (states destributed along the nodes)
+		* @brief Enumerates all possible configurations
+		* @details The node and edge potentials are copied from the graph once and converted to the log domain. The configurations are visited 
+		* in the reflected Gray code order, where two subsequent configurations differ in the state of one node only, thus the probability of every 
+		* configuration is updated incrementally with the potentials of this node and its edges. The configuration space is partitioned by the 
+		* states of the last nodes and the partitions are enumerated concurrently, with their own partial results.
+		* > No memory is allocated in the enumeration loop and the memory usage does not depend on the number of configurations
+		* @param[out] pState If not NULL, the most probable configuration (states destributed along the nodes)
+		* @param[out] pMarginals If not NULL, the \a nNodes x \a nStates marginal probabilities of the nodes
 		*/
-		vec_float_t		calculatePotentials(void) const;
+		void			enumerate(vec_byte_t *pState, vec_float_t *pMarginals) const;
 	};
 }
 
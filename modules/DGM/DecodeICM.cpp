@@ -0,0 +1,69 @@
+#include "DecodeICM.h"
+#include "GraphPairwise.h"
+#include "parallel.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	vec_byte_t CDecodeICM::decode(Mat &lossMatrix) const
+	{
+		return decode(CDecode::decode(getGraph(), lossMatrix), m_nIt);
+	}
+
+	vec_byte_t CDecodeICM::decode(vec_byte_t state, unsigned int nIt) const
+	{
+		sweep(state, nIt);
+		return state;
+	}
+
+	// ------------------------------ PROTECTED ------------------------------
+	unsigned int CDecodeICM::sweep(vec_byte_t &state, unsigned int nIt) const
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();						// number of states
+
+		DGM_ASSERT_MSG(state.size() == graph.getNumNodes(), "The size of the configuration %zu does not match the number of nodes %zu", state.size(), graph.getNumNodes());
+		graph.updateAdjacency();
+		const std::vector<vec_size_t> &vvNodes = graph.colorNodes();
+
+		std::atomic<bool> changed;
+		auto update = [&, nStates](size_t n) {
+			double score[256];
+			const float *pot = graph.getNodePot(n);
+			for (byte s = 0; s < nStates; s++) score[s] = pot[s];
+			
+			for (size_t e_f : graph.getInEdges(n)) {							// incoming edges
+				const float *edgePot = graph.getEdgePot(e_f);
+				if (!edgePot) continue;
+				edgePot += state[graph.m_vEdgeSrc[e_f]] * nStates;
+				for (byte s = 0; s < nStates; s++) score[s] *= edgePot[s];
+			} // e_f
+			for (size_t e_t : graph.getOutEdges(n)) {							// outgoing edges
+				const float *edgePot = graph.getEdgePot(e_t);
+				if (!edgePot) continue;
+				edgePot += state[graph.m_vEdgeDst[e_t]];
+				for (byte s = 0; s < nStates; s++) score[s] *= edgePot[s * nStates];
+			} // e_t
+
+			byte best = state[n];
+			for (byte s = 0; s < nStates; s++) if (score[s] > score[best]) best = s;
+			if (best != state[n]) {
+				state[n] = best;
+				changed.store(true, std::memory_order_relaxed);
+			}
+		};
+
+		unsigned int i;
+		for (i = 0; i < nIt; i++) {												// sweeps
+			changed = false;
+			for (const vec_size_t &vNodes : vvNodes)							// colors
+				parallel::parallel_for_each(vNodes.begin(), vNodes.end(), update);
+			if (!changed) {
+				i++;
+				break;
+			}
+		} // i
+
+		return i;
+	}
+}
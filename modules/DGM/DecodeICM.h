@@ -0,0 +1,67 @@
+// Iterated Conditional Modes decoding class interface
+#pragma once
+
+#include "Decode.h"
+#include "GraphPairwise.h"
+
+namespace DirectGraphicalModels
+{
+	// ============================= ICM Decode Class ============================
+	/**
+	* @ingroup moduleDecode
+	* @brief Iterated Conditional Modes decoding class
+	* @details This class finds a local maximum of the joint probability of the configuration with the Iterated Conditional Modes algorithm:
+	* starting from an initial configuration, the state of every node is replaced with the state, which maximizes the product of the node 
+	* potential and the edge potentials, given the current states of its neighbors. The sweeps over all nodes are repeated until no state 
+	* changes. The nodes are visited in the order of their colors (ref. CGraphPairwise::colorNodes()), and the nodes of the same color, 
+	* which are never adjacent, are processed in parallel (ref. ENABLE_PPL). For the 4-connected grids it is the red-black checkerboard order.
+	* > A sweep costs \a O(nEdges x nStates) operations and does not allocate memory. The result is only a local optimum, thus this decoder 
+	* is meant for latency-critical applications, where a fast good-enough configuration is sufficient.
+	*/
+	class CDecodeICM : public CDecode
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		* @param nIt The maximal number of sweeps
+		*/		
+		DllExport CDecodeICM(CGraphPairwise &graph, unsigned int nIt = 10) : CDecode(graph), m_nIt(nIt) {}
+		DllExport virtual ~CDecodeICM(void) = default;
+
+		/**
+		* @brief Approximate decoding
+		* @details The decoding is warm-started from the configuration, given by CDecode::decode(const CGraph &, Mat &)
+		* @param lossMatrix (optional) The loss matrix, used for the initial configuration (ref. CDecode::decode())
+		* @return The most probable configuration
+		*/
+		DllExport virtual vec_byte_t decode(Mat &lossMatrix = EmptyMat) const;
+		/**
+		* @brief Approximate decoding
+		* @details The decoding is warm-started from the given configuration, \a e.g. from the result of the previous frame
+		* @param state The initial configuration
+		* @param nIt The maximal number of sweeps
+		* @return The most probable configuration
+		*/
+		DllExport vec_byte_t		 decode(vec_byte_t state, unsigned int nIt) const;
+
+
+	protected:
+		/**
+		* @brief Performs the ICM sweeps
+		* @param[in,out] state The initial configuration, which is replaced with the found configuration
+		* @param nIt The maximal number of sweeps
+		* @return The number of performed sweeps
+		*/
+		unsigned int	sweep(vec_byte_t &state, unsigned int nIt) const;
+		/**
+		* @brief Returns the graph
+		* @return The graph
+		*/
+		CGraphPairwise & getGraphPairwise(void) const { return static_cast<CGraphPairwise &>(getGraph()); }
+
+
+	private:
+		unsigned int m_nIt;		///< The maximal number of sweeps
+	};
+}
@@ -1,16 +1,23 @@
 #include "EdgeModelPotts.h"
 #include "permutohedral/permutohedral.h"
+#include "parallel.h"
+#include "kernels.h"
 
 namespace DirectGraphicalModels {
 	// Constructor
 	CEdgeModelPotts::CEdgeModelPotts(const Mat& features, float weight, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction, bool perPixelNormalization)
 		: IEdgeModel()
-		, m_pLattice(new CPermutohedral())
 		, m_weight(weight)
 		, m_norm(features.rows, 1, CV_32FC1, Scalar(1))
 		, m_function(semiMetricFunction)
 	{
-		m_pLattice->init(features);
+		auto pLattice = std::make_shared<CPermutohedral>();
+		pLattice->setBackend([](int n, const std::function<void(int, int)> &body) {
+			const int rangeSize = MAX(1, n / (static_cast<int>(parallel::getNumThreads()) * 10));
+			parallel::parallel_for(0, n, rangeSize, [&](int i) { body(i, MIN(i + rangeSize, n)); });
+		}, kernels::axpy, kernels::blur);
+		pLattice->init(features);
+		m_pLattice = pLattice;
 
 		// Compute the normalization factor
 		m_pLattice->compute(m_norm, m_norm);
@@ -25,11 +32,14 @@ namespace DirectGraphicalModels {
 		}
 	}
 
-	// Destructor
-	CEdgeModelPotts::~CEdgeModelPotts(void)
-	{
- 		delete m_pLattice;
-	}
+	// Constructor
+	CEdgeModelPotts::CEdgeModelPotts(const CEdgeModelPotts& edgeModel, float weight, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction)
+		: IEdgeModel()
+		, m_pLattice(edgeModel.m_pLattice)
+		, m_weight(weight)
+		, m_norm(edgeModel.m_norm)
+		, m_function(semiMetricFunction)
+	{}
 
 	// dst = e^(w * norm * f(Lattice.compute(src)))
 	void CEdgeModelPotts::apply(const Mat &src, Mat &dst) const
@@ -37,7 +47,7 @@ namespace DirectGraphicalModels {
 		m_pLattice->compute(src, dst);				// dst = Lattice.compute(src)
 
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, dst.rows, [&](int n) {
+		parallel::parallel_for(0, dst.rows, [&](int n) {
 #else
 		for (int n = 0; n < dst.rows; n++) {	// nodes
 #endif
@@ -55,4 +65,17 @@ namespace DirectGraphicalModels {
 		exp(dst, dst);
 	}
 
+	// dst = pots * e^(w * norm * f(Lattice.compute(src)))
+	void CEdgeModelPotts::applyMultiply(const Mat &src, const Mat &pots, Mat &dst, vec_mat_t &buffers) const
+	{
+		if (buffers.size() < 3) buffers.resize(3);
+		Mat &temp = buffers[0];
+		m_pLattice->compute(src, temp, buffers[1], buffers[2]);		// temp = Lattice.compute(src)
+		dst.create(pots.size(), pots.type());
+
+		parallel::parallel_for(0, temp.rows, [&](int n) {
+			if (m_function) m_function(temp.row(n), lvalue_cast(temp.row(n)));		// With the SemiMetric function
+			kernels::mulExp(m_weight * m_norm.at<float>(n, 0), temp.ptr<float>(n), pots.ptr<float>(n), dst.ptr<float>(n), temp.cols);
+		});
+	}
 }
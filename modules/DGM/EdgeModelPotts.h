@@ -30,13 +30,24 @@ namespace DirectGraphicalModels {
 		* @param perPixelNormalization Flag indicating whether er-pixel normalization should be used during applying the edge model.
 		*/
 		DllExport CEdgeModelPotts(const Mat& features, float weight = 1.0f, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction = {}, bool perPixelNormalization = true);
-		DllExport virtual ~CEdgeModelPotts(void);
+		/**
+		* @brief Constructor
+		* @details This constructs a new edge potentials model, which shares the permutohedral lattice and the normalization factors
+		* with the  edgeModel, thus no lattice is built. It is useful when the same features appear again,  e.g. the positional
+		* features of the images of the same size.
+		* @param edgeModel The edge model, which lattice is shared
+		* @param weight The weighting parameter (default value is 1)
+		* @param semiMetricFunction Reference to a semi-metric function (ref. @ref CEdgeModelPotts(const Mat&, float, const std::function<void(const Mat& src, Mat& dst)>&, bool))
+		*/
+		DllExport CEdgeModelPotts(const CEdgeModelPotts& edgeModel, float weight = 1.0f, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction = {});
+		DllExport virtual ~CEdgeModelPotts(void) = default;
 	
 		DllExport void apply(const Mat &src, Mat &dst) const override;
+		DllExport void applyMultiply(const Mat &src, const Mat &pots, Mat &dst, vec_mat_t &buffers) const override;
 	
 
 	private:
-		CPermutohedral								  * m_pLattice;		///< Pointer to the permutohedral lattice
+		std::shared_ptr<const CPermutohedral>			m_pLattice;		///< Pointer to the permutohedral lattice (may be shared between the edge models)
 		float											m_weight;		///< The weighting parameter
 		Mat												m_norm;			///< Array with normalization factors
 		std::function<void(const Mat &src, Mat &dst)>	m_function;		///< The semi-metric function
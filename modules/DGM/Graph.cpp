@@ -1,4 +1,5 @@
 #include "Graph.h"
+#include "parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels 
@@ -14,10 +15,9 @@ namespace DirectGraphicalModels
 
 #ifdef ENABLE_PPL
 		int size = pots.rows;
-		int rangeSize = size / (concurrency::GetProcessorCount() * 10);
+		int rangeSize = size / (static_cast<int>(parallel::getNumThreads()) * 10);
 		rangeSize = MAX(1, rangeSize);
-		//printf("Processors: %d\n", concurrency::GetProcessorCount());
-		concurrency::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
+		parallel::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
 			for (int j = 0; (j < rangeSize) && (i + j < size); j++)
 				setNode(start_node + i + j, pots.row(i + j).t());
 		});
@@ -40,10 +40,9 @@ namespace DirectGraphicalModels
 
 #ifdef ENABLE_PPL
 		int size = pots.cols;
-		int rangeSize = size / (concurrency::GetProcessorCount() * 10);
+		int rangeSize = size / (static_cast<int>(parallel::getNumThreads()) * 10);
 		rangeSize = MAX(1, rangeSize);
-		//printf("Processors: %d\n", concurrency::GetProcessorCount());
-		concurrency::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
+		parallel::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
 			Mat pot;
 			for (int j = 0; (j  < rangeSize) && (i + j < size); j++)
 				getNode(start_node + i + j, lvalue_cast(pots.col(i + j)));
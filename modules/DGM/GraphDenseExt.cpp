@@ -31,17 +31,26 @@ namespace DirectGraphicalModels
 
 	void CGraphDenseExt::addGaussianEdgeModel(Vec2f sigma, float weight, const std::function<void(const Mat& src, Mat& dst)> &semiMetricFunction)
 	{
-		Mat features;
-		Mat feature(1, 2, CV_32FC1);
-		float *pFeature = feature.ptr<float>(0);
+		// Re-use the lattice of the previous Gaussian edge model with the same parameters
+		if (m_pGaussianEdgeModel && m_gaussianSize == m_size && m_gaussianSigma[0] == sigma[0] && m_gaussianSigma[1] == sigma[1]) {
+			m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(*m_pGaussianEdgeModel, weight, semiMetricFunction));
+			return;
+		}
+
+		Mat features(m_size.width * m_size.height, 2, CV_32FC1);
 		for (int y = 0; y < m_size.height; y++) 
 			for (int x = 0; x < m_size.width; x++) {
+				float *pFeature = features.ptr<float>(y * m_size.width + x);
 				pFeature[0] = x / sigma.val[0];
 				pFeature[1] = y / sigma.val[1];
-				features.push_back(feature);
 			} // x
 
-		m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(features, weight, semiMetricFunction));
+		auto pEdgeModel = std::make_shared<CEdgeModelPotts>(features, weight, semiMetricFunction);
+		m_graph.addEdgeModel(pEdgeModel);
+		
+		m_pGaussianEdgeModel	= pEdgeModel;
+		m_gaussianSize			= m_size;
+		m_gaussianSigma			= sigma;
 	}
 
 	void CGraphDenseExt::addBilateralEdgeModel(const Mat &featureVectors, Vec2f sigma, float sigma_opt, float weight, const std::function<void(const Mat& src, Mat& dst)> &semiMetricFunction)
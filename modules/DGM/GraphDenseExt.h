@@ -7,6 +7,7 @@
 namespace DirectGraphicalModels 
 {
 	class CGraphDense;
+	class CEdgeModelPotts;
 	// ================================ Extended Dense Graph Class ================================
 	/**
 	* @brief Extended Dense graph class for 2D image classifaction
@@ -64,6 +65,8 @@ namespace DirectGraphicalModels
 		
 		/**
 		* @brief Add a Gaussian potential model with standard deviation \b sigma
+		* @details The permutohedral lattice of the positional features depends only on the graph size and \b sigma. It is kept between the 
+		* calls, so for a stream of images of the same size the lattice is built only once and shared by the edge models (ref. @ref CEdgeModelPotts).
 		* @param sigma The spatial standard deviation of the 2D-Gaussian filter 
 		* @param weight The weighting parameter
 		* @param semiMetricFunction Reference to a semi-metric function, which arguments \b src and \b dst are: Mat(size: 1 x nFeatures; type: CV_32FC1). 
@@ -95,5 +98,9 @@ namespace DirectGraphicalModels
 	private:
         CGraphDense& m_graph;	///< The graph
         Size         m_size;    ///< Size of the 2D graph
+
+		std::shared_ptr<const CEdgeModelPotts>	m_pGaussianEdgeModel	= nullptr;		///< The last added Gaussian edge model, which lattice may be re-used
+		Size									m_gaussianSize;							///< Graph size of the last added Gaussian edge model
+		Vec2f									m_gaussianSigma;						///< Standard deviation of the last added Gaussian edge model
 	};
 }
@@ -0,0 +1,236 @@
+#include "GraphGrid.h"
+#include "GraphLayeredExt.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	void CGraphGrid::build(Size graphSize, word nLayers, byte gType)
+	{
+		DGM_ASSERT(nLayers >= 1);
+
+		reset();
+		m_size		= graphSize;
+		m_nLayers	= nLayers;
+		m_gType		= gType;
+
+		const size_t nPixels = static_cast<size_t>(m_size.width) * m_size.height;
+		const size_t nNodes  = nPixels * m_nLayers;
+
+		// Number of edges
+		size_t nEdges = 0;
+		if ((m_gType & GRAPH_EDGES_LINK) && (m_nLayers >= 2))
+			nEdges += nPixels * m_nLayers;							// 2 edges between layers 0 and 1, 1 edge between every other layers
+		if ((m_gType & GRAPH_EDGES_GRID) && (nPixels > 0))
+			nEdges += 2 * m_nLayers * ((m_size.width - 1) * m_size.height + m_size.width * (m_size.height - 1));
+		if ((m_gType & GRAPH_EDGES_DIAG) && (nPixels > 0))
+			nEdges += 4 * m_nLayers * (m_size.width - 1) * (m_size.height - 1);
+
+		// Nodes
+		m_vNodePots.assign(nNodes * getNumStates(), 0.0f);
+
+		// Edges
+		m_vEdgeSrc.reserve(nEdges);
+		m_vEdgeDst.reserve(nEdges);
+		m_vEdgeGroup.reserve(nEdges);
+		auto addArc = [this](size_t node1, size_t node2, bool isArc) {
+			m_vEdgeSrc.push_back(node1);
+			m_vEdgeDst.push_back(node2);
+			if (isArc) {
+				m_vEdgeSrc.push_back(node2);
+				m_vEdgeDst.push_back(node1);
+			}
+		};
+
+		// The edges are indexed in the same order, as they are added in CGraphLayeredExt::buildGraph()
+		word l;
+		for (int y = 0; y < m_size.height; y++)
+			for (int x = 0; x < m_size.width; x++) {
+				size_t idx = getNodeIdx(x, y);
+
+				if (m_gType & GRAPH_EDGES_LINK) {
+					if (m_nLayers >= 2)
+						addArc(idx, idx + 1, true);
+					for (l = 2; l < m_nLayers; l++)
+						addArc(idx + l - 1, idx + l, false);
+				} // if LINK
+
+				m_vEdgeGroup.resize(m_vEdgeSrc.size(), 1);					// All links have group_id = 1
+
+				if (m_gType & GRAPH_EDGES_GRID) {
+					if (x > 0)
+						for (l = 0; l < m_nLayers; l++)
+							addArc(idx + l, idx + l - m_nLayers, true);
+					if (y > 0)
+						for (l = 0; l < m_nLayers; l++)
+							addArc(idx + l, idx + l - m_nLayers * m_size.width, true);
+				} // if GRID
+
+				m_vEdgeGroup.resize(m_vEdgeSrc.size(), 0);
+			} // x
+
+		if (m_gType & GRAPH_EDGES_DIAG) {
+			for (int y = 1; y < m_size.height; y++)
+				for (int x = 0; x < m_size.width; x++) {
+					size_t idx = getNodeIdx(x, y);
+
+					if (x > 0)
+						for (l = 0; l < m_nLayers; l++)
+							addArc(idx + l, idx + l - m_nLayers * (m_size.width + 1), true);
+
+					if (x < m_size.width - 1)
+						for (l = 0; l < m_nLayers; l++)
+							addArc(idx + l, idx + l - m_nLayers * (m_size.width - 1), true);
+				} // x
+			m_vEdgeGroup.resize(m_vEdgeSrc.size(), 0);
+		} // if DIAG
+		DGM_ASSERT(m_vEdgeSrc.size() == nEdges);
+
+		m_vEdgeFlags.assign(nEdges, 0);
+
+		// Compressed adjacency
+		updateAdjacency();
+		if (m_pEdgeIndex) enableEdgeIndex(true);
+	}
+
+	void CGraphGrid::reset(void)
+	{
+		CGraphPairwise::reset();
+		m_size = Size(0, 0);
+	}
+
+	size_t CGraphGrid::addNode(const Mat &)
+	{
+		DGM_ASSERT_MSG(false, "The structure of the grid graph may be only created with the CGraphGrid::build() function");
+		return 0;
+	}
+
+	void CGraphGrid::addNodes(const Mat &)
+	{
+		DGM_ASSERT_MSG(false, "The structure of the grid graph may be only created with the CGraphGrid::build() function");
+	}
+
+	void CGraphGrid::getChildNodes(size_t node, vec_size_t &vNodes) const
+	{
+		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
+		getNeighborNodes(node, true, vNodes);
+	}
+
+	void CGraphGrid::getParentNodes(size_t node, vec_size_t &vNodes) const
+	{
+		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
+		getNeighborNodes(node, false, vNodes);
+	}
+
+	void CGraphGrid::addEdge(size_t, size_t, byte, const Mat &)
+	{
+		DGM_ASSERT_MSG(false, "The structure of the grid graph may be only created with the CGraphGrid::build() function");
+	}
+
+	void CGraphGrid::addEdges(const Mat &, const Mat &, const Mat &, bool)
+	{
+		DGM_ASSERT_MSG(false, "The structure of the grid graph may be only created with the CGraphGrid::build() function");
+	}
+
+	void CGraphGrid::removeEdge(size_t, size_t)
+	{
+		DGM_ASSERT_MSG(false, "The edges of the grid graph can not be removed");
+	}
+
+	// ------------------------------ PROTECTED ------------------------------
+	// The index of the edge is calculated from the positions of the nodes in the grid and the order, in which build() creates the edges
+	size_t CGraphGrid::lookupEdge(size_t srcNode, size_t dstNode) const
+	{
+		const word	 L	 = m_nLayers;
+		const word	 l1	 = static_cast<word>(srcNode % L);
+		const word	 l2	 = static_cast<word>(dstNode % L);
+		const size_t p1	 = srcNode / L;
+		const size_t p2	 = dstNode / L;
+		const int	 x1	 = static_cast<int>(p1 % m_size.width);
+		const int	 y1	 = static_cast<int>(p1 / m_size.width);
+		const int	 x2	 = static_cast<int>(p2 % m_size.width);
+		const int	 y2	 = static_cast<int>(p2 / m_size.width);
+
+		// Links: 2 edges between layers 0 and 1, 1 edge (l - 1) --> (l) between every other layers
+		if (p1 == p2) {
+			if (!(m_gType & GRAPH_EDGES_LINK) || L < 2) return EDGE_NONE;
+			if (l2 == l1 + 1) return getGridOffset(x1, y1) + (l1 == 0 ? 0 : l2);
+			if (l2 + 1 == l1 && l1 == 1) return getGridOffset(x1, y1) + 1;
+			return EDGE_NONE;
+		}
+		if (l1 != l2) return EDGE_NONE;
+
+		// Every arc is created by its lower (or for the horizontal arcs - right) node: the edge from this node comes first
+		const int dx = x2 - x1;
+		const int dy = y2 - y1;
+		const size_t a = (m_gType & GRAPH_EDGES_LINK) && L >= 2 ? L : 0;		// number of the links of a pixel
+		if (m_gType & GRAPH_EDGES_GRID) {
+			if (dy == 0 && dx == -1) return getGridOffset(x1, y1) + a + 2 * l1;
+			if (dy == 0 && dx ==  1) return getGridOffset(x2, y2) + a + 2 * l1 + 1;
+			if (dx == 0 && dy == -1) return getGridOffset(x1, y1) + a + (x1 > 0 ? 2 * L : 0) + 2 * l1;
+			if (dx == 0 && dy ==  1) return getGridOffset(x2, y2) + a + (x2 > 0 ? 2 * L : 0) + 2 * l1 + 1;
+		}
+		if (m_gType & GRAPH_EDGES_DIAG) {
+			if (dy == -1 && dx == -1) return getDiagOffset(x1, y1) + 2 * l1;
+			if (dy ==  1 && dx ==  1) return getDiagOffset(x2, y2) + 2 * l1 + 1;
+			if (dy == -1 && dx ==  1) return getDiagOffset(x1, y1) + (x1 > 0 ? 2 * L : 0) + 2 * l1;
+			if (dy ==  1 && dx == -1) return getDiagOffset(x2, y2) + (x2 > 0 ? 2 * L : 0) + 2 * l1 + 1;
+		}
+		return EDGE_NONE;
+	}
+
+	// ------------------------------ PRIVATE ------------------------------
+	// Index of the first edge, created for pixel (x, y) in the pass over the links and the grid edges
+	size_t CGraphGrid::getGridOffset(int x, int y) const
+	{
+		const size_t W = m_size.width;
+		const size_t a = (m_gType & GRAPH_EDGES_LINK) && m_nLayers >= 2 ? m_nLayers : 0;	// links of a pixel
+		const size_t g = (m_gType & GRAPH_EDGES_GRID) ? 2 * m_nLayers : 0;					// edges of a pixel in one direction
+		const size_t X = x;
+		const size_t Y = y;
+
+		size_t res = Y * W * a + X * a;
+		res += g * (Y * (W - 1) + (Y > 0 ? (Y - 1) * W : 0));							// full rows
+		res += g * ((X > 0 ? X - 1 : 0) + (Y > 0 ? X : 0));								// the row of the pixel
+		return res;
+	}
+
+	// Index of the first diagonal edge, created for pixel (x, y), y > 0
+	size_t CGraphGrid::getDiagOffset(int x, int y) const
+	{
+		const size_t W = m_size.width;
+		const size_t L = m_nLayers;
+		const size_t X = x;
+		const size_t Y = y;
+		return getGridOffset(0, m_size.height) + (Y - 1) * 4 * L * (W - 1) + 2 * L * ((X > 0 ? X - 1 : 0) + MIN(X, W - 1));
+	}
+
+	void CGraphGrid::getNeighborNodes(size_t node, bool isChild, vec_size_t &vNodes) const
+	{
+		if (!vNodes.empty()) vNodes.clear();
+
+		const word	 l = static_cast<word>(node % m_nLayers);
+		const size_t p = node / m_nLayers;
+		const int	 x = static_cast<int>(p % m_size.width);
+		const int	 y = static_cast<int>(p / m_size.width);
+
+		// Candidates: the nodes of the neighboring layers and the 8-neighborhood
+		std::pair<size_t, size_t> vCandidates[10];										// (edge, node)
+		size_t nCandidates = 0;
+		auto addCandidate = [&](size_t neighbor) {
+			size_t e = isChild ? lookupEdge(node, neighbor) : lookupEdge(neighbor, node);
+			if (e != EDGE_NONE) vCandidates[nCandidates++] = std::make_pair(e, neighbor);
+		};
+		if (l > 0)				addCandidate(node - 1);
+		if (l + 1 < m_nLayers)	addCandidate(node + 1);
+		for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++) {
+				if (dx == 0 && dy == 0) continue;
+				if (x + dx < 0 || x + dx >= m_size.width || y + dy < 0 || y + dy >= m_size.height) continue;
+				addCandidate(getNodeIdx(x + dx, y + dy, l));
+			}
+
+		// In order of the edges creation
+		std::sort(vCandidates, vCandidates + nCandidates);
+		for (size_t i = 0; i < nCandidates; i++) vNodes.push_back(vCandidates[i].second);
+	}
+}
@@ -0,0 +1,112 @@
+// (pairwise) Grid Graph class interface;
+#pragma once
+
+#include "GraphPairwise.h"
+
+namespace DirectGraphicalModels
+{
+	// ================================ Grid Graph Class ================================
+	/**
+	* @brief Pairwise grid graph class
+	* @details This class represents the 2D (multi-layer) grid graphs with the edge pattern, defined by the @ref graphEdgesType flags.
+	* In contrast to the CGraphPairwise class, the structure of the grid graph is not created by adding the nodes and edges one by one,
+	* but generated at once with the build() function in a single linear pass. No linked lists of edges are kept and no checks for duplicated edges 
+	* are performed. The graph nodes and edges are indexed exactly in the same order as in the graph, built with the CGraphLayeredExt::buildGraph() 
+	* function, thus the grid graph may be used with all the inference classes as a drop-in replacement for the CGraphPairwise class.
+	* The neighbors of a node and the index of the edge between two nodes are calculated in constant time from the positions (x, y, layer) of the 
+	* nodes and the order of the edges creation, without searching the adjacency lists.
+	* @note The grid graph is not implicit: like CGraphPairwise it stores the end nodes of every edge and the compressed adjacency arrays, which are 
+	* used by the inference classes.
+	* @note The structure of the grid graph is fixed: nodes and edges can not be added or removed individually.
+	* @ingroup moduleGraph
+	*/
+	class CGraphGrid : public CGraphPairwise
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param nStates the number of States (classes)
+		*/
+		DllExport CGraphGrid(byte nStates) : CGraphPairwise(nStates), m_size(Size(0, 0)), m_nLayers(1), m_gType(0) {}
+		DllExport virtual ~CGraphGrid(void) = default;
+
+		/**
+		* @brief Builds the grid graph
+		* @details All edges in graph will have group id 0 except the edges connecting different layers (links), which will have group id 1.
+		* The potentials of all nodes are set to zero and the edges have no potentials. When called multiple times, previouse graph structure is always replaced.
+		* @param graphSize The size of the grid (image resolution)
+		* @param nLayers The number of layers
+		* @param gType The graph type. (Ref. @ref graphEdgesType)
+		*/
+		DllExport void		build(Size graphSize, word nLayers = 1, byte gType = 1);
+		/**
+		* @brief Returns the size of the grid
+		* @return The size of the grid
+		*/
+		DllExport Size		getSize(void) const { return m_size; }
+		/**
+		* @brief Returns the number of layers
+		* @return The number of layers
+		*/
+		DllExport word		getNumLayers(void) const { return m_nLayers; }
+		/**
+		* @brief Returns the type of the graph
+		* @returns The type of the graph (Ref. @ref graphEdgesType)
+		*/
+		DllExport byte		getType(void) const { return m_gType; }
+		/**
+		* @brief Returns the index of the node
+		* @param x The column of the grid
+		* @param y The row of the grid
+		* @param layer The layer
+		* @return The index of the node at position (\b x, \b y) in layer \b layer
+		*/
+		DllExport size_t	getNodeIdx(int x, int y, word layer = 0) const { return (static_cast<size_t>(y) * m_size.width + x) * m_nLayers + layer; }
+
+		// CGraph
+		DllExport void		reset(void) override;
+		DllExport size_t	addNode(const Mat &pot = EmptyMat) override;
+		DllExport void		addNodes(const Mat &pots) override;
+		DllExport void		getChildNodes(size_t node, vec_size_t &vNodes) const override;
+		DllExport void		getParentNodes(size_t node, vec_size_t &vNodes) const override;
+
+		// IGraphPairwise
+		DllExport void		addEdge(size_t srcNode, size_t dstNode, byte group, const Mat &pot) override;
+		DllExport void		addEdges(const Mat &srcDst, const Mat &groups = EmptyMat, const Mat &pots = EmptyMat, bool unique = false) override;
+		DllExport void		removeEdge(size_t srcNode, size_t dstNode) override;
+
+
+	protected:
+		size_t				lookupEdge(size_t srcNode, size_t dstNode) const override;
+
+
+	private:
+		/**
+		* @brief Returns the index of the first edge, created for the pixel (\b x, \b y) in the pass over the links and the grid edges
+		* @param x The column of the grid
+		* @param y The row of the grid
+		* @return The index of the edge
+		*/
+		size_t				getGridOffset(int x, int y) const;
+		/**
+		* @brief Returns the index of the first diagonal edge, created for the pixel (\b x, \b y)
+		* @param x The column of the grid
+		* @param y The row of the grid (\b y > 0)
+		* @return The index of the edge
+		*/
+		size_t				getDiagOffset(int x, int y) const;
+		/**
+		* @brief Returns the child or the parent nodes in the order of the edges creation
+		* @param node The node index
+		* @param isChild Flag indicating whether the child (true) or the parent (false) nodes are returned
+		* @param vNodes The resulting nodes
+		*/
+		void				getNeighborNodes(size_t node, bool isChild, vec_size_t &vNodes) const;
+
+
+	private:
+		Size	m_size;			///< Size of the grid
+		word	m_nLayers;		///< Number of layers
+		byte	m_gType;		///< Graph type (Ref. @ref graphEdgesType)
+	};
+}
@@ -11,6 +11,8 @@ namespace DirectGraphicalModels
 		{
 		case DirectGraphicalModels::GraphType::pairwise:
 			return std::make_shared<CGraphPairwiseKit>(nStates);
+		case DirectGraphicalModels::GraphType::grid:
+			return std::make_shared<CGraphPairwiseKit>(nStates, INFER::LBP, true);
 		case DirectGraphicalModels::GraphType::dense:
 			return std::make_shared<CGraphDenseKit>(nStates);
 		default:
@@ -9,6 +9,7 @@ namespace DirectGraphicalModels
 	/// Types of the graphical model
 	enum class GraphType { 
 		pairwise,		///< Pairwise graph
+		grid,			///< Pairwise grid graph
 		dense			///< Dense (complete) graph
 	};
 	
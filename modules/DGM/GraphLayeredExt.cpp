@@ -1,5 +1,7 @@
 #include "GraphLayeredExt.h"
 #include "GraphPairwise.h"
+#include "GraphGrid.h"
+#include "parallel.h"
 
 #include "TrainNode.h"
 #include "TrainEdge.h"
@@ -12,6 +14,14 @@ namespace DirectGraphicalModels
 {
 	void CGraphLayeredExt::buildGraph(Size graphSize)
 	{
+		// Grid graphs are generated at once
+		CGraphGrid *pGraphGrid = dynamic_cast<CGraphGrid *>(&m_graph);
+		if (pGraphGrid) {
+			pGraphGrid->build(graphSize, m_nLayers, m_gType);
+			m_size = graphSize;
+			return;
+		}
+
 		if (m_graph.getNumNodes() != 0) m_graph.reset();
 		m_size = graphSize;
 
@@ -110,7 +120,7 @@ namespace DirectGraphicalModels
 		DGM_ASSERT(nStatesBase + nStatesOccl == m_graph.getNumStates());
 
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&, nStatesBase, nStatesOccl](int y) {
+		parallel::parallel_for(0, m_size.height, [&, nStatesBase, nStatesOccl](int y) {
 			Mat nPotBase(m_graph.getNumStates(), 1, CV_32FC1, Scalar(0.0f));
 			Mat nPotOccl(m_graph.getNumStates(), 1, CV_32FC1, Scalar(0.0f));
 			Mat nPotIntr(m_graph.getNumStates(), 1, CV_32FC1, Scalar(0.0f));
@@ -262,7 +272,7 @@ namespace DirectGraphicalModels
 		DGM_ASSERT(m_size.width * m_size.height * m_nLayers == m_graph.getNumNodes());
 
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&, nFeatures](int y) {
+		parallel::parallel_for(0, m_size.height, [&, nFeatures](int y) {
 			Mat featureVector1(nFeatures, 1, CV_8UC1);
 			Mat featureVector2(nFeatures, 1, CV_8UC1);
 			Mat ePot;
@@ -337,7 +347,7 @@ namespace DirectGraphicalModels
 		DGM_ASSERT(m_size.width * m_size.height * m_nLayers == m_graph.getNumNodes());
 
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&, nFeatures](int y) {
+		parallel::parallel_for(0, m_size.height, [&, nFeatures](int y) {
 			Mat featureVector1(nFeatures, 1, CV_8UC1);
 			Mat featureVector2(nFeatures, 1, CV_8UC1);
 			Mat ePot;
@@ -413,7 +423,7 @@ namespace DirectGraphicalModels
 		DGM_ASSERT_MSG(A != 0 || B != 0, "Wrong arguments");
 
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&](int y) {
+		parallel::parallel_for(0, m_size.height, [&](int y) {
 #else
 		for (int y = 0; y < m_size.height; y++) {
 #endif
@@ -1,38 +1,75 @@
 #include "GraphPairwise.h"
+#include "parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels
 {
 	void CGraphPairwise::reset(void)
 	{
-		m_vNodes.clear();
-		m_vEdges.clear();
-		m_IDx = 0;
+		m_vNodePots.clear();
+		m_vNodeFirstOut.clear();
+		m_vNodeFirstIn.clear();
+
+		m_vEdgeSrc.clear();
+		m_vEdgeDst.clear();
+		m_vEdgeNextOut.clear();
+		m_vEdgeNextIn.clear();
+		m_vEdgeGroup.clear();
+		m_vEdgeFlags.clear();
+		m_nRemovedEdges = 0;
+		m_vEdgePots.clear();
+		m_vGroupPots.clear();
+		m_vGroupModels.clear();
+		m_lastEdge = EDGE_NONE;
+		m_hasEdgePots = false;
+		if (m_pEdgeIndex) m_pEdgeIndex->clear();
+
+		m_isAdjacencyValid = false;
 	}
 
 	// Add a new node to the graph with specified potentional
 	size_t CGraphPairwise::addNode(const Mat &pot)
 	{
-		m_vNodes.push_back(ptr_node_t(new Node(m_IDx, pot))); 
-		return m_IDx++;
+		size_t node = getNumNodes();
+		m_vNodePots.resize(m_vNodePots.size() + getNumStates(), 0.0f);
+		m_vNodeFirstOut.push_back(EDGE_NONE);
+		m_vNodeFirstIn.push_back(EDGE_NONE);
+		m_isAdjacencyValid = false;
+		if (!pot.empty()) setNode(node, pot);
+		return node;
+	}
+
+	void CGraphPairwise::addNodes(const Mat &pots)
+	{
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG(pots.cols == nStates, "The number of columns %d does not match the number of states %d", pots.cols, nStates);
+
+		const size_t first  = getNumNodes();
+		const size_t nNodes = first + pots.rows;
+		m_vNodePots.resize(nNodes * nStates);
+		m_vNodeFirstOut.resize(nNodes, EDGE_NONE);
+		m_vNodeFirstIn.resize(nNodes, EDGE_NONE);
+		m_isAdjacencyValid = false;
+
+		Mat dst(pots.rows, nStates, CV_32FC1, getNodePot(first));
+		pots.convertTo(dst, CV_32FC1);
 	}
 
 	// Set or change the potential of node idx
 	void CGraphPairwise::setNode(size_t node, const Mat &pot)
 	{
-		DGM_ASSERT_MSG(node < m_vNodes.size(), "Node %zu is out of range %zu", node, m_vNodes.size());
+		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
 		DGM_ASSERT_MSG((pot.cols == 1) && (pot.rows == getNumStates()), "Potential size (%d x %d) does not match (%d x %d)", pot.cols, pot.rows, 1, getNumStates());
 
-		if (!m_vNodes[node]->Pot.empty()) m_vNodes[node]->Pot.release();
-		pot.copyTo(m_vNodes[node]->Pot);
+		Mat dst(getNumStates(), 1, CV_32FC1, getNodePot(node));
+		pot.convertTo(dst, CV_32FC1);
 	}
 
-	// Return node potential vector 
+	// Return node potential vector
 	void CGraphPairwise::getNode(size_t node, Mat &pot) const
 	{
-		DGM_ASSERT_MSG(node < m_vNodes.size(), "Node %zu is out of range %zu", node, m_vNodes.size());
-		DGM_ASSERT_MSG(!m_vNodes[node]->Pot.empty(), "Specified node %zu is not set", node);
-		m_vNodes[node]->Pot.copyTo(pot);
+		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
+		Mat(getNumStates(), 1, CV_32FC1, const_cast<float *>(m_vNodePots.data() + node * getNumStates())).copyTo(pot);
 	}
 
 	// Return child nodes ID's
@@ -40,7 +77,8 @@ namespace DirectGraphicalModels
 	{
 		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
 		if (!vNodes.empty()) vNodes.clear();
-		for (size_t e: m_vNodes[node]->to) { vNodes.push_back(m_vEdges[e]->node2); }
+		for (size_t e = m_vNodeFirstOut[node]; e != EDGE_NONE; e = m_vEdgeNextOut[e]) vNodes.push_back(m_vEdgeDst[e]);
+		std::reverse(vNodes.begin(), vNodes.end());			// in order of the edges creation
 	}
 
 	// Return parent nodes ID's
@@ -48,141 +86,485 @@ namespace DirectGraphicalModels
 	{
 		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
 		if (!vNodes.empty()) vNodes.clear();
-		for (size_t e: m_vNodes[node]->from) { vNodes.push_back(m_vEdges[e]->node1); }
+		for (size_t e = m_vNodeFirstIn[node]; e != EDGE_NONE; e = m_vEdgeNextIn[e]) vNodes.push_back(m_vEdgeSrc[e]);
+		std::reverse(vNodes.begin(), vNodes.end());			// in order of the edges creation
 	}
 
 
 	// Add a new (directed) edge to the graph with specified potentional
 	void CGraphPairwise::addEdge(size_t srcNode, size_t dstNode, byte group, const Mat &pot)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
 		// Check if the edge exists
-		if (m_vNodes[srcNode]->to.size() < m_vNodes[dstNode]->from.size())
-			for (size_t &e : m_vNodes[srcNode]->to) { DGM_ASSERT(m_vEdges[e]->node2 != dstNode); }
-		else
-			for (size_t &e : m_vNodes[dstNode]->from) { DGM_ASSERT(m_vEdges[e]->node1 != srcNode); }
+		DGM_ASSERT(findEdge(srcNode, dstNode) == EDGE_NONE);
 
 		// Else: create a new one
-		size_t e = m_vEdges.size();
-		m_vEdges.push_back(ptr_edge_t(new Edge(srcNode, dstNode, group, pot)));
-		m_vNodes[srcNode]->to.push_back(e);
-		m_vNodes[dstNode]->from.push_back(e);
+		size_t e = getNumEdges();
+		m_vEdgeSrc.push_back(srcNode);
+		m_vEdgeDst.push_back(dstNode);
+		m_vEdgeNextOut.push_back(m_vNodeFirstOut[srcNode]);
+		m_vEdgeNextIn.push_back(m_vNodeFirstIn[dstNode]);
+		m_vEdgeGroup.push_back(group);
+		m_vEdgeFlags.push_back(0);
+		if (m_hasEdgePots) m_vEdgePots.resize(m_vEdgePots.size() + getNumStates() * getNumStates());
+		m_vNodeFirstOut[srcNode] = e;
+		m_vNodeFirstIn[dstNode] = e;
+		if (m_pEdgeIndex) m_pEdgeIndex->emplace(std::make_pair(srcNode, dstNode), e);
+		m_isAdjacencyValid = false;
+
+		if (!pot.empty()) setEdge(srcNode, dstNode, pot);
+	}
+
+	void CGraphPairwise::addEdges(const Mat &srcDst, const Mat &groups, const Mat &pots, bool unique)
+	{
+		const byte	 nStates = getNumStates();
+		const size_t potSize = nStates * nStates;
+		DGM_ASSERT_MSG((srcDst.cols == 2) && (srcDst.type() == CV_32SC1), "The block of edges must have 2 columns and type CV_32SC1");
+		if (!groups.empty()) DGM_ASSERT_MSG((groups.rows == srcDst.rows) && (groups.type() == CV_8UC1), "The block of groups does not match the block of edges");
+		if (!pots.empty())   DGM_ASSERT_MSG((pots.rows == srcDst.rows) && (static_cast<size_t>(pots.cols) == potSize), "The block of potentials does not match the block of edges");
+
+		const size_t nNodes	= getNumNodes();
+		const size_t first	= getNumEdges();
+		const size_t size	= srcDst.rows;
+		const size_t nEdges	= first + size;
+
+		// Allocate the storage
+		m_vEdgeSrc.resize(nEdges);
+		m_vEdgeDst.resize(nEdges);
+		m_vEdgeNextOut.resize(nEdges);
+		m_vEdgeNextIn.resize(nEdges);
+		m_vEdgeGroup.resize(nEdges, 0);
+		m_vEdgeFlags.resize(nEdges, 0);
+		if (m_hasEdgePots) m_vEdgePots.resize(nEdges * potSize);
+		
+		Mat Pots;
+		if (!pots.empty()) {
+			pots.convertTo(Pots, CV_32FC1);
+			allocateEdgePots();
+		}
+
+		// Fill the storage
+#ifdef ENABLE_PPL
+		size_t rangeSize = MAX(1, size / (parallel::getNumThreads() * 10));
+#else
+		size_t rangeSize = MAX(1, size);
+#endif
+		parallel::parallel_for(size_t(0), size, rangeSize, [&, first, size, nNodes, potSize, rangeSize](size_t i) {
+			for (size_t k = i; (k < i + rangeSize) && (k < size); k++) {
+				const int	 *pSrcDst = srcDst.ptr<int>(static_cast<int>(k));
+				const size_t  e		  = first + k;
+				DGM_ASSERT_MSG((pSrcDst[0] >= 0) && (static_cast<size_t>(pSrcDst[0]) < nNodes), "The source node index %d is out of range %zu", pSrcDst[0], nNodes);
+				DGM_ASSERT_MSG((pSrcDst[1] >= 0) && (static_cast<size_t>(pSrcDst[1]) < nNodes), "The destination node index %d is out of range %zu", pSrcDst[1], nNodes);
+				m_vEdgeSrc[e] = static_cast<size_t>(pSrcDst[0]);
+				m_vEdgeDst[e] = static_cast<size_t>(pSrcDst[1]);
+				if (!groups.empty()) m_vEdgeGroup[e] = groups.at<byte>(static_cast<int>(k), 0);
+				if (!Pots.empty()) {
+					const float *pPot = Pots.ptr<float>(static_cast<int>(k));
+					std::copy(pPot, pPot + potSize, m_vEdgePots.begin() + e * potSize);
+					m_vEdgeFlags[e] = isPotts(pPot, nStates) ? EDGE_POT | EDGE_POTTS : EDGE_POT;
+				}
+			}
+		});
+
+		// Link the new edges into the adjacency lists
+		for (size_t e = first; e < nEdges; e++) {
+			const size_t src = m_vEdgeSrc[e];
+			const size_t dst = m_vEdgeDst[e];
+			if (!unique) {
+				bool exists = m_pEdgeIndex ? m_pEdgeIndex->count(std::make_pair(src, dst)) > 0 : lookupEdge(src, dst) != EDGE_NONE;
+				DGM_ASSERT_MSG(!exists, "The edge (%zu)->(%zu) already exists", src, dst);
+			}
+			m_vEdgeNextOut[e] = m_vNodeFirstOut[src];
+			m_vEdgeNextIn[e]  = m_vNodeFirstIn[dst];
+			m_vNodeFirstOut[src] = e;
+			m_vNodeFirstIn[dst]  = e;
+			if (m_pEdgeIndex) m_pEdgeIndex->emplace(std::make_pair(src, dst), e);
+		}
+		m_isAdjacencyValid = false;
 	}
 
 	// Set or change the potentional of an directed edge
 	void CGraphPairwise::setEdge(size_t srcNode, size_t dstNode, const Mat &pot)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
+
+		// Setting the edges in the order of their creation does not require lookups (setEdge() may be called concurrently, the hint is only a guess)
+		size_t e = findEdge(srcNode, dstNode, m_lastEdge.load(std::memory_order_relaxed));
+		DGM_ASSERT_MSG(e != EDGE_NONE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		m_lastEdge.store(e, std::memory_order_relaxed);
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		if (pot.empty()) {
+			m_vEdgeFlags[e] &= ~(EDGE_POT | EDGE_SHARED | EDGE_POTTS);
+			return;
+		}
 
-		pot.copyTo(m_vEdges[*e_t]->Pot);
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG((pot.cols == nStates) && (pot.rows == nStates), "Potential size (%d x %d) does not match (%d x %d)", pot.cols, pot.rows, nStates, nStates);
+		allocateEdgePots();
+
+		Mat dst(nStates, nStates, CV_32FC1, m_vEdgePots.data() + e * nStates * nStates);
+		pot.convertTo(dst, CV_32FC1);
+		m_vEdgeFlags[e] = (m_vEdgeFlags[e] & ~(EDGE_SHARED | EDGE_POTTS)) | EDGE_POT;
+		if (isPotts(dst.ptr<float>(), nStates)) m_vEdgeFlags[e] |= EDGE_POTTS;
 	}
 
+	// Set the potential, shared by all edges of the group
 	void CGraphPairwise::setEdges(std::optional<byte> group, const Mat& pot)
 	{
-#ifdef ENABLE_PPL
-		size_t size = m_vEdges.size();
-		size_t rangeSize = size / (concurrency::GetProcessorCount() * 10);
-		rangeSize = MAX(1, rangeSize);
-		//printf("Processors: %d\n", concurrency::GetProcessorCount());
-		concurrency::parallel_for(size_t(0), size, rangeSize, [group, &pot, size, rangeSize, this](size_t i) {
-			for (int j = 0; (j < rangeSize) && (i + j < size); j++) {
-				ptr_edge_t& pEdge = m_vEdges[i + j];
-				if (!group || pEdge->group_id == group.value())
-					pot.copyTo(pEdge->Pot);
-			}
-		});
-#else 			
-		for (ptr_edge_t& pEdge : m_vEdges) {
-			if(!group || pEdge->group_id == group.value())
-					pot.copyTo(pEdge->Pot);	
-		}
-#endif
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG((pot.cols == nStates) && (pot.rows == nStates), "Potential size (%d x %d) does not match (%d x %d)", pot.cols, pot.rows, nStates, nStates);
+
+		vec_float_t vPot(nStates * nStates);
+		Mat dst(nStates, nStates, CV_32FC1, vPot.data());
+		pot.convertTo(dst, CV_32FC1);
+
+		setGroupPot(group, vPot, isPotts(vPot.data(), nStates) ? EdgePotModel::Potts : EdgePotModel::dense);
+	}
+
+	// Set the parametric potential, shared by all edges of the group
+	void CGraphPairwise::setEdges(std::optional<byte> group, EdgePotModel model, float lambda, float tau)
+	{
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG(lambda >= 0 && tau >= 0, "The parameters of the edge potential model must be non-negative");
+
+		vec_float_t vPot(nStates * nStates);
+		for (byte y = 0; y < nStates; y++)
+			for (byte x = 0; x < nStates; x++) {
+				const float d = static_cast<float>(std::abs(x - y));
+				float energy = 0;
+				switch (model) {
+					case EdgePotModel::Potts:				energy = x == y ? 0 : lambda;		break;
+					case EdgePotModel::truncatedLinear:		energy = MIN(lambda * d, tau);		break;
+					case EdgePotModel::truncatedQuadratic:	energy = MIN(lambda * d * d, tau);	break;
+					default: DGM_ASSERT_MSG(false, "The dense edge potentials must be set with the potential matrix");
+				}
+				vPot[y * nStates + x] = expf(-energy);
+			} // x
+
+		if (model == EdgePotModel::Potts && !isPotts(vPot.data(), nStates)) model = EdgePotModel::dense;
+		setGroupPot(group, vPot, model, lambda, tau);
 	}
 
 	// Return edge potential matrix
 	void CGraphPairwise::getEdge(size_t srcNode, size_t dstNode, Mat &pot) const
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
+
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != EDGE_NONE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
-		if (m_vEdges[*e_t]->Pot.empty()) {
+		const float *pPot = getEdgePot(e);
+		if (!pPot) {
  			DGM_WARNING("Edge Potential is empty");
 			if (!pot.empty()) pot.release();
-		} else m_vEdges[*e_t]->Pot.copyTo(pot);
+		} else Mat(getNumStates(), getNumStates(), CV_32FC1, const_cast<float *>(pPot)).copyTo(pot);
 	}
 
 	void CGraphPairwise::setEdgeGroup(size_t srcNode, size_t dstNode, byte group)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
-		m_vEdges[*e_t]->group_id = group;
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != EDGE_NONE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		if (m_vEdgeGroup[e] == group) return;
+		
+		unshareEdgePot(e);								// the edge keeps its potential
+		m_vEdgeGroup[e] = group;
 	}
 
 	byte CGraphPairwise::getEdgeGroup(size_t srcNode, size_t dstNode) const
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != EDGE_NONE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
 
-		return m_vEdges[*e_t]->group_id;
+		return m_vEdgeGroup[e];
 	}
 
 	void CGraphPairwise::removeEdge(size_t srcNode, size_t dstNode)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
-
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != EDGE_NONE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
 
-		removeEdge(*e_t);
+		removeEdge(e);
 	}
 
 	bool CGraphPairwise::isEdgeExists(size_t srcNode, size_t dstNode) const
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
+
+		return findEdge(srcNode, dstNode) != EDGE_NONE;
+	}
+
+	void CGraphPairwise::enableEdgeIndex(bool enable)
+	{
+		if (!enable) {
+			m_pEdgeIndex.reset();
+			return;
+		}
+
+		if (!m_pEdgeIndex) m_pEdgeIndex = std::make_unique<edge_index_t>();
+		else m_pEdgeIndex->clear();
+		m_pEdgeIndex->reserve(getNumEdges());
+		for (size_t e = 0; e < getNumEdges(); e++)
+			if (!(m_vEdgeFlags[e] & EDGE_REMOVED)) m_pEdgeIndex->emplace(std::make_pair(m_vEdgeSrc[e], m_vEdgeDst[e]), e);
+	}
+
+
+	void CGraphPairwise::compact(void)
+	{
+		if (m_nRemovedEdges == 0) return;
 		
-		auto e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
+		const size_t nNodes = getNumNodes();
+		const size_t nEdges = getNumEdges();
+		const size_t potSize = getNumStates() * getNumStates();
+
+		// New indexes of the remaining edges
+		vec_size_t vNewIdx(nEdges, EDGE_NONE);
+		size_t nNewEdges = 0;
+		for (size_t e = 0; e < nEdges; e++)
+			if (!(m_vEdgeFlags[e] & EDGE_REMOVED)) vNewIdx[e] = nNewEdges++;
+		auto remap = [&vNewIdx](size_t e) { return e == EDGE_NONE ? EDGE_NONE : vNewIdx[e]; };
+
+		// Shift the remaining edges to the front (the new index never exceeds the old one)
+		for (size_t e = 0; e < nEdges; e++) {
+			const size_t e_new = vNewIdx[e];
+			if (e_new == EDGE_NONE) continue;
+			m_vEdgeSrc[e_new]	  = m_vEdgeSrc[e];
+			m_vEdgeDst[e_new]	  = m_vEdgeDst[e];
+			m_vEdgeNextOut[e_new] = remap(m_vEdgeNextOut[e]);
+			m_vEdgeNextIn[e_new]  = remap(m_vEdgeNextIn[e]);
+			m_vEdgeGroup[e_new]	  = m_vEdgeGroup[e];
+			m_vEdgeFlags[e_new]	  = m_vEdgeFlags[e];
+			if (m_hasEdgePots && e_new != e)
+				std::copy(m_vEdgePots.begin() + e * potSize, m_vEdgePots.begin() + (e + 1) * potSize, m_vEdgePots.begin() + e_new * potSize);
+		}
+		for (size_t n = 0; n < nNodes; n++) {
+			m_vNodeFirstOut[n] = remap(m_vNodeFirstOut[n]);
+			m_vNodeFirstIn[n]  = remap(m_vNodeFirstIn[n]);
+		}
+
+		// Release the memory
+		m_vEdgeSrc.resize(nNewEdges);		m_vEdgeSrc.shrink_to_fit();
+		m_vEdgeDst.resize(nNewEdges);		m_vEdgeDst.shrink_to_fit();
+		m_vEdgeNextOut.resize(nNewEdges);	m_vEdgeNextOut.shrink_to_fit();
+		m_vEdgeNextIn.resize(nNewEdges);	m_vEdgeNextIn.shrink_to_fit();
+		m_vEdgeGroup.resize(nNewEdges);		m_vEdgeGroup.shrink_to_fit();
+		m_vEdgeFlags.resize(nNewEdges);		m_vEdgeFlags.shrink_to_fit();
+		if (m_hasEdgePots) {
+			m_vEdgePots.resize(nNewEdges * potSize);
+			m_vEdgePots.shrink_to_fit();
+		}
 
-		if (e_t == m_vNodes[srcNode]->to.cend()) return false;
-		else									 return true;
+		m_nRemovedEdges = 0;
+		m_isAdjacencyValid = false;
+		if (m_pEdgeIndex) enableEdgeIndex(true);
 	}
 
 
     // ------------------------------ PRIVATE ------------------------------
-	///@todo Optimize the edge removement
+	void CGraphPairwise::updateAdjacency(void)
+	{
+		if (m_isAdjacencyValid) return;
+		compact();
+
+		const size_t nNodes = getNumNodes();
+		const size_t nEdges = getNumEdges();
+
+		// Count the edges of every node
+		m_vOutOffset.assign(nNodes + 1, 0);
+		m_vInOffset.assign(nNodes + 1, 0);
+		for (size_t e = 0; e < nEdges; e++) {
+			if (m_vEdgeFlags[e] & EDGE_REMOVED) continue;
+			m_vOutOffset[m_vEdgeSrc[e] + 1]++;
+			m_vInOffset[m_vEdgeDst[e] + 1]++;
+		}
+		for (size_t n = 0; n < nNodes; n++) {
+			m_vOutOffset[n + 1] += m_vOutOffset[n];
+			m_vInOffset[n + 1] += m_vInOffset[n];
+		}
+
+		// Distribute the edges (in ascending order)
+		m_vOutEdges.resize(m_vOutOffset[nNodes]);
+		m_vInEdges.resize(m_vInOffset[nNodes]);
+		vec_size_t vOutPos(m_vOutOffset.begin(), m_vOutOffset.end() - 1);
+		vec_size_t vInPos(m_vInOffset.begin(), m_vInOffset.end() - 1);
+		for (size_t e = 0; e < nEdges; e++) {
+			if (m_vEdgeFlags[e] & EDGE_REMOVED) continue;
+			m_vOutEdges[vOutPos[m_vEdgeSrc[e]]++] = e;
+			m_vInEdges[vInPos[m_vEdgeDst[e]]++] = e;
+		}
+
+		m_vvNodeColors.clear();
+		m_isAdjacencyValid = true;
+	}
+
+	const std::vector<vec_size_t> & CGraphPairwise::colorNodes(void) const
+	{
+		const size_t nNodes = getNumNodes();
+		std::vector<vec_size_t> &vvNodes = m_vvNodeColors;
+		if (!vvNodes.empty() || nNodes == 0) return vvNodes;
+
+		vec_size_t vColor(nNodes, 0);
+		vec_size_t vUsed;															// vUsed[color] == n + 1 if the color is used by a neighbor of node n
+		for (size_t n = 0; n < nNodes; n++) {
+			auto markNeighbor = [&](size_t neighbor) {
+				if (neighbor < n) vUsed[vColor[neighbor]] = n + 1;					// only the preceding nodes are colored
+			};
+			for (size_t e : getInEdges(n))  markNeighbor(m_vEdgeSrc[e]);
+			for (size_t e : getOutEdges(n)) markNeighbor(m_vEdgeDst[e]);
+
+			size_t color = 0;
+			while (color < vUsed.size() && vUsed[color] == n + 1) color++;
+			if (color == vvNodes.size()) {
+				vvNodes.emplace_back();
+				vUsed.push_back(0);
+			}
+			vColor[n] = color;
+			vvNodes[color].push_back(n);
+		} // n
+		return vvNodes;
+	}
+
+	size_t CGraphPairwise::findEdge(size_t srcNode, size_t dstNode, size_t hint) const
+	{
+		// The hint edge and the edge, created after it
+		auto isEdge = [&](size_t e) { 
+			return e < getNumEdges() && m_vEdgeSrc[e] == srcNode && m_vEdgeDst[e] == dstNode && !(m_vEdgeFlags[e] & EDGE_REMOVED); 
+		};
+		if (hint != EDGE_NONE) {
+			if (isEdge(hint + 1)) return hint + 1;
+			if (isEdge(hint))	  return hint;
+		}
+
+		if (m_pEdgeIndex) {
+			auto it = m_pEdgeIndex->find(std::make_pair(srcNode, dstNode));
+			return (it == m_pEdgeIndex->end()) ? EDGE_NONE : it->second;
+		}
+		return lookupEdge(srcNode, dstNode);
+	}
+
+	size_t CGraphPairwise::lookupEdge(size_t srcNode, size_t dstNode) const
+	{
+		for (size_t e = m_vNodeFirstOut[srcNode]; e != EDGE_NONE; e = m_vEdgeNextOut[e])
+			if (m_vEdgeDst[e] == dstNode) return e;
+		return EDGE_NONE;
+	}
+
 	void CGraphPairwise::removeEdge(size_t edge)
 	{
-		DGM_ASSERT_MSG(edge < m_vEdges.size(), "Edge %zu is out of range %zu", edge, m_vEdges.size());
+		DGM_ASSERT_MSG(edge < getNumEdges(), "Edge %zu is out of range %zu", edge, getNumEdges());
+		DGM_ASSERT_MSG(!(m_vEdgeFlags[edge] & EDGE_REMOVED), "Edge %zu is already removed", edge);
+
+		// Unlink from the outgoing edges of the source node
+		size_t *pE = &m_vNodeFirstOut[m_vEdgeSrc[edge]];
+		while (*pE != edge) {
+			DGM_ASSERT(*pE != EDGE_NONE);
+			pE = &m_vEdgeNextOut[*pE];
+		}
+		*pE = m_vEdgeNextOut[edge];
 
-		size_t srcNode = m_vEdges[edge]->node1;
-		size_t dstNode = m_vEdges[edge]->node2;
+		// Unlink from the incoming edges of the destination node
+		pE = &m_vNodeFirstIn[m_vEdgeDst[edge]];
+		while (*pE != edge) {
+			DGM_ASSERT(*pE != EDGE_NONE);
+			pE = &m_vEdgeNextIn[*pE];
+		}
+		*pE = m_vEdgeNextIn[edge];
 
-		m_vEdges[edge]->Pot.release();
-		//m_vEdges.erase(m_vEdges.begin() + edge);
-		
-		vec_size_t::const_iterator e_t = std::find(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), edge);
-		DGM_ASSERT(e_t != m_vNodes[srcNode]->to.cend());
-		m_vNodes[srcNode]->to.erase(e_t);
-		
-		vec_size_t::const_iterator e_f = std::find(m_vNodes[dstNode]->from.cbegin(), m_vNodes[dstNode]->from.cend(), edge);
-		DGM_ASSERT(e_f != m_vNodes[dstNode]->from.cend());
-		m_vNodes[dstNode]->from.erase(e_f);
+		if (m_pEdgeIndex) m_pEdgeIndex->erase(std::make_pair(m_vEdgeSrc[edge], m_vEdgeDst[edge]));
+		m_vEdgeFlags[edge] = EDGE_REMOVED;
+		m_nRemovedEdges++;
+		m_isAdjacencyValid = false;
+	}
+
+	void CGraphPairwise::unshareEdgePot(size_t edge)
+	{
+		if (!(m_vEdgeFlags[edge] & EDGE_SHARED)) return;
+
+		const byte nStates = getNumStates();
+		allocateEdgePots();
+
+		const vec_float_t &vPot = m_vGroupPots[m_vEdgeGroup[edge]];
+		std::copy(vPot.begin(), vPot.end(), m_vEdgePots.begin() + edge * nStates * nStates);
+		m_vEdgeFlags[edge] &= ~(EDGE_SHARED | EDGE_POTTS);
+		if (isPotts(vPot.data(), nStates)) m_vEdgeFlags[edge] |= EDGE_POTTS;
 	}
-}
 
+	void CGraphPairwise::setGroupPot(std::optional<byte> group, const vec_float_t &vPot, EdgePotModel model, float lambda, float tau)
+	{
+		// Store the potential once per group
+		if (m_vGroupPots.empty()) {
+			m_vGroupPots.resize(256);
+			m_vGroupModels.resize(256, { EdgePotModel::dense, 0, 0 });
+		}
+		const GroupModel groupModel = { model, lambda, tau };
+		if (group) {
+			m_vGroupPots[group.value()] = vPot;
+			m_vGroupModels[group.value()] = groupModel;
+		} else {
+			vec_bool_t vUsed(m_vGroupPots.size(), false);
+			for (size_t e = 0; e < getNumEdges(); e++)
+				if (!(m_vEdgeFlags[e] & EDGE_REMOVED)) vUsed[m_vEdgeGroup[e]] = true;
+			for (size_t g = 0; g < vUsed.size(); g++)
+				if (vUsed[g]) {
+					m_vGroupPots[g] = vPot;
+					m_vGroupModels[g] = groupModel;
+				}
+		}
+
+		// Let the edges refer to the shared potential
+#ifdef ENABLE_PPL
+		size_t size = getNumEdges();
+		size_t rangeSize = size / (parallel::getNumThreads() * 10);
+		rangeSize = MAX(1, rangeSize);
+		parallel::parallel_for(size_t(0), size, rangeSize, [group, size, rangeSize, this](size_t i) {
+			for (size_t e = i; (e < i + rangeSize) && (e < size); e++) {
+				if (m_vEdgeFlags[e] & EDGE_REMOVED) continue;
+				if (!group || m_vEdgeGroup[e] == group.value()) 
+					m_vEdgeFlags[e] |= EDGE_POT | EDGE_SHARED;
+			}
+		});
+#else
+		for (size_t e = 0; e < getNumEdges(); e++) {
+			if (m_vEdgeFlags[e] & EDGE_REMOVED) continue;
+			if (!group || m_vEdgeGroup[e] == group.value()) 
+				m_vEdgeFlags[e] |= EDGE_POT | EDGE_SHARED;
+		}
+#endif
+	}
+
+	bool CGraphPairwise::isPotts(const float *pot, byte nStates)
+	{
+		if (nStates < 3) return false;
+		for (byte y = 0; y < nStates; y++) {
+			const float *pPot = pot + y * nStates;
+			const float  off  = pPot[y == 0 ? 1 : 0];
+			for (byte x = 0; x < nStates; x++)
+				if (x != y && pPot[x] != off) return false;
+		}
+		return true;
+	}
+
+	void CGraphPairwise::allocateEdgePots(void)
+	{
+		if (m_hasEdgePots.load(std::memory_order_acquire)) return;
+
+		std::lock_guard<std::mutex> lock(m_mtxEdgePots);
+		if (!m_hasEdgePots.load(std::memory_order_relaxed)) {
+			m_vEdgePots.resize(getNumEdges() * getNumStates() * getNumStates());
+			m_hasEdgePots.store(true, std::memory_order_release);
+		}
+	}
+}
@@ -3,58 +3,71 @@
 #pragma once
 
 #include "IGraphPairwise.h"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
 namespace DirectGraphicalModels
 {
-	// =============================== Node Structure ==============================
+	// ============================= Edge Range Structure =============================
 	/**
-	* @brief %Node structure
-	* @details Basic info for each node.
+	* @brief %Edge range structure
+	* @details Light-weight view of a continuous range of edge indexes in the compressed adjacency arrays of the CGraphPairwise class.
+	* Allows to iterate over the incoming or outgoing edges of a node with a range-based for-loop.
 	*/
-	struct Node {
-		size_t		id;		    ///< %Node ID
-		Mat			Pot;	    ///< %Node potentials: Mat(size: nStates x 1; type: CV_32FC1)
-		byte		sol;
-		vec_size_t	to;		    ///< Array of edge ids, pointing to the Child vertices
-		vec_size_t	from;	    ///< Array of edge ids, coming from the Parent vertices
-
-		Node(void) = delete;
-		Node(size_t _id, const Mat &p = EmptyMat) : id(_id), Pot(p.empty() ? Mat() : p.clone()), sol(0) {}
+	struct EdgeRange {
+		const size_t * first;		///< Pointer to the first edge index in range
+		const size_t * last;		///< Pointer to the edge index one past the last edge index in range
+
+		const size_t * begin(void) const { return first; }
+		const size_t * end(void) const { return last; }
+		size_t		   size(void) const { return static_cast<size_t>(last - first); }
+		bool		   empty(void) const { return first == last; }
 	};
-	using ptr_node_t = std::unique_ptr<Node>;
-	using vec_node_t = std::vector<ptr_node_t>;
 
-	// =============================== Edge Structure ==============================
+	// ============================ Edge Potential Models ============================
 	/**
-	* @brief %Edge structure
-	* @details Basic item stored in adjacency list.
+	* @brief Models of the edge potentials
+	* @details The message passing inference algorithms exploit the structure of the parametric edge potentials and calculate the messages 
+	* in \a O(nStates) instead of \a O(nStates<sup>2</sup>) time. Here \f$\lambda\f$ and \f$\tau\f$ are the parameters of the model and 
+	* \f$x\f$ and \f$y\f$ are the states of the two nodes, connected with the edge.
 	*/
-	struct Edge {
-		size_t	  node1;		///< First (source) node in edge
-		size_t	  node2;		///< Second (destination) node in edge
-		Mat		  Pot;			///< The edge potentials: Mat(size: nStates x nStates; type: CV_32FC1)
-		byte	  group_id;		///< ID of the group, to which the edge belongs
-
-		Edge(void) = delete;
-		Edge(size_t n1, size_t n2, byte group = 0, const Mat &p = EmptyMat) : node1(n1), node2(n2), Pot(p.empty() ? Mat() : p.clone()), group_id(group) {}
+	enum class EdgePotModel : byte {
+		dense,					///< Arbitrary matrix
+		Potts,					///< Potts model: \f$\exp(-\lambda[x\neq y])\f$. Every matrix with equal off-diagonal elements in each row is treated as a Potts potential
+		truncatedLinear,		///< Truncated linear model: \f$\exp(-\min(\lambda|x - y|, \tau))\f$
+		truncatedQuadratic		///< Truncated quadratic model: \f$\exp(-\min(\lambda(x - y)^2, \tau))\f$
 	};
-	using	ptr_edge_t = std::unique_ptr<Edge>;
-	using	vec_edge_t = std::vector<ptr_edge_t>;
 
 	// ================================ Graph Class ================================
 	/**
 	* @brief Pairwise graph class
+	* @details The graph is stored in a structure-of-arrays manner: the potentials of all nodes are kept in one continuous block of
+	* \a nNodes x \a nStates values and the potentials of all edges - in one continuous block of \a nEdges x \a nStates<sup>2</sup> values. 
+	* The edges, whose potentials were assigned with the setEdges() function, do not store their own copies of the potential matrix, but refer to
+	* a single matrix, shared by all edges of the same group. This allows to keep large homogeneous graphs (\a e.g. grids with Potts potentials)
+	* in memory with only \a nStates<sup>2</sup> values per edge group. An edge receives its own copy as soon as it is modified individually.
+	* While the graph is being built, the adjacency is maintained with the linked lists of edge indexes, which are also stored in flat arrays. 
+	* Before the inference, these lists are compressed into the CSR (compressed sparse row) arrays, which allow the message passing algorithms
+	* to iterate over the incoming and outgoing edges of every node with linear scans.
 	* @ingroup moduleGraph
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CGraphPairwise : public IGraphPairwise
 	{
+		friend class CDecodeICM;
 		friend class CMessagePassing;
 		friend class CInferChain;
+		friend class CInferGraphCut;
+		friend class CInferJunctionTree;
 		friend class CInferTree;
 		friend class CInferLBP;
+		friend class CInferMeanField;
 		friend class CInferViterbi;
 		friend class CInferTRW;
+		friend class CInferMultiScaleBP;
+		friend class CInferRedBlackBP;
+		friend class CInferResidualBP;
 
         
 	public:
@@ -62,51 +75,254 @@ namespace DirectGraphicalModels
 		* @brief Constructor
 		* @param nStates the number of States (classes)
 		*/
-		DllExport CGraphPairwise(byte nStates) : IGraphPairwise(nStates), m_IDx(0) {}
+		DllExport CGraphPairwise(byte nStates) : IGraphPairwise(nStates), m_nRemovedEdges(0), m_lastEdge(EDGE_NONE), m_hasEdgePots(false), m_isAdjacencyValid(false) {}
         DllExport virtual ~CGraphPairwise(void) = default;
 
 		// CGraph
 		DllExport void		reset(void) override;
 		DllExport size_t	addNode		  (const Mat &pot = EmptyMat) override;
+		/**
+		* @brief Adds the graph nodes with potentials
+		* @details The storage for the new nodes is allocated at once
+		* @param pots A block of potentials: Mat(size: nNodes x nStates; type: CV_32FC1)
+		*/
+		DllExport void		addNodes	  (const Mat &pots) override;
 		DllExport void		setNode       (size_t node, const Mat &pot) override;
 		DllExport void		getNode       (size_t node, Mat &pot) const override;
 		DllExport void		getChildNodes (size_t node, vec_size_t &vNodes) const override;
 		DllExport void		getParentNodes(size_t node, vec_size_t &vNodes) const override;
-		DllExport size_t	getNumNodes(void) const override { return m_vNodes.size(); }
-		DllExport size_t	getNumEdges(void) const override { return m_vEdges.size(); } 
+		DllExport size_t	getNumNodes(void) const override { return m_vNodePots.size() / getNumStates(); }
+		/**
+		* @brief Returns the number of edges
+		* @note The removed edges are counted until the graph is compacted (Ref. compact())
+		* @return The number of edges
+		*/
+		DllExport size_t	getNumEdges(void) const override { return m_vEdgeSrc.size(); } 
 		
 //     DllExport virtual void      marginalize(const vec_size_t &nodes);
 		
 		DllExport void		addEdge		(size_t srcNode, size_t dstNode, byte group, const Mat &pot) override;
+		/**
+		* @brief Adds a block of new directed edges
+		* @details The storage for the new edges is allocated at once and filled in parallel; only the linking of the new edges into the adjacency lists is sequential.
+		* > This function supports PPL
+		* @param srcDst A block of edges: Mat(size: nEdges x 2; type: CV_32SC1), where every row contains the indexes of the source and destination nodes
+		* @param groups A block of the edge group IDs: Mat(size: nEdges x 1; type: CV_8UC1). If empty, all new edges are added to group 0
+		* @param pots A block of edge potentials: Mat(size: nEdges x nStates<sup>2</sup>; type: CV_32FC1), where every row contains a row-major edge potential matrix.
+		* If empty, the new edges have no potentials
+		* @param unique Flag indicating whether the caller guarantees that the new edges do not exist in the graph and are not duplicated in \b srcDst. 
+		* In this case the duplicate checks are skipped
+		*/
+		DllExport void		addEdges	(const Mat &srcDst, const Mat &groups = EmptyMat, const Mat &pots = EmptyMat, bool unique = false) override;
 		DllExport void		setEdge		(size_t srcNode, size_t dstNode, const Mat &pot) override;
 		DllExport void		setEdges	(std::optional<byte> group, const Mat& pot) override;
+		/**
+		* @brief Sets the parametric potential, shared by all edges of the group
+		* @details The potential matrix is generated from the model, thus the edges may be used as usual, but the message passing inference
+		* algorithms calculate the max-product messages along these edges in \a O(nStates) time with the distance transform.
+		* If a potential of an edge is later modified individually, it looses its parametric representation. 
+		* @param group The edge group ID. If not specified, the potential is set to all edges of all groups
+		* @param model The model of the potential
+		* @param lambda The weight \f$\lambda\f$ of the model
+		* @param tau The truncation threshold \f$\tau\f$ of the model (not used by the Potts model)
+		*/
+		DllExport void		setEdges	(std::optional<byte> group, EdgePotModel model, float lambda, float tau = std::numeric_limits<float>::infinity());
 		DllExport void		getEdge		(size_t srcNode, size_t dstNode, Mat &pot) const override;
 		DllExport void		setEdgeGroup(size_t srcNode, size_t dstNode, byte group) override;
 		DllExport byte		getEdgeGroup(size_t srcNode, size_t dstNode) const override;
 		DllExport void		removeEdge	(size_t srcNode, size_t dstNode) override;
 		DllExport bool		isEdgeExists(size_t srcNode, size_t dstNode) const override;
 
-#ifdef DEBUG_MODE
 		/**
-		* @brief Returns the edge container
-		* @warning Using this function is not safe. It is added exclusively for the debugging purposes.
-		* @return The edge container.
+		* @brief Enables or disables the hashed edge index
+		* @details By default an edge (\a srcNode) --> (\a dstNode) is looked up by scanning all the edges, coming out of the node \a srcNode,
+		* which is fast for graphs with low node degrees. For graphs with high node degrees the hashed index of edges may be enabled, which makes 
+		* all the edge lookups (\a e.g. in setEdge(), getEdge(), isEdgeExists() and in the duplicate check of addEdge()) constant-time 
+		* at the cost of additional memory.
+		* @note Independently of the index, lookups of the edges, which are visited in the order of their creation (\a e.g. in CGraphLayeredExt::fillEdges()),
+		* take constant time.
+		* @param enable Flag indicating whether the index should be used
+		*/
+		DllExport void		enableEdgeIndex(bool enable = true);
+		/**
+		* @brief Compacts the graph
+		* @details The removed edges (\a e.g. by removeEdge() or marginalize()) are not deleted immediately, but only marked as removed. This function 
+		* deletes them and renumbers the remaining edges, such that the memory used for the edges and the messages during the inference 
+		* shrinks with the number of the remaining edges. The order of the remaining edges is preserved.
+		* @note This function is called automatically before the inference
 		*/
-		DllExport vec_edge_t* getEdgesContainer(void) { return &m_vEdges; }
-#endif
+		DllExport void		compact(void);
+
 
-	private:
+	protected:
+		/**
+		* @brief Returns the potential of the node
+		* @param node index of the node
+		* @return The pointer to \a nStates node potentials
+		*/
+		float		* getNodePot(size_t node) { return m_vNodePots.data() + node * getNumStates(); }
+		/**
+		* @brief Returns the potential of the edge
+		* @param edge index of the edge
+		* @details For the edges, sharing the potential of their group, the pointer to the shared matrix is returned
+		* @return The pointer to the \a nStates x \a nStates edge potential matrix (row-major) if the potential is set, NULL otherwise
+		*/
+		const float	* getEdgePot(size_t edge) const 
+		{
+			const byte flags = m_vEdgeFlags[edge];
+			if (!(flags & EDGE_POT))	return NULL;
+			if (flags & EDGE_SHARED)	return m_vGroupPots[m_vEdgeGroup[edge]].data();
+			return m_vEdgePots.data() + edge * getNumStates() * getNumStates();
+		}
+		/**
+		* @brief Returns the model of the edge potential
+		* @param edge index of the edge
+		* @return The model of the edge potential (only valid if the potential is set)
+		*/
+		EdgePotModel  getEdgePotModel(size_t edge) const 
+		{
+			const byte flags = m_vEdgeFlags[edge];
+			if (flags & EDGE_SHARED)	return m_vGroupModels[m_vEdgeGroup[edge]].model;
+			return (flags & EDGE_POTTS) ? EdgePotModel::Potts : EdgePotModel::dense;
+		}
+		/**
+		* @brief Returns the parameters of the truncated edge potential
+		* @param edge index of the edge
+		* @return The pair (\f$\lambda\f$, \f$\tau\f$) (only valid for the truncated models)
+		*/
+		std::pair<float, float> getEdgePotParams(size_t edge) const 
+		{ 
+			const auto &params = m_vGroupModels[m_vEdgeGroup[edge]];
+			return std::make_pair(params.lambda, params.tau);
+		}
+		/**
+		* @brief Checks whether the potential matrix has the Potts structure
+		* @details The matrix has the Potts structure if in each row all the off-diagonal elements are equal. The matrices for less than 3 states 
+		* are not considered, since the dense message calculation is not slower for them.
+		* @param pot The \a nStates x \a nStates potential matrix (row-major)
+		* @param nStates The number of states
+		* @retval true if the matrix has the Potts structure
+		* @retval false otherwise
+		*/
+		static bool	  isPotts(const float *pot, byte nStates);
+		/**
+		* @brief Returns the indexes of all edges, coming to the node
+		* @details The result is only valid after a call to updateAdjacency() and till the next modification of the graph structure
+		* @param node index of the node
+		* @return The range of edge indexes
+		*/
+		EdgeRange	  getInEdges(size_t node) const { return { m_vInEdges.data() + m_vInOffset[node], m_vInEdges.data() + m_vInOffset[node + 1] }; }
+		/**
+		* @brief Returns the indexes of all edges, coming out of the node
+		* @details The result is only valid after a call to updateAdjacency() and till the next modification of the graph structure
+		* @param node index of the node
+		* @return The range of edge indexes
+		*/
+		EdgeRange	  getOutEdges(size_t node) const { return { m_vOutEdges.data() + m_vOutOffset[node], m_vOutEdges.data() + m_vOutOffset[node + 1] }; }
+		/**
+		* @brief Builds the compressed (CSR) adjacency arrays
+		* @details This function does nothing if the graph structure was not modified since the last call. Otherwise it compacts the graph first.
+		* The edge indexes of every node are stored in ascending order.
+		*/
+		void		  updateAdjacency(void);
+		/**
+		* @brief Colors the nodes of the graph
+		* @details The nodes are colored greedily in the order of their indexes with the smallest color, not used by their neighbors, 
+		* thus no two adjacent nodes get the same color. For the 4-connected grids the coloring results in the red-black checkerboard pattern.
+		* The result is only valid after a call to updateAdjacency(). The coloring is computed once and kept until the structure of the graph changes.
+		* @return The indexes of the nodes of every color
+		*/
+		const std::vector<vec_size_t> & colorNodes(void) const;
+		/**
+		* @brief Finds the edge
+		* @details Checks first whether the edge is the \b hint edge or the edge, created next to it. Thus sequential visiting of the edges in the 
+		* order of their creation, with the previously found edge as the hint, does not require lookups. Otherwise the hashed edge index (if enabled) 
+		* or lookupEdge() is used.
+		* @param srcNode index of the source node
+		* @param dstNode index of the destination node
+		* @param hint index of the edge, which is expected to precede the searched edge, or \a EDGE_NONE
+		* @return The index of the edge (\b srcNode) --> (\b dstNode) if exists, \a EDGE_NONE otherwise
+		*/
+		size_t		  findEdge(size_t srcNode, size_t dstNode, size_t hint = EDGE_NONE) const;
+		/**
+		* @brief Looks the edge up among the outgoing edges of the source node
+		* @param srcNode index of the source node
+		* @param dstNode index of the destination node
+		* @return The index of the edge (\b srcNode) --> (\b dstNode) if exists, \a EDGE_NONE otherwise
+		*/
+		virtual size_t lookupEdge(size_t srcNode, size_t dstNode) const;
 		/**
 		* @brief Removes the specified edge
 		* @param edge index of the edge
 		*/
-		DllExport void				removeEdge(size_t edge);
+		void		  removeEdge(size_t edge);
+		/**
+		* @brief Gives the edge its own copy of the potential
+		* @details If the edge shares the potential of its group, the shared matrix is copied to the edge's own storage
+		* @param edge index of the edge
+		*/
+		void		  unshareEdgePot(size_t edge);
+		/**
+		* @brief Allocates the storage for the individual edge potentials
+		* @details This function does nothing if the storage is already allocated. It may be called concurrently from several threads.
+		*/
+		void		  allocateEdgePots(void);
+		/**
+		* @brief Sets the potential, shared by all edges of the group
+		* @param group The edge group ID. If not specified, the potential is set to all groups in use
+		* @param vPot The \a nStates x \a nStates potential matrix (row-major)
+		* @param model The model of the potential
+		* @param lambda The weight of the model
+		* @param tau The truncation threshold of the model
+		*/
+		void		  setGroupPot(std::optional<byte> group, const vec_float_t &vPot, EdgePotModel model, float lambda = 0, float tau = 0);
+
+
+	protected:
+		static constexpr size_t	EDGE_NONE	 = static_cast<size_t>(-1);		// End of the linked list / not found
+		static constexpr byte	EDGE_POT	 = 0x01;						// The edge potential is set
+		static constexpr byte	EDGE_REMOVED = 0x02;						// The edge is removed
+		static constexpr byte	EDGE_SHARED	 = 0x04;						// The edge refers to the potential of its group
+		static constexpr byte	EDGE_POTTS	 = 0x08;						// The individual edge potential has the Potts structure
 
+		// Nodes
+		vec_float_t	m_vNodePots;		// Node potentials: nNodes x nStates
+		vec_size_t	m_vNodeFirstOut;	// Head of the linked list of outgoing edges
+		vec_size_t	m_vNodeFirstIn;		// Head of the linked list of incoming edges
 
-	private:
-		size_t		m_IDx;			// = 0;	Primary Key
-		vec_node_t	m_vNodes;		// Nodes container
-		vec_edge_t	m_vEdges;		// Edges container
+		// Edges
+		vec_size_t	m_vEdgeSrc;			// Source nodes
+		vec_size_t	m_vEdgeDst;			// Destination nodes
+		vec_size_t	m_vEdgeNextOut;		// Next outgoing edge of the source node
+		vec_size_t	m_vEdgeNextIn;		// Next incoming edge of the destination node
+		vec_byte_t	m_vEdgeGroup;		// Edge group IDs
+		vec_byte_t	m_vEdgeFlags;		// Edge flags
+		size_t		m_nRemovedEdges;	// Number of edges marked as removed
+		vec_float_t	m_vEdgePots;		// Edge potentials: nEdges x nStates x nStates (allocated with the first individual potential)
+		std::vector<vec_float_t> m_vGroupPots;	// Shared edge potentials: nStates x nStates for every edge group in use
+		struct GroupModel {
+			EdgePotModel model;
+			float		 lambda;
+			float		 tau;
+		};
+		std::vector<GroupModel>	 m_vGroupModels;	// Models of the shared edge potentials
+		std::atomic<size_t> m_lastEdge;	// The edge, last set with setEdge(): the hint for findEdge()
+		std::atomic<bool> m_hasEdgePots;	// Flag indicating whether m_vEdgePots is allocated
+		std::mutex	m_mtxEdgePots;		// Guards the allocation of m_vEdgePots
+
+		// Edge index
+		struct EdgeKeyHash {
+			size_t operator()(const std::pair<size_t, size_t> &key) const { return std::hash<size_t>()(key.first * 0x9E3779B97F4A7C15ULL ^ key.second); }
+		};
+		using edge_index_t = std::unordered_map<std::pair<size_t, size_t>, size_t, EdgeKeyHash>;
+		std::unique_ptr<edge_index_t> m_pEdgeIndex;	// (srcNode, dstNode) -> edge (NULL if the index is disabled)
+
+		// Compressed adjacency
+		bool		m_isAdjacencyValid;	// Flag indicating whether the CSR arrays correspond to the graph structure
+		vec_size_t	m_vInOffset;		// Offsets of the incoming edges: nNodes + 1
+		vec_size_t	m_vInEdges;			// Incoming edges, grouped by destination node
+		vec_size_t	m_vOutOffset;		// Offsets of the outgoing edges: nNodes + 1
+		vec_size_t	m_vOutEdges;		// Outgoing edges, grouped by source node
+		mutable std::vector<vec_size_t> m_vvNodeColors;	// Cached result of colorNodes() (empty if not computed yet)
 	};
 }
-
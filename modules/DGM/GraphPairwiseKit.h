@@ -5,9 +5,15 @@
 #include "GraphKit.h"
 
 #include "GraphPairwise.h"
+#include "GraphGrid.h"
 
 #include "MessagePassing.h"
+#include "InferGraphCut.h"
+#include "InferICM.h"
 #include "InferLBP.h"
+#include "InferMeanField.h"
+#include "InferRedBlackBP.h"
+#include "InferResidualBP.h"
 #include "InferTRW.h"
 #include "InferViterbi.h"
 
@@ -21,7 +27,12 @@ namespace DirectGraphicalModels
 	enum class INFER { 
 		LBP,		///< Loopy Belief Propagation inference
 		TRW,		///< Convergent Tree-Reweighted inference
-		Viterbi		///< Viterbi inference
+		Viterbi,	///< Viterbi inference
+		ResidualBP,	///< Residual Belief Propagation inference
+		RedBlackBP,	///< Red-Black (checkerboard) Belief Propagation inference
+		GraphCut,	///< Graph-cut (alpha-expansion) inference
+		ICM,		///< Iterated Conditional Modes inference
+		MeanField	///< Mean-field inference
 	};
 
 	// ================================ Pairwise Graph Kit Class ===============================
@@ -35,31 +46,37 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Constructor
 		* @param nStates the number of States (classes)
-		* @param infer
+		* @param infer The inference / decoding method (Ref. @ref INFER)
+		* @param isGrid Flag indicating whether the grid graph CGraphGrid, built at once, should be used instead of the general CGraphPairwise graph
 		*/	
-		DllExport CGraphPairwiseKit(byte nStates, INFER infer = INFER::LBP)
+		DllExport CGraphPairwiseKit(byte nStates, INFER infer = INFER::LBP, bool isGrid = false)
 			: CGraphKit()
-			, m_graph(nStates)
-			, m_graphExtension(m_graph)
+			, m_pGraph(isGrid ? std::make_unique<CGraphGrid>(nStates) : std::make_unique<CGraphPairwise>(nStates))
+			, m_graphExtension(*m_pGraph)
 		{
 			switch (infer)
 			{
-			case INFER::LBP:	 m_pInfer = std::make_unique<CInferLBP>(m_graph); break;
-			case INFER::TRW:	 m_pInfer = std::make_unique<CInferTRW>(m_graph); break;
-			case INFER::Viterbi: m_pInfer = std::make_unique<CInferViterbi>(m_graph); break;
+			case INFER::LBP:	 m_pInfer = std::make_unique<CInferLBP>(*m_pGraph); break;
+			case INFER::TRW:	 m_pInfer = std::make_unique<CInferTRW>(*m_pGraph); break;
+			case INFER::Viterbi: m_pInfer = std::make_unique<CInferViterbi>(*m_pGraph); break;
+			case INFER::ResidualBP: m_pInfer = std::make_unique<CInferResidualBP>(*m_pGraph); break;
+			case INFER::RedBlackBP: m_pInfer = std::make_unique<CInferRedBlackBP>(*m_pGraph); break;
+			case INFER::GraphCut: m_pInfer = std::make_unique<CInferGraphCut>(*m_pGraph); break;
+			case INFER::ICM:	 m_pInfer = std::make_unique<CInferICM>(*m_pGraph); break;
+			case INFER::MeanField: m_pInfer = std::make_unique<CInferMeanField>(*m_pGraph); break;
 			default: DGM_ASSERT_MSG(false, "Unknown inference method");
 			}
 		}
 		DllExport virtual ~CGraphPairwiseKit() = default;
  
-		DllExport CGraph&		getGraph() override { return m_graph; }
+		DllExport CGraph&		getGraph() override { return *m_pGraph; }
 		DllExport CInfer&		getInfer() override { return *m_pInfer; }
 		DllExport CGraphExt&	getGraphExt() override { return m_graphExtension; }
 
 
 	private:
-		CGraphPairwise						m_graph;				///< Pairwise graph
-		std::unique_ptr<CMessagePassing>	m_pInfer;				///< Inferer for pairwise graphs
+		std::unique_ptr<CGraphPairwise>		m_pGraph;				///< Pairwise graph
+		std::unique_ptr<CInfer>				m_pInfer;				///< Inferer for pairwise graphs
 		CGraphPairwiseExt					m_graphExtension;		///< Pairwise graph extension
 	};
 }
\ No newline at end of file
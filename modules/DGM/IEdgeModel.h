@@ -29,5 +29,21 @@ namespace DirectGraphicalModels {
 		* will be the same size and type as the input one: Mat(size: nNodes x nStates; type: CV_32FC1)
 		*/
 		virtual void apply(const Mat &src, Mat &dst) const = 0;
+		/**
+		* @brief Applies an edge model and multiplies the result with the node potentials
+		* @details This function calculates \b dst = \b pots \f$\circ\f$ apply(\b src), where \f$\circ\f$ is the element-wise product. The derived classes may
+		* override it in order to fuse these operations into a single pass over the node potentials.
+		* @param[in] src The dense graph node potentials in form Mat(size: nNodes x nStates; type: CV_32FC1)
+		* @param[in] pots The node potentials to multiply with: Mat(size: nNodes x nStates; type: CV_32FC1)
+		* @param[out] dst The resulting node potentials: Mat(size: nNodes x nStates; type: CV_32FC1). It may be the same matrix as \b pots
+		* @param buffers The work buffers, which are allocated by the edge model on demand. They may be re-used between the calls 
+		* in order to avoid memory allocations
+		*/
+		virtual void applyMultiply(const Mat &src, const Mat &pots, Mat &dst, vec_mat_t &buffers) const
+		{
+			if (buffers.empty()) buffers.resize(1);
+			apply(src, buffers[0]);
+			multiply(pots, buffers[0], dst);
+		}
 	};
 }
\ No newline at end of file
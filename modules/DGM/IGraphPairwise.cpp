@@ -1,4 +1,5 @@
 #include "IGraphPairwise.h"
+#include "macroses.h"
 
 namespace DirectGraphicalModels
 {
@@ -7,6 +8,20 @@ namespace DirectGraphicalModels
         addEdge(srcNode, dstNode, 0, pot);
     }
     
+	void IGraphPairwise::addEdges(const Mat &srcDst, const Mat &groups, const Mat &pots, bool)
+	{
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG((srcDst.cols == 2) && (srcDst.type() == CV_32SC1), "The block of edges must have 2 columns and type CV_32SC1");
+		if (!groups.empty()) DGM_ASSERT_MSG((groups.rows == srcDst.rows) && (groups.type() == CV_8UC1), "The block of groups does not match the block of edges");
+		if (!pots.empty())   DGM_ASSERT_MSG((pots.rows == srcDst.rows) && (pots.cols == nStates * nStates), "The block of potentials does not match the block of edges");
+
+		for (int e = 0; e < srcDst.rows; e++) {
+			const int *pSrcDst = srcDst.ptr<int>(e);
+			byte group = groups.empty() ? 0 : groups.at<byte>(e, 0);
+			addEdge(pSrcDst[0], pSrcDst[1], group, pots.empty() ? Mat() : pots.row(e).reshape(1, nStates));
+		}
+	}
+
     bool IGraphPairwise::isEdgeArc(size_t srcNode, size_t dstNode) const
     {
         return isEdgeExists(dstNode, srcNode);
@@ -47,6 +47,18 @@ namespace DirectGraphicalModels {
 		*/
 		DllExport virtual void		addEdge(size_t srcNode, size_t dstNode, byte group, const Mat &pot) = 0;
 		/**
+		* @brief Adds a block of new directed edges
+		* @details This function is equivalent to calling addEdge() for every row of \b srcDst, but allows the concrete graph implementations
+		* to reserve the storage only once and to fill it in parallel.
+		* @param srcDst A block of edges: Mat(size: nEdges x 2; type: CV_32SC1), where every row contains the indexes of the source and destination nodes
+		* @param groups A block of the edge group IDs: Mat(size: nEdges x 1; type: CV_8UC1). If empty, all new edges are added to group 0
+		* @param pots A block of edge potentials: Mat(size: nEdges x nStates<sup>2</sup>; type: CV_32FC1), where every row contains a row-major edge potential matrix.
+		* If empty, the new edges have no potentials
+		* @param unique Flag indicating whether the caller guarantees that the new edges do not exist in the graph and are not duplicated in \b srcDst. 
+		* In this case the duplicate checks are skipped
+		*/
+		DllExport virtual void		addEdges(const Mat &srcDst, const Mat &groups = EmptyMat, const Mat &pots = EmptyMat, bool unique = false);
+		/**
 		* @brief Sets or changes the potentional of directed edge
 		* @param srcNode index of the source node
 		* @param dstNode index of the destination node
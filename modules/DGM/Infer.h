@@ -31,7 +31,7 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Inference
 		* @details This function estimates the marginal potentials for each graph node, and stores them as node potentials
-		* > This function modifies Node::Pot containers of graph nodes
+		* > This function modifies the potentials of graph nodes
 		* @param nIt Number of iterations
 		* @note This function must not to be linear, \a i.e. \f$ infer(\alpha\times N)\not\equiv\alpha\times infer(N) \f$
 		* @note This function substitutes the graph nodes' potentials with estimated marginal potentials
@@ -41,7 +41,7 @@ namespace DirectGraphicalModels
 		* @brief Approximate decoding
 		* @details This function calls first inference @ref infer() and then, using resulting marginal probabilities, estimates the most
 		* probable configuration of states (classes) in the graph via CDecode::decode().
-		* > This function modifies Node::Pot containers of graph nodes
+		* > This function modifies the potentials of graph nodes
 		* @param nIt Number of iterations
 		* @param lossMatrix (optional) The loss matrix \f$L\f$ (size: nStates x nStates; type: CV_32FC1).
 		* It must be a quadratic zero-diagonal matrix, whith all non-diagonal elements \f$L_{i,j} > 0, \forall i\neq j\f$.
@@ -72,6 +72,24 @@ namespace DirectGraphicalModels
 		* @return The potential values for each node of the graph.
 		*/
 		DllExport vec_float_t	getPotentials(byte state) const;
+		/**
+		* @brief Sets the convergence tolerance
+		* @details If the tolerance is positive, the iterative inference algorithms stop as soon as the change between two subsequent iterations
+		* falls below the tolerance, even if the number of iterations, passed to infer() is not reached yet. The change is measured as the maximal
+		* change of a message for the message passing algorithms and as the average Kullback-Leibler divergence of the marginals for the dense and mean-field inference.
+		* @param tolerance The convergence tolerance. Zero disables the convergence check (default)
+		*/
+		DllExport void			setTolerance(float tolerance) { m_tolerance = tolerance; }
+		/**
+		* @brief Returns the convergence tolerance
+		* @return The convergence tolerance
+		*/
+		DllExport float			getTolerance(void) const { return m_tolerance; }
+		/**
+		* @brief Returns the number of iterations, actually performed by the last call of infer()
+		* @return The number of iterations (0 for non-iterative inference algorithms)
+		*/
+		DllExport unsigned int	getNumIterations(void) const { return m_nIterations; }
 
 
 	protected:
@@ -80,9 +98,16 @@ namespace DirectGraphicalModels
 		* @return The reference to the graph
 		*/
 		CGraph& getGraph(void) const { return m_graph; }
+		/**
+		* @brief Stores the number of iterations, performed by the iterative inference algorithm
+		* @param nIterations The number of iterations
+		*/
+		void	setNumIterations(unsigned int nIterations) { m_nIterations = nIterations; }
 
         
 	private:
-		CGraph & m_graph;
+		CGraph		 & m_graph;
+		float		   m_tolerance	 = 0.0f;	///< The convergence tolerance
+		unsigned int   m_nIterations = 0;		///< The number of iterations, performed by the last call of infer()
 	};
 }
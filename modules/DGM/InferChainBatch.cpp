@@ -0,0 +1,181 @@
+#include "InferChainBatch.h"
+#include "parallel.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	namespace {
+		constexpr int W = 8;																	// The number of chains in a block
+
+		// Copies the node potentials of a block of chains to the buffer, where the values of the chains for the same position and state are
+		// stored next to each other. The missing chains of the last block get uniform potentials
+		void gather(const Mat &pots, int c0, int nChains, float *dst)
+		{
+			const int nValues = pots.cols;
+			for (int l = 0; l < W; l++) {
+				const float *pPot = c0 + l < nChains ? pots.ptr<float>(c0 + l) : NULL;
+				for (int i = 0; i < nValues; i++)
+					dst[i * W + l] = pPot ? pPot[i] : 1.0f;
+			}
+		}
+
+		// Normalizes the distributions of all chains of a block: v[s * W + l] /= sum_s v[s * W + l]
+		void normalize(float *v, byte nStates)
+		{
+			float sum[W] = { 0 };
+			for (byte s = 0; s < nStates; s++)
+				for (int l = 0; l < W; l++) sum[l] += v[s * W + l];
+			for (int l = 0; l < W; l++) sum[l] = sum[l] > 0 ? 1.0f / sum[l] : 0.0f;
+			for (byte s = 0; s < nStates; s++)
+				for (int l = 0; l < W; l++) v[s * W + l] *= sum[l];
+		}
+	}
+
+	// Constructor
+	CInferChainBatch::CInferChainBatch(byte nStates) : m_nStates(nStates), m_vEdgePot(static_cast<size_t>(nStates) * nStates, 1.0f)
+	{}
+
+	void CInferChainBatch::setEdgePot(const Mat &pot)
+	{
+		DGM_ASSERT_MSG(pot.rows == m_nStates && pot.cols == m_nStates, "The size of the edge potential (%d x %d) does not match the number of states %d", pot.rows, pot.cols, m_nStates);
+		DGM_ASSERT(pot.type() == CV_32FC1);
+		for (byte y = 0; y < m_nStates; y++)
+			memcpy(m_vEdgePot.data() + y * m_nStates, pot.ptr<float>(y), m_nStates * sizeof(float));
+	}
+
+	void CInferChainBatch::getEdgePot(Mat &pot) const
+	{
+		pot = Mat(m_nStates, m_nStates, CV_32FC1);
+		for (byte y = 0; y < m_nStates; y++)
+			memcpy(pot.ptr<float>(y), m_vEdgePot.data() + y * m_nStates, m_nStates * sizeof(float));
+	}
+
+	void CInferChainBatch::infer(Mat &pots) const
+	{
+		DGM_ASSERT(pots.type() == CV_32FC1);
+		DGM_ASSERT_MSG(pots.cols % m_nStates == 0, "The number of columns %d is not a multiple of the number of states %d", pots.cols, m_nStates);
+		
+		const byte	  nStates = m_nStates;
+		const int	  nChains = pots.rows;
+		const int	  length  = pots.cols / nStates;
+		const float	* T		  = m_vEdgePot.data();
+		const int	  nBlocks = (nChains + W - 1) / W;
+		if (length == 0) return;
+
+		parallel::parallel_for(0, nBlocks, [&, nStates](int b) {
+			const size_t stride = static_cast<size_t>(nStates) * W;								// size of one position of a block
+			vec_float_t vPot(length * stride);
+			vec_float_t vAlpha(length * stride);
+			vec_float_t vBeta(stride), vBetaPrev(stride), vTemp(stride);
+			gather(pots, b * W, nChains, vPot.data());
+
+			// Forward pass: alpha_t(s) = pot_t(s) * sum_r alpha_{t-1}(r) * T(r, s)
+			std::copy(vPot.begin(), vPot.begin() + stride, vAlpha.begin());
+			normalize(vAlpha.data(), nStates);
+			for (int t = 1; t < length; t++) {
+				const float *prev	= vAlpha.data() + (t - 1) * stride;
+				float		*alpha	= vAlpha.data() + t * stride;
+				const float *pot	= vPot.data() + t * stride;
+				std::fill(alpha, alpha + stride, 0.0f);
+				for (byte r = 0; r < nStates; r++)
+					for (byte s = 0; s < nStates; s++) {
+						const float tr = T[r * nStates + s];
+						for (int l = 0; l < W; l++) alpha[s * W + l] += prev[r * W + l] * tr;
+					}
+				for (size_t i = 0; i < stride; i++) alpha[i] *= pot[i];
+				normalize(alpha, nStates);
+			} // t
+
+			// Backward pass: beta_{t-1}(r) = sum_s T(r, s) * pot_t(s) * beta_t(s); marginal_t = alpha_t * beta_t
+			std::fill(vBeta.begin(), vBeta.end(), 1.0f);
+			for (int t = length - 1; t >= 0; t--) {
+				const float *alpha	= vAlpha.data() + t * stride;
+				for (size_t i = 0; i < stride; i++) vTemp[i] = alpha[i] * vBeta[i];
+				normalize(vTemp.data(), nStates);
+				for (int l = 0; l < W && b * W + l < nChains; l++) {
+					float *pPot = pots.ptr<float>(b * W + l) + t * nStates;
+					for (byte s = 0; s < nStates; s++) pPot[s] = vTemp[s * W + l];
+				}
+				if (t == 0) break;
+
+				const float *pot = vPot.data() + t * stride;
+				for (size_t i = 0; i < stride; i++) vTemp[i] = pot[i] * vBeta[i];
+				std::fill(vBetaPrev.begin(), vBetaPrev.end(), 0.0f);
+				for (byte r = 0; r < nStates; r++)
+					for (byte s = 0; s < nStates; s++) {
+						const float tr = T[r * nStates + s];
+						for (int l = 0; l < W; l++) vBetaPrev[r * W + l] += vTemp[s * W + l] * tr;
+					}
+				normalize(vBetaPrev.data(), nStates);
+				vBeta.swap(vBetaPrev);
+			} // t
+		});
+	}
+
+	Mat CInferChainBatch::decode(const Mat &pots) const
+	{
+		DGM_ASSERT(pots.type() == CV_32FC1);
+		DGM_ASSERT_MSG(pots.cols % m_nStates == 0, "The number of columns %d is not a multiple of the number of states %d", pots.cols, m_nStates);
+		
+		const byte	  nStates = m_nStates;
+		const int	  nChains = pots.rows;
+		const int	  length  = pots.cols / nStates;
+		const int	  nBlocks = (nChains + W - 1) / W;
+		Mat			  res(nChains, length, CV_8UC1);
+		if (length == 0) return res;
+
+		// Logarithms of the edge potential
+		vec_float_t vLogT(m_vEdgePot.size());
+		for (size_t i = 0; i < vLogT.size(); i++) vLogT[i] = logf(MAX(m_vEdgePot[i], FLT_MIN));
+		const float *L = vLogT.data();
+
+		parallel::parallel_for(0, nBlocks, [&, nStates](int b) {
+			const size_t stride = static_cast<size_t>(nStates) * W;								// size of one position of a block
+			vec_float_t vPot(length * stride);
+			vec_float_t vDelta(stride), vDeltaPrev(stride);
+			vec_byte_t	vBack(length * stride);													// back-pointers
+			gather(pots, b * W, nChains, vPot.data());
+			for (float &pot : vPot) pot = logf(MAX(pot, FLT_MIN));
+
+			// Forward pass: delta_t(s) = log(pot_t(s)) + max_r (delta_{t-1}(r) + log(T(r, s)))
+			std::copy(vPot.begin(), vPot.begin() + stride, vDelta.begin());
+			for (int t = 1; t < length; t++) {
+				vDeltaPrev.swap(vDelta);
+				byte		*back	= vBack.data() + t * stride;
+				const float *pot	= vPot.data() + t * stride;
+				for (byte s = 0; s < nStates; s++) {
+					float *delta = vDelta.data() + s * W;
+					for (int l = 0; l < W; l++) {
+						delta[l] = vDeltaPrev[l] + L[s];
+						back[s * W + l] = 0;
+					}
+					for (byte r = 1; r < nStates; r++) {
+						const float tr = L[r * nStates + s];
+						for (int l = 0; l < W; l++) {
+							const float val = vDeltaPrev[r * W + l] + tr;
+							if (val > delta[l]) {
+								delta[l] = val;
+								back[s * W + l] = r;
+							}
+						}
+					} // r
+					for (int l = 0; l < W; l++) delta[l] += pot[s * W + l];
+				} // s
+			} // t
+
+			// Backtracking
+			for (int l = 0; l < W && b * W + l < nChains; l++) {
+				byte *pRes = res.ptr<byte>(b * W + l);
+				byte state = 0;
+				for (byte s = 1; s < nStates; s++)
+					if (vDelta[s * W + l] > vDelta[state * W + l]) state = s;
+				for (int t = length - 1; t >= 0; t--) {
+					pRes[t] = state;
+					state = vBack[t * stride + state * W + l];
+				}
+			} // l
+		});
+
+		return res;
+	}
+}
@@ -0,0 +1,63 @@
+// Batched chain inference class interface
+#pragma once
+
+#include "types.h"
+
+namespace DirectGraphicalModels
+{
+	// ============================= Batched Chain Infer Class =============================
+	/**
+	* @ingroup moduleDecode
+	* @brief Inference for batches of independent chains
+	* @details This class performs the exact inference (forward-backward algorithm) and the exact decoding (Viterbi algorithm) for a batch
+	* of independent Markov chains (\a e.g. hidden Markov models of the time series of every pixel or of every track), without building a graph 
+	* for every chain. The chains share the same length and the same edge (transition) potential \f$\psi(x_t, x_{t+1})\f$, thus the 
+	* probability of a chain is \f$P(x)\propto\prod_t\psi_t(x_t)\prod_t\psi(x_t, x_{t+1})\f$, which is the same as for the CGraphPairwise
+	* graph, built with \a addEdge(t, t + 1, pot) calls.
+	*
+	* The node potentials of the batch are given as a \a nChains x (\a length * \a nStates) matrix: every row of the matrix keeps the node
+	* potentials of one chain, position after position. The chains are processed in blocks of 8, whose values for the same position and state 
+	* are kept next to each other, thus the inner loops run over the chains of a block and are vectorized by the compiler (ref. ENABLE_AVX 
+	* CMake option). The blocks are processed concurrently (ref. ENABLE_PPL CMake option).
+	*/
+	class CInferChainBatch
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param nStates The number of states (classes)
+		*/
+		DllExport CInferChainBatch(byte nStates);
+		DllExport ~CInferChainBatch(void) = default;
+
+		/**
+		* @brief Sets the edge potential
+		* @details By default all the edge potentials are equal to 1, \a i.e. the chain positions are independent
+		* @param pot The edge potential: matrix of size \a nStates x \a nStates of type \b CV_32FC1 with \f$\psi(x_t, x_{t+1})\f$ in row 
+		* \f$x_t\f$ and column \f$x_{t+1}\f$
+		*/
+		DllExport void	setEdgePot(const Mat &pot);
+		/**
+		* @brief Returns the edge potential
+		* @param[out] pot The edge potential: matrix of size \a nStates x \a nStates of type \b CV_32FC1
+		*/
+		DllExport void	getEdgePot(Mat &pot) const;
+		/**
+		* @brief Calculates the marginals
+		* @details This function replaces the node potentials of all chains with the (normalized) marginal probabilities
+		* @param[in,out] pots The node potentials: matrix of size \a nChains x (\a length * \a nStates) of type \b CV_32FC1
+		*/
+		DllExport void	infer(Mat &pots) const;
+		/**
+		* @brief Calculates the most probable configurations
+		* @param pots The node potentials: matrix of size \a nChains x (\a length * \a nStates) of type \b CV_32FC1
+		* @return The most probable configurations: matrix of size \a nChains x \a length of type \b CV_8UC1
+		*/
+		DllExport Mat	decode(const Mat &pots) const;
+
+
+	private:
+		byte		m_nStates;			///< The number of states (classes)
+		vec_float_t	m_vEdgePot;			///< The edge potential (row-major)
+	};
+}
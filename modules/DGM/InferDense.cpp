@@ -1,37 +1,16 @@
 #include "InferDense.h"
 #include "IEdgeModel.h"
+#include "kernels.h"
+#include "parallel.h"
 
 namespace DirectGraphicalModels
 {
 	namespace {
-		template<typename T>
-		void normalize(const Mat &src, Mat dst) {
-			if(dst.empty()) dst = Mat(src.size(), src.type());
-			for (int y = 0; y < src.rows; y++) {
-				const T *pSrc = src.ptr<T>(y);
-				T *pDst = dst.ptr<T>(y);
-				T sum = 0;
-				for (int x = 0; x < src.cols; x++) sum += pSrc[x];
-				if (sum > DBL_EPSILON)
-					for (int x = 0; x < src.cols; x++) pDst[x] = pSrc[x] / sum;
-			} // y
-		}
-		
-		template<typename T>
-		void myexp(const Mat &src, Mat &dst)
-		{
-			for (int y = 0; y < src.rows; y++) {             
-				const T *pSrc  = src.ptr<float>(y);
-				T *pDst = dst.ptr<float>(y);
-
-				// Find the max and subtract it so that the exp doesn't explode
-				T max = pSrc[0];
-				for (int x = 1; x < src.cols; x++)
-					if (pSrc[x] > max) max = pSrc[x];
-
-				for (int x = 0; x < src.cols; x++)
-					pDst[x] = expf(pSrc[x] - max);
-			} // y
+		void normalizePots(const Mat &src, Mat &dst) {
+			dst.create(src.size(), src.type());
+			parallel::parallel_for(0, src.rows, [&](int y) {
+				kernels::normalize(src.ptr<float>(y), dst.ptr<float>(y), src.cols);
+			});
 		}
 	}
 	
@@ -39,26 +18,47 @@ namespace DirectGraphicalModels
 	{
 		// ====================================== Initialization ======================================
 		Mat nodePotentials	= getGraphDense().getNodePotentials();
-		Mat	nodePotentials0	= nodePotentials.clone();
-		Mat	temp			= Mat(nodePotentials.size(), nodePotentials.type());
-		Mat	tmp;
+		auto &vpEdgeModels	= getGraphDense().getEdgeModels();
+		nodePotentials.copyTo(m_pots0);
+		if (m_vBuffers.size() < vpEdgeModels.size()) m_vBuffers.resize(vpEdgeModels.size());
+
+		const float tolerance = getTolerance();
+
+		normalizePots(nodePotentials, m_marginals);
 
 		// =================================== Calculating potentials ==================================	
-		for (unsigned int i = 0; i < nIt; i++) {
+		unsigned int i;
+		for (i = 0; i < nIt; i++) {
 #ifdef DEBUG_PRINT_INFO
 			if (i == 0) printf("\n");
 			if (i % 5 == 0) printf("--- It: %d ---\n", i);
 #endif
-			normalize<float>(nodePotentials, nodePotentials);
-			
-			// Add up all pairwise potentials
-			temp.setTo(1);
-			for (auto &edgePotModel : getGraphDense().getEdgeModels()) {
-				edgePotModel->apply(nodePotentials, tmp);					// tmp = f(pot_i)
-				multiply(temp, tmp, temp);									// temp *= exp(tmp)
+			// pot_(i+1) = pot_0 * exp(f_1(marginals_i)) * exp(f_2(marginals_i)) * ...
+			if (vpEdgeModels.empty()) m_pots0.copyTo(nodePotentials);
+			for (size_t m = 0; m < vpEdgeModels.size(); m++)
+				vpEdgeModels[m]->applyMultiply(m_marginals, m == 0 ? m_pots0 : nodePotentials, nodePotentials, m_vBuffers[m]);
+
+			normalizePots(nodePotentials, m_marginalsNext);
+
+			// Convergence check: average KL-divergence between the marginals of the subsequent iterations
+			bool converged = false;
+			if (tolerance > 0) {
+				float kl = 0;
+				for (int y = 0; y < m_marginalsNext.rows; y++) {
+					const float *pQ = m_marginalsNext.ptr<float>(y);
+					const float *pP = m_marginals.ptr<float>(y);
+					for (int x = 0; x < m_marginalsNext.cols; x++)
+						if (pQ[x] > 0) kl += pQ[x] * logf(pQ[x] / MAX(pP[x], FLT_MIN));
+				} // y
+				converged = kl / MAX(1, m_marginalsNext.rows) < tolerance;
 			}
 
-			multiply(nodePotentials0, temp, nodePotentials);				// pot_(i+1) = pot_0 * next
+			swap(m_marginals, m_marginalsNext);
+			if (converged) {
+				i++;
+				break;
+			}
 		} // iter
+		setNumIterations(i);
 	}
 }
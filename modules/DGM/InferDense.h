@@ -13,6 +13,8 @@ namespace DirectGraphicalModels
 	* @brief Dense Inference for Dense CRF. 
 	* @details The implementation is based on 
 	* <a href="http://graphics.stanford.edu/projects/densecrf/densecrf.pdf">Efficient Inference in Fully Connected CRFs with Gaussian Edge Potentials</a> paper. 
+	* > Every iteration makes one pass over the node potentials per edge model (ref. IEdgeModel::applyMultiply()) and one normalization pass. The work buffers
+	* are kept by the object, thus the subsequent calls of infer() for the graphs of the same size do not allocate memory.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CInferDense : public CInfer 
@@ -34,5 +36,12 @@ namespace DirectGraphicalModels
 		* @return The dense graph
 		*/
 		CGraphDense& getGraphDense(void) const { return dynamic_cast<CGraphDense&>(getGraph()); }
+
+
+	private:
+		Mat						m_pots0;			///< The initial node potentials: Mat(size: nNodes x nStates; type: CV_32FC1)
+		Mat						m_marginals;		///< The normalized node potentials of the current iteration
+		Mat						m_marginalsNext;	///< The normalized node potentials of the next iteration
+		std::vector<vec_mat_t>	m_vBuffers;			///< The work buffers of the edge models
 	};
 }
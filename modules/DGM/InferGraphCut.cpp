@@ -0,0 +1,116 @@
+#include "InferGraphCut.h"
+#include "GraphPairwise.h"
+#include "MaxFlow.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	void CInferGraphCut::infer(unsigned int nIt)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();						// number of states
+		const size_t	  nNodes  = graph.getNumNodes();						// number of nodes
+		const size_t	  nEdges  = graph.getNumEdges();						// number of edges
+		const size_t	  potSize = static_cast<size_t>(nStates) * nStates;
+		const size_t	  noPot	  = std::numeric_limits<size_t>::max();
+
+		// ====================================== Initialization ======================================
+		graph.updateAdjacency();
+		auto energy = [](float pot) { return -logf(MAX(pot, FLT_MIN)); };
+
+		// Node energies and the initial configuration
+		vec_float_t	vNodeEnergy(nNodes * nStates);
+		vec_byte_t	vState(nNodes);
+		for (size_t n = 0; n < nNodes; n++) {
+			const float *pot = graph.getNodePot(n);
+			for (byte s = 0; s < nStates; s++) vNodeEnergy[n * nStates + s] = energy(pot[s]);
+			vState[n] = static_cast<byte>(std::max_element(pot, pot + nStates) - pot);
+		}
+
+		// Edge energies: calculated once for every distinct potential
+		vec_float_t	vEdgeEnergy;
+		vec_size_t	vOffset(nEdges, noPot);
+		std::unordered_map<const float*, size_t> offsets;
+		for (size_t e = 0; e < nEdges; e++) {
+			const float *pot = graph.getEdgePot(e);
+			if (!pot || graph.m_vEdgeSrc[e] == graph.m_vEdgeDst[e]) continue;
+			auto it = offsets.find(pot);
+			if (it == offsets.end()) {
+				it = offsets.emplace(pot, vEdgeEnergy.size()).first;
+				for (size_t i = 0; i < potSize; i++) vEdgeEnergy.push_back(energy(pot[i]));
+			}
+			vOffset[e] = it->second;
+		} // e
+
+		auto getEnergy = [&](const vec_byte_t &vState) {
+			double res = 0;
+			for (size_t n = 0; n < nNodes; n++) res += vNodeEnergy[n * nStates + vState[n]];
+			for (size_t e = 0; e < nEdges; e++)
+				if (vOffset[e] != noPot) res += vEdgeEnergy[vOffset[e] + vState[graph.m_vEdgeSrc[e]] * nStates + vState[graph.m_vEdgeDst[e]]];
+			return res;
+		};
+
+		// ======================================= Expansion moves ======================================
+		// One network per state, if they fit into the memory limit: in the later cycles only the capacities of the network are updated 
+		// and its flow is re-used. Otherwise a single network is re-built for every move
+		const size_t nFlowEdges = static_cast<size_t>(std::count_if(vOffset.begin(), vOffset.end(), [noPot](size_t offset) { return offset != noPot; }));
+		const bool	 reuse		= nStates * CMaxFlow::getMemorySize(nNodes, nFlowEdges) <= m_maxMemory;
+		std::vector<CMaxFlow> vMaxFlow(reuse ? nStates : 1);
+		vec_float_t	vTWeight(nNodes);
+		vec_byte_t	vNewState(nNodes);
+		double		curEnergy = getEnergy(vState);
+		unsigned int i;
+		for (i = 0; i < nIt; i++) {													// cycles
+			bool changed = false;
+			for (byte alpha = 0; alpha < nStates; alpha++) {
+				// Network: the nodes in the sink segment switch to alpha
+				CMaxFlow &maxFlow = vMaxFlow[reuse ? alpha : 0];
+				const bool update = reuse && i > 0;
+				if (!update) maxFlow.reset(nNodes);
+				for (size_t n = 0; n < nNodes; n++)
+					vTWeight[n] = vNodeEnergy[n * nStates + alpha] - vNodeEnergy[n * nStates + vState[n]];
+				size_t k = 0;
+				for (size_t e = 0; e < nEdges; e++) {
+					if (vOffset[e] == noPot) continue;
+					const size_t src = graph.m_vEdgeSrc[e];
+					const size_t dst = graph.m_vEdgeDst[e];
+					const float *pEnergy = vEdgeEnergy.data() + vOffset[e];
+					
+					const float	E01 = pEnergy[vState[src] * nStates + alpha];
+					const float	E10 = pEnergy[alpha * nStates + vState[dst]];
+					const float	E11 = pEnergy[alpha * nStates + alpha];
+					const float	E00 = MIN(pEnergy[vState[src] * nStates + vState[dst]], E01 + E10 - E11);	// truncation of non-metric energies
+					
+					vTWeight[src] += E10 - E00;
+					vTWeight[dst] += E11 - E10;
+					const float cap = MAX(0.0f, E01 + E10 - E00 - E11);
+					if (update)					maxFlow.setEdge(k++, cap, 0);
+					else if (reuse || cap > 0)	maxFlow.addEdge(src, dst, cap, 0);		// the structure of a re-used network is the same in all cycles
+				} // e
+				for (size_t n = 0; n < nNodes; n++)
+					maxFlow.setTWeights(n, MAX(0.0f, vTWeight[n]), MAX(0.0f, -vTWeight[n]));
+				maxFlow.maxFlow(update);
+
+				for (size_t n = 0; n < nNodes; n++) vNewState[n] = maxFlow.isSink(n) ? alpha : vState[n];
+				const double newEnergy = getEnergy(vNewState);
+				if (newEnergy < curEnergy) {
+					vState.swap(vNewState);
+					curEnergy = newEnergy;
+					changed = true;
+				}
+			} // alpha
+			if (!changed) {
+				i++;
+				break;
+			}
+		} // cycles
+		setNumIterations(i);
+
+		// Setting the potentials
+		for (size_t n = 0; n < nNodes; n++) {
+			float *pot = graph.getNodePot(n);
+			std::fill(pot, pot + nStates, 0.0f);
+			pot[vState[n]] = 1.0f;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+// Graph-cut inference class interface
+#pragma once
+
+#include "Infer.h"
+#include "GraphPairwise.h"
+
+namespace DirectGraphicalModels
+{
+	// ================================ Graph-Cut Infer Class ===============================
+	/**
+	* @ingroup moduleDecode
+	* @brief Graph-cut (\f$\alpha\f$-expansion) inference class
+	* @details This class is based on the \f$\alpha\f$-expansion algorithm, described in the paper 
+	* \"Fast Approximate Energy Minimization via Graph Cuts\" by Y. Boykov, O. Veksler and R. Zabih (PAMI 2001).
+	* The class minimizes the energy \f$E(x) = -\sum_n\log p_n(x_n) - \sum_{(s,t)}\log p_{s,t}(x_s, x_t)\f$, where \f$p_n\f$ and \f$p_{s,t}\f$ are
+	* the node and edge potentials, \a i.e. it finds the configuration with (approximately) the highest joint probability (ref. CDecodeExact). 
+	* Starting from the most probable states of the nodes, for every state \f$\alpha\f$ the largest decrease of energy, achieved by switching 
+	* any subset of nodes to the state \f$\alpha\f$, is found as the minimal cut of a network (ref. CMaxFlow). 
+	* The moves are repeated until none of them decreases the energy. For the metric edge potentials, \a e.g. the Potts potentials of the 
+	* CTrainEdgePotts, CTrainEdgePottsCS and CTrainEdgePrior classes, the resulting energy is within a known factor of the global minimum and 
+	* for 2 states the solution is exact. The non-metric edge potentials are truncated in every move, and the move is accepted only if it 
+	* decreases the energy. If the networks for all states fit into the memory limit (ref. setMaxMemory()), every state \f$\alpha\f$ has its own 
+	* network: in the later cycles only its capacities are updated and the flow and the search trees of the previous cycle are re-used 
+	* (ref. CMaxFlow::maxFlow()). Otherwise a single network is re-built for every move.
+	* > In contrast to the other inference classes, this class does not estimate the marginal probabilities: the potential of the found state 
+	* of every node is set to 1 and the potentials of the other states are set to 0.
+	*/
+	class CInferGraphCut : public CInfer
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		*/
+		DllExport CInferGraphCut(CGraphPairwise &graph) : CInfer(graph), m_maxMemory(size_t(1) << 30) {}
+		DllExport virtual ~CInferGraphCut(void) = default;
+
+		/**
+		* @brief Sets the memory limit for the re-used networks
+		* @details The re-use of the flow between the cycles requires memory for \a nStates networks, which may be large for big graphs with many states
+		* @param maxMemory The maximal size of the networks in bytes (default: 1 GB). If 0, a single network is re-built for every move
+		*/
+		DllExport void	setMaxMemory(size_t maxMemory) { m_maxMemory = maxMemory; }
+
+		/**
+		* @brief Inference
+		* @param nIt The maximal number of cycles of the \f$\alpha\f$-expansion moves over all states
+		*/
+		DllExport virtual void	infer(unsigned int nIt = 1);
+	
+
+	protected:
+		/**
+		* @brief Returns the graph
+		* @return The graph
+		*/
+		CGraphPairwise& getGraphPairwise(void) const { return static_cast<CGraphPairwise&>(getGraph()); }
+
+
+	private:
+		size_t	m_maxMemory;	///< The memory limit for the re-used networks in bytes
+	};
+}
@@ -0,0 +1,21 @@
+#include "InferICM.h"
+#include "Graph.h"
+
+namespace DirectGraphicalModels
+{
+	void CInferICM::infer(unsigned int nIt)
+	{
+		CGraph			& graph	  = CInfer::getGraph();
+		const byte		  nStates = graph.getNumStates();
+
+		vec_byte_t state = CDecode::decode(graph);
+		setNumIterations(sweep(state, nIt));
+
+		Mat pot(nStates, 1, CV_32FC1);
+		for (size_t n = 0; n < state.size(); n++) {
+			pot.setTo(0);
+			pot.at<float>(state[n], 0) = 1.0f;
+			graph.setNode(n, pot);
+		}
+	}
+}
@@ -0,0 +1,36 @@
+// Iterated Conditional Modes inference class interface
+#pragma once
+
+#include "Infer.h"
+#include "DecodeICM.h"
+
+namespace DirectGraphicalModels
+{
+	// ================================ ICM Infer Class ===============================
+	/**
+	* @ingroup moduleDecode
+	* @brief Iterated Conditional Modes inference class
+	* @details This class wraps the CDecodeICM decoder into the inference interface, \a e.g. for the use in CGraphPairwiseKit.
+	* > This class does not estimate the marginal probabilities: the potential of the found state of every node is set to 1 and 
+	* the potentials of the other states are set to 0.
+	*/
+	class CInferICM : public CInfer, private CDecodeICM
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		*/
+		DllExport CInferICM(CGraphPairwise &graph) : CInfer(graph), CDecodeICM(graph) {}
+		DllExport virtual ~CInferICM(void) = default;
+
+		/**
+		* @brief Inference
+		* @details The decoding is warm-started from the most probable states of the nodes. The number of performed sweeps is returned by CInfer::getNumIterations()
+		* @param nIt The maximal number of sweeps
+		*/
+		DllExport virtual void	infer(unsigned int nIt = 1);
+
+		using CInfer::decode;
+	};
+}
@@ -0,0 +1,244 @@
+#include "InferJunctionTree.h"
+#include "parallel.h"
+#include "macroses.h"
+#include <set>
+
+namespace DirectGraphicalModels
+{
+	namespace {
+		// Clique of the junction tree
+		struct SClique {
+			vec_size_t	vVars;			// Nodes of the clique: the eliminated node, followed by the separator with the parent clique
+			size_t		parent;			// Parent clique
+			vec_size_t	vChildren;		// Child cliques
+			vec_float_t	vTable;			// Potential / belief of the clique: the index of the entry is sum_i state[vVars[i]] * nStates^i
+			vec_float_t	vMsg;			// Message to the parent clique: the index of the entry is the index of the table entry / nStates
+			vec_size_t	vMsgIdx;		// Index of the message entry for every entry of the table of the parent clique
+		};
+
+		// Returns for every entry of the table over vVars the index of the entry of the table over vSubVars, which is a subset of vVars
+		vec_size_t getSubIndexes(const vec_size_t &vVars, const vec_size_t &vSubVars, size_t size, byte nStates)
+		{
+			vec_size_t vStride(vVars.size(), 0);
+			size_t stride = 1;
+			for (size_t var : vSubVars) {
+				vStride[std::find(vVars.begin(), vVars.end(), var) - vVars.begin()] = stride;
+				stride *= nStates;
+			}
+
+			vec_size_t res(size);
+			vec_byte_t state(vVars.size(), 0);
+			size_t idx = 0;
+			for (size_t i = 0; i < size; i++) {
+				res[i] = idx;
+				for (size_t v = 0; v < state.size(); v++) {							// next entry
+					if (++state[v] < nStates) {
+						idx += vStride[v];
+						break;
+					}
+					idx -= (nStates - 1) * vStride[v];
+					state[v] = 0;
+				} // v
+			} // i
+			return res;
+		}
+
+		// Divides the table by its maximal element
+		void normalize(vec_float_t &vTable)
+		{
+			const float max = *std::max_element(vTable.begin(), vTable.end());
+			if (max > 0) for (float &val : vTable) val /= max;
+		}
+	}
+
+	void CInferJunctionTree::infer(unsigned int)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();
+		const size_t	  nNodes  = graph.getNumNodes();
+		const size_t	  NONE	  = std::numeric_limits<size_t>::max();
+		const bool		  maxSum  = m_maxSum;
+
+		// ====================================== Initialization ======================================
+		graph.updateAdjacency();
+
+		// Triangulation
+		std::vector<vec_size_t> vvNeighbours;
+		vec_size_t vOrder = getEliminationOrder(vvNeighbours);
+		vec_size_t vPosition(nNodes);
+		for (size_t i = 0; i < nNodes; i++) vPosition[vOrder[i]] = i;
+
+		// Junction tree: the clique n is produced by the elimination of the node n
+		std::vector<SClique> vCliques(nNodes);
+		for (size_t n = 0; n < nNodes; n++) {
+			SClique &clique = vCliques[n];
+			clique.vVars.push_back(n);
+			clique.vVars.insert(clique.vVars.end(), vvNeighbours[n].begin(), vvNeighbours[n].end());
+			clique.parent = NONE;
+			for (size_t m : vvNeighbours[n])
+				if (clique.parent == NONE || vPosition[m] < vPosition[clique.parent]) clique.parent = m;
+			
+			size_t size = 1;
+			for (size_t i = 0; i < clique.vVars.size(); i++) {
+				DGM_ASSERT_MSG(size <= static_cast<size_t>(std::numeric_limits<int>::max() / nStates), "The treewidth of the graph (at least %zu) is too large", clique.vVars.size() - 1);
+				size *= nStates;
+			}
+			clique.vTable.assign(size, 1.0f);
+		} // n
+		for (size_t n = 0; n < nNodes; n++)
+			if (vCliques[n].parent != NONE) vCliques[vCliques[n].parent].vChildren.push_back(n);
+
+		// The edge potentials are multiplied into the clique of the first eliminated node of the edge, which contains both nodes
+		std::vector<vec_size_t> vvCliqueEdges(nNodes);
+		for (size_t n = 0; n < nNodes; n++)
+			for (size_t e_t : graph.getOutEdges(n)) {
+				if (!graph.getEdgePot(e_t)) continue;
+				const size_t dst = graph.m_vEdgeDst[e_t];
+				vvCliqueEdges[vPosition[n] <= vPosition[dst] ? n : dst].push_back(e_t);
+			}
+
+		parallel::parallel_for(size_t(0), nNodes, [&, nStates](size_t n) {
+			SClique		&clique = vCliques[n];
+			const float *pot	= graph.getNodePot(n);
+			for (size_t i = 0; i < clique.vTable.size(); i++) clique.vTable[i] *= pot[i % nStates];
+
+			for (size_t e : vvCliqueEdges[n]) {
+				const float *edgePot = graph.getEdgePot(e);
+				size_t strideSrc = 1, strideDst = 1;
+				for (size_t v = 0; clique.vVars[v] != graph.m_vEdgeSrc[e]; v++) strideSrc *= nStates;
+				for (size_t v = 0; clique.vVars[v] != graph.m_vEdgeDst[e]; v++) strideDst *= nStates;
+				for (size_t i = 0; i < clique.vTable.size(); i++)
+					clique.vTable[i] *= edgePot[((i / strideSrc) % nStates) * nStates + (i / strideDst) % nStates];
+			} // e
+		});
+
+		// Levels of the junction tree: a clique is processed after all its children in the upward pass and after its parent in the downward pass
+		std::vector<vec_size_t> vvUp, vvDown;
+		vec_size_t vLevel(nNodes, 0);
+		for (size_t n : vOrder) {
+			if (vLevel[n] >= vvUp.size()) vvUp.resize(vLevel[n] + 1);
+			vvUp[vLevel[n]].push_back(n);
+			if (vCliques[n].parent != NONE) vLevel[vCliques[n].parent] = MAX(vLevel[vCliques[n].parent], vLevel[n] + 1);
+		}
+		for (auto it = vOrder.rbegin(); it != vOrder.rend(); it++) {
+			const size_t n = *it;
+			vLevel[n] = vCliques[n].parent == NONE ? 0 : vLevel[vCliques[n].parent] + 1;
+			if (vLevel[n] >= vvDown.size()) vvDown.resize(vLevel[n] + 1);
+			vvDown[vLevel[n]].push_back(n);
+		}
+
+		// =================================== Calculating messages ===================================
+		// Upward pass: the clique table is multiplied with the messages from the children and marginalized over the eliminated node
+		for (const vec_size_t &vCliqueIdx : vvUp)
+			parallel::parallel_for_each(vCliqueIdx.begin(), vCliqueIdx.end(), [&, nStates](size_t n) {
+				SClique &clique = vCliques[n];
+				for (size_t c : clique.vChildren) {
+					SClique &child = vCliques[c];
+					child.vMsgIdx = getSubIndexes(clique.vVars, vec_size_t(child.vVars.begin() + 1, child.vVars.end()), clique.vTable.size(), nStates);
+					for (size_t i = 0; i < clique.vTable.size(); i++) clique.vTable[i] *= child.vMsg[child.vMsgIdx[i]];
+				} // c
+				normalize(clique.vTable);
+				
+				if (clique.parent == NONE) return;
+				clique.vMsg.assign(clique.vTable.size() / nStates, 0.0f);
+				for (size_t i = 0; i < clique.vTable.size(); i++) {
+					float &msg = clique.vMsg[i / nStates];
+					msg = maxSum ? MAX(msg, clique.vTable[i]) : msg + clique.vTable[i];
+				}
+			});
+
+		// Downward pass: the belief of the parent clique, marginalized over the separator and divided by the upward message, is multiplied into the clique table
+		for (size_t l = 1; l < vvDown.size(); l++)
+			parallel::parallel_for_each(vvDown[l].begin(), vvDown[l].end(), [&, nStates](size_t n) {
+				SClique		  &clique = vCliques[n];
+				const SClique &parent = vCliques[clique.parent];
+				vec_float_t vDown(clique.vMsg.size(), 0.0f);
+				for (size_t i = 0; i < parent.vTable.size(); i++) {
+					float &down = vDown[clique.vMsgIdx[i]];
+					down = maxSum ? MAX(down, parent.vTable[i]) : down + parent.vTable[i];
+				}
+				for (size_t j = 0; j < vDown.size(); j++) 
+					vDown[j] = clique.vMsg[j] > 0 ? vDown[j] / clique.vMsg[j] : 0.0f;
+				for (size_t i = 0; i < clique.vTable.size(); i++) clique.vTable[i] *= vDown[i / nStates];
+				normalize(clique.vTable);
+			});
+
+		// =================================== Calculating beliefs ===================================
+		parallel::parallel_for(size_t(0), nNodes, [&, nStates](size_t n) {
+			const SClique &clique = vCliques[n];
+			float *pot = graph.getNodePot(n);
+			std::fill(pot, pot + nStates, 0.0f);
+			for (size_t i = 0; i < clique.vTable.size(); i++)
+				pot[i % nStates] = maxSum ? MAX(pot[i % nStates], clique.vTable[i]) : pot[i % nStates] + clique.vTable[i];
+			
+			float SUM_pot = 0;
+			for (byte s = 0; s < nStates; s++) SUM_pot += pot[s];
+			for (byte s = 0; s < nStates; s++) pot[s] = SUM_pot > 0 ? pot[s] / SUM_pot : 1.0f / nStates;
+		});
+	}
+
+	// ------------------------------ PROTECTED ------------------------------
+	vec_size_t CInferJunctionTree::getEliminationOrder(std::vector<vec_size_t> &vvNeighbours) const
+	{
+		const CGraphPairwise &graph  = getGraphPairwise();
+		const size_t		  nNodes = graph.getNumNodes();
+
+		// Undirected adjacency
+		std::vector<std::set<size_t>> vAdj(nNodes);
+		for (size_t n = 0; n < nNodes; n++)
+			for (size_t e_t : graph.getOutEdges(n)) {
+				const size_t dst = graph.m_vEdgeDst[e_t];
+				if (dst == n) continue;
+				vAdj[n].insert(dst);
+				vAdj[dst].insert(n);
+			}
+
+		// Number of edges, which would be added between the neighbours of the node by its elimination
+		auto getFill = [&vAdj](size_t n) {
+			size_t res = 0;
+			for (auto a = vAdj[n].begin(); a != vAdj[n].end(); a++)
+				for (auto b = std::next(a); b != vAdj[n].end(); b++)
+					if (vAdj[*a].find(*b) == vAdj[*a].end()) res++;
+			return res;
+		};
+
+		vec_size_t							vFill(nNodes);
+		std::set<std::pair<size_t, size_t>>	queue;											// (fill, node) pairs of the not eliminated nodes
+		for (size_t n = 0; n < nNodes; n++) {
+			vFill[n] = getFill(n);
+			queue.emplace(vFill[n], n);
+		}
+
+		vec_size_t res;
+		res.reserve(nNodes);
+		vvNeighbours.assign(nNodes, vec_size_t());
+		std::set<size_t> affected;
+		while (!queue.empty()) {
+			const size_t n = queue.begin()->second;
+			queue.erase(queue.begin());
+			res.push_back(n);
+			vvNeighbours[n].assign(vAdj[n].begin(), vAdj[n].end());
+
+			// Elimination: the neighbours of the node are connected with each other
+			for (size_t a : vvNeighbours[n]) {
+				vAdj[a].erase(n);
+				for (size_t b : vvNeighbours[n])
+					if (a != b) vAdj[a].insert(b);
+			}
+
+			// Only the fill of the neighbours and of their neighbours may change
+			affected.clear();
+			for (size_t a : vvNeighbours[n]) {
+				affected.insert(a);
+				affected.insert(vAdj[a].begin(), vAdj[a].end());
+			}
+			for (size_t a : affected) {
+				queue.erase(std::make_pair(vFill[a], a));
+				vFill[a] = getFill(a);
+				queue.emplace(vFill[a], a);
+			}
+		} // while
+
+		return res;
+	}
+}
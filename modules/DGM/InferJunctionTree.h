@@ -0,0 +1,73 @@
+// Junction tree exact inference class interface
+#pragma once
+
+#include "Infer.h"
+#include "GraphPairwise.h"
+
+namespace DirectGraphicalModels
+{
+	// ============================= Junction Tree Infer Class =============================
+	/**
+	* @ingroup moduleDecode
+	* @brief Exact inference for graphs with low treewidth
+	* @details The graph is triangulated with the greedy \a min-fill heuristic: the nodes are eliminated one by one, every time choosing the node,
+	* whose elimination adds the least number of edges between its neighbours. The elimination of a node produces a clique of the node and its
+	* neighbours, and the cliques are connected into a junction tree, where the parent of a clique is the clique of the first eliminated neighbour.
+	* The exact \a sum-product (or \a max-product, ref. setMaxSum()) messages are then passed in the junction tree from the leafs to the root and 
+	* back, which takes \a O(nNodes x nStates<sup>w+1</sup>) time and memory for the graphs of treewidth \a w (\a e.g. \a w = 2 for ladders, 
+	* \a w = \a width for the grids and strips of \a width nodes). The cliques of one level of the junction tree are processed concurrently.
+	*
+	* In contrast to CInferExact, which is exponential in the number of nodes, and CInferTree, which requires a tree graph, this class is applicable 
+	* to large graphs, as long as their treewidth is small. As in CInferExact, the probability of a configuration is the product of all node and edge 
+	* potentials.
+	*/
+	class CInferJunctionTree : public CInfer
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		*/
+		DllExport CInferJunctionTree(CGraphPairwise &graph) : CInfer(graph), m_maxSum(false) {}
+		DllExport virtual ~CInferJunctionTree(void) = default;
+
+		/**
+		* @brief Exact inference
+		* @details This function estimates the marginal potentials (or the max-marginals in the \a max-product mode) for each graph node and 
+		* stores them as node potentials.
+		* @param nIt is not used
+		*/
+		DllExport virtual void	infer(unsigned int nIt = 0);
+		/**
+		* @brief Switches between the \a sum-product and the \a max-product inference
+		* @details In the \a max-product mode the node potentials are replaced with the max-marginals, thus CInfer::decode() returns the most 
+		* probable configuration (if it is unique)
+		* @param maxSum Flag indicating whether the \a max-product messages should be calculated
+		*/
+		DllExport void			setMaxSum(bool maxSum) { m_maxSum = maxSum; }
+		/**
+		* @brief Checks whether the \a max-product inference is performed
+		* @retval true if the \a max-product inference is performed
+		* @retval false otherwise
+		*/
+		DllExport bool			isMaxSum(void) const { return m_maxSum; }
+
+
+	protected:
+		/**
+		* @brief Returns the graph
+		* @return The graph
+		*/
+		CGraphPairwise& getGraphPairwise(void) const { return static_cast<CGraphPairwise&>(getGraph()); }
+		/**
+		* @brief Calculates the elimination order with the \a min-fill heuristic
+		* @param[out] vvNeighbours The neighbours of every node at the time of its elimination (sorted by the node index)
+		* @return The nodes in the order of their elimination
+		*/
+		vec_size_t				getEliminationOrder(std::vector<vec_size_t> &vvNeighbours) const;
+
+
+	private:
+		bool m_maxSum;			///< Flag indicating weather the max-product messages should be calculated
+	};
+}
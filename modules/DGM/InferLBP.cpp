@@ -1,40 +1,52 @@
 #include "InferLBP.h"
 #include "GraphPairwise.h"
+#include "parallel.h"
 
 namespace DirectGraphicalModels
 {
 	void CInferLBP::calculateMessages(unsigned int nIt)
 	{
-		const byte		nStates = getGraph().getNumStates();				// number of states
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();						// number of states
+		const size_t	  nNodes  = graph.getNumNodes();						// number of nodes
 		
 		// ======================== Main loop (iterative messages calculation) ========================
-#ifndef ENABLE_PPL
-		float *temp = new float[nStates];
+#ifdef ENABLE_PPL
+		size_t rangeSize = MAX(1, nNodes / (parallel::getNumThreads() * 10));
+#else
+		size_t rangeSize = MAX(1, nNodes);
 #endif
-		for (unsigned int i = 0; i < nIt; i++) {								// iterations
+		const size_t	nRanges	  = (nNodes + rangeSize - 1) / rangeSize;
+		const float		tolerance = getTolerance();
+		vec_float_t		vDelta(nRanges, 0.0f);											// maximal change of the messages in every range of nodes
+		unsigned int	i;
+		for (i = 0; i < nIt; i++) {												// iterations
 #ifdef DEBUG_PRINT_INFO
 			if (i == 0) printf("\n");
 			if (i % 5 == 0) printf("--- It: %d ---\n", i);
 #endif
-#ifdef ENABLE_PPL
-			concurrency::parallel_for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&, nStates](ptr_node_t &node) {		// all nodes
+			parallel::parallel_for(size_t(0), nNodes, rangeSize, [&, nStates](size_t first) {
 				float *temp = new float[nStates];
-#else
-			std::for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&](ptr_node_t &node) {
-#endif
-				// Calculate a message to each neighbor
-				for (size_t e_t : node->to) {									// outgoing edges
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();		// current outgoing edge
-					calculateMessage(*edge_to, temp, getMessageTemp(e_t), m_maxSum);
-				} // e_t;
-#ifdef ENABLE_PPL
+				float  delta = 0;
+				for (size_t n = first; (n < first + rangeSize) && (n < nNodes); n++)	// nodes
+					// Calculate a message to each neighbor
+					for (size_t e_t : graph.getOutEdges(n)) {					// outgoing edges
+						float *msg = getMessageTemp(e_t);
+						calculateMessage(e_t, temp, msg, m_maxSum);
+						if (tolerance > 0) {
+							const float *oldMsg = getMessage(e_t);
+							for (byte s = 0; s < nStates; s++) delta = MAX(delta, fabs(msg[s] - oldMsg[s]));
+						}
+					}
+				vDelta[first / rangeSize] = delta;
 				delete[] temp;
-#endif
 			}); // nodes
 			swapMessages();														// Coping data from msg_temp to msg
+			if (tolerance > 0 && std::all_of(vDelta.begin(), vDelta.end(), [tolerance](float delta) { return delta < tolerance; })) {
+				i++;
+				break;
+			}
 		} // iterations
-#ifndef ENABLE_PPL
-		delete[] temp;
-#endif
+		setNumIterations(i);
 	}
 }
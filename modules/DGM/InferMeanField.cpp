@@ -0,0 +1,123 @@
+#include "InferMeanField.h"
+#include "parallel.h"
+
+namespace DirectGraphicalModels
+{
+	void CInferMeanField::infer(unsigned int nIt)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();						// number of states
+		const size_t	  nNodes  = graph.getNumNodes();						// number of nodes
+		const size_t	  nEdges  = graph.getNumEdges();						// number of edges
+		const size_t	  potSize = static_cast<size_t>(nStates) * nStates;
+		const float		  damping = m_damping;
+		const float		  tolerance = getTolerance();
+		auto			  log	  = [](float pot) { return logf(MAX(pot, FLT_MIN)); };
+
+		// ====================================== Initialization ======================================
+		graph.updateAdjacency();
+
+		// Logarithms of the node potentials and the initial marginals (normalized node potentials)
+		vec_float_t vLogNodePot(nNodes * nStates);
+		vec_float_t vQ(nNodes * nStates);
+		vec_float_t vQnew(nNodes * nStates);
+		parallel::parallel_for(size_t(0), nNodes, [&, nStates](size_t n) {
+			const float *pot = graph.getNodePot(n);
+			float		*Q	 = vQ.data() + n * nStates;
+			float sum = 0;
+			for (byte s = 0; s < nStates; s++) {
+				vLogNodePot[n * nStates + s] = log(pot[s]);
+				sum += pot[s];
+			}
+			for (byte s = 0; s < nStates; s++) Q[s] = sum > 0 ? pot[s] / sum : 1.0f / nStates;
+		});
+
+		// Logarithms of the edge potentials: calculated once for every distinct potential
+		vec_float_t	vLogEdgePot;
+		vec_size_t	vOffset(nEdges, std::numeric_limits<size_t>::max());
+		std::unordered_map<const float*, size_t> offsets;
+		for (size_t e = 0; e < nEdges; e++) {
+			const float *pot = graph.getEdgePot(e);
+			if (!pot) continue;
+			auto it = offsets.find(pot);
+			if (it == offsets.end()) {
+				it = offsets.emplace(pot, vLogEdgePot.size()).first;
+				for (size_t i = 0; i < potSize; i++) vLogEdgePot.push_back(log(pot[i]));
+			}
+			vOffset[e] = it->second;
+		} // e
+
+		// ================================= Calculating marginals ==================================
+		unsigned int i;
+		for (i = 0; i < nIt; i++) {													// iterations
+#ifdef DEBUG_PRINT_INFO
+			if (i == 0) printf("\n");
+			if (i % 5 == 0) printf("--- It: %d ---\n", i);
+#endif
+			parallel::parallel_for(size_t(0), nNodes, [&, nStates](size_t n) {
+				float *energy = vQnew.data() + n * nStates;
+				memcpy(energy, vLogNodePot.data() + n * nStates, nStates * sizeof(float));
+
+				// energy[s] += sum_t Q_k(t) * log(edge.Pot(t, s))
+				for (size_t e_f : graph.getInEdges(n)) {							// incoming edges
+					if (vOffset[e_f] == std::numeric_limits<size_t>::max()) continue;
+					const float *L = vLogEdgePot.data() + vOffset[e_f];
+					const float *Q = vQ.data() + graph.m_vEdgeSrc[e_f] * nStates;
+					if (nStates > 1 && graph.getEdgePotModel(e_f) == EdgePotModel::Potts) {
+						float off = 0;
+						for (byte t = 0; t < nStates; t++) off += Q[t] * L[t * nStates + (t ? 0 : 1)];
+						for (byte s = 0; s < nStates; s++) energy[s] += off + Q[s] * (L[s * nStates + s] - L[s * nStates + (s ? 0 : 1)]);
+					} else 
+						for (byte t = 0; t < nStates; t++) 
+							if (Q[t] > 0) 
+								for (byte s = 0; s < nStates; s++) energy[s] += Q[t] * L[t * nStates + s];
+				} // e_f
+
+				// energy[s] += sum_t Q_m(t) * log(edge.Pot(s, t))
+				for (size_t e_t : graph.getOutEdges(n)) {							// outgoing edges
+					if (vOffset[e_t] == std::numeric_limits<size_t>::max()) continue;
+					const float *L = vLogEdgePot.data() + vOffset[e_t];
+					const float *Q = vQ.data() + graph.m_vEdgeDst[e_t] * nStates;
+					if (nStates > 1 && graph.getEdgePotModel(e_t) == EdgePotModel::Potts) 
+						for (byte s = 0; s < nStates; s++) {
+							const float off = L[s * nStates + (s ? 0 : 1)];
+							energy[s] += off * (1 - Q[s]) + Q[s] * L[s * nStates + s];
+						}
+					else
+						for (byte s = 0; s < nStates; s++) {
+							float sum = 0;
+							for (byte t = 0; t < nStates; t++) sum += Q[t] * L[s * nStates + t];
+							energy[s] += sum;
+						}
+				} // e_t
+
+				// Normalization and damping
+				const float max = *std::max_element(energy, energy + nStates);
+				float sum = 0;
+				for (byte s = 0; s < nStates; s++) {
+					energy[s] = expf(energy[s] - max);
+					sum += energy[s];
+				}
+				const float *Q = vQ.data() + n * nStates;
+				for (byte s = 0; s < nStates; s++) energy[s] = (1 - damping) * energy[s] / sum + damping * Q[s];
+			});
+
+			// Convergence check: average KL-divergence between the marginals of the subsequent iterations
+			float kl = 0;
+			if (tolerance > 0)
+				for (size_t k = 0; k < vQ.size(); k++)
+					if (vQnew[k] > 0) kl += vQnew[k] * logf(vQnew[k] / MAX(vQ[k], FLT_MIN));
+			
+			vQ.swap(vQnew);
+			if (tolerance > 0 && kl / MAX(1, nNodes) < tolerance) {
+				i++;
+				break;
+			}
+		} // iterations
+		setNumIterations(i);
+
+		// Setting the marginals as node potentials
+		for (size_t n = 0; n < nNodes; n++)
+			memcpy(graph.getNodePot(n), vQ.data() + n * nStates, nStates * sizeof(float));
+	}
+}
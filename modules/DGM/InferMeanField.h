@@ -0,0 +1,57 @@
+// Mean-field inference class interface
+#pragma once
+
+#include "Infer.h"
+#include "GraphPairwise.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	// ================================ Mean-Field Infer Class ===============================
+	/**
+	* @ingroup moduleDecode
+	* @brief Mean-field inference class for pairwise graphs
+	* @details This class approximates the marginals with the fully factorized distribution \f$Q(x) = \prod_n Q_n(x_n)\f$, which is found by 
+	* the iterative update \f$Q_n(s)\propto\psi_n(s)\exp\Big(\sum_{(k,n)}\sum_t Q_k(t)\log\psi_{k,n}(t,s) + \sum_{(n,m)}\sum_t Q_m(t)\log\psi_{n,m}(s,t)\Big)\f$.
+	* In contrast to the message passing algorithms, which keep \a nStates values for every edge, only \a nStates values for every node are kept,
+	* and the nodes are updated in parallel from the marginals of the previous iteration. For the Potts edge potentials (ref. CGraphPairwise::setEdges()) 
+	* the update of a node costs \a O(nStates) operations per edge instead of \a O(nStates<sup>2</sup>).
+	* > The parallel update may oscillate on the graphs with strong edge potentials: the damping (ref. setDamping()) slows down the update and 
+	* helps convergence (ref. CInfer::setTolerance()).
+	*/
+	class CInferMeanField : public CInfer
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		*/
+		DllExport CInferMeanField(CGraphPairwise &graph) : CInfer(graph), m_damping(0.0f) {}
+		DllExport virtual ~CInferMeanField(void) = default;
+
+		DllExport virtual void	infer(unsigned int nIt = 1);
+		/**
+		* @brief Sets the damping factor
+		* @details With the damping factor \f$\lambda\f$ the marginals are updated as \f$Q = (1 - \lambda)Q_{new} + \lambda Q_{old}\f$
+		* @param damping The damping factor \f$\lambda\in[0; 1)\f$. Zero disables the damping (default)
+		*/
+		DllExport void			setDamping(float damping) { DGM_ASSERT(damping >= 0 && damping < 1); m_damping = damping; }
+		/**
+		* @brief Returns the damping factor
+		* @return The damping factor
+		*/
+		DllExport float			getDamping(void) const { return m_damping; }
+
+
+	protected:
+		/**
+		* @brief Returns the graph
+		* @return The graph
+		*/
+		CGraphPairwise& getGraphPairwise(void) const { return static_cast<CGraphPairwise&>(getGraph()); }
+
+
+	private:
+		float	m_damping;		///< The damping factor
+	};
+}
@@ -0,0 +1,130 @@
+#include "InferMultiScaleBP.h"
+#include "GraphGrid.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	namespace {
+		// Returns the edges of a 4-connected grid, indexed as node * 4 + direction, where the directions are: +x, -x, +y, -y
+		vec_size_t getGridEdges(const CGraphPairwise &graph, const vec_size_t &vSrc, const vec_size_t &vDst, Size size, size_t none)
+		{
+			vec_size_t res(graph.getNumNodes() * 4, none);
+			for (size_t e = 0; e < vSrc.size(); e++) {
+				const int dx = static_cast<int>(vDst[e] % size.width) - static_cast<int>(vSrc[e] % size.width);
+				const int dy = static_cast<int>(vDst[e] / size.width) - static_cast<int>(vSrc[e] / size.width);
+				int dir = -1;
+				if		(dy == 0 && dx == 1)	dir = 0;
+				else if (dy == 0 && dx == -1)	dir = 1;
+				else if (dx == 0 && dy == 1)	dir = 2;
+				else if (dx == 0 && dy == -1)	dir = 3;
+				DGM_ASSERT_MSG(dir >= 0, "The edge (%zu -> %zu) does not connect horizontal or vertical neighbours: only 4-connected grids are supported", vSrc[e], vDst[e]);
+				res[vSrc[e] * 4 + dir] = e;
+			}
+			return res;
+		}
+	}
+
+	void CInferMultiScaleBP::calculateMessages(unsigned int nIt)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();						// number of states
+		const bool		  logDomain = isLogDomain();
+
+		const CGraphGrid *pGraphGrid = dynamic_cast<const CGraphGrid *>(&graph);
+		const Size size = pGraphGrid ? pGraphGrid->getSize() : m_size;
+		if (pGraphGrid) DGM_ASSERT_MSG(pGraphGrid->getNumLayers() == 1, "Multi-layer grids are not supported");
+		DGM_ASSERT_MSG(static_cast<size_t>(size.width) * size.height == graph.getNumNodes(), "The grid size (%d x %d) does not match the number of nodes %zu", 
+			size.width, size.height, graph.getNumNodes());
+
+		if (m_nLevels > 1 && (size.width > 1 || size.height > 1)) {
+			// ================================ Building the coarser grid ================================
+			const Size	coarseSize((size.width + 1) / 2, (size.height + 1) / 2);
+			CGraphGrid	coarseGrid(nStates);
+			coarseGrid.build(coarseSize);
+			CGraphPairwise &coarse = coarseGrid;
+
+			// Node potentials: product of the potentials of the 2 x 2 block
+			for (int Y = 0; Y < coarseSize.height; Y++)
+				for (int X = 0; X < coarseSize.width; X++) {
+					float *pot = coarse.getNodePot(coarseGrid.getNodeIdx(X, Y));
+					std::fill(pot, pot + nStates, logDomain ? 0.0f : 1.0f);
+					for (int y = 2 * Y; y < MIN(2 * Y + 2, size.height); y++)
+						for (int x = 2 * X; x < MIN(2 * X + 2, size.width); x++) {
+							const float *finePot = graph.getNodePot(static_cast<size_t>(y) * size.width + x);
+							for (byte s = 0; s < nStates; s++) {
+								if (logDomain)	pot[s] += finePot[s];
+								else			pot[s] *= finePot[s];
+							}
+						} // x
+					
+					// Normalization (the coarse potentials are always in the probability domain)
+					float max = *std::max_element(pot, pot + nStates);
+					if (logDomain) {
+						if (max == -std::numeric_limits<float>::infinity()) std::fill(pot, pot + nStates, 1.0f);
+						else for (byte s = 0; s < nStates; s++) pot[s] = expf(pot[s] - max);
+					} else {
+						if (max > 0) for (byte s = 0; s < nStates; s++) pot[s] /= max;
+						else std::fill(pot, pot + nStates, 1.0f);
+					}
+				} // X
+
+			// Edge potentials: potentials of the finer edges, crossing the block boundaries
+			const vec_size_t vFineEdges	  = getGridEdges(graph, graph.m_vEdgeSrc, graph.m_vEdgeDst, size, CGraphPairwise::EDGE_NONE);
+			const vec_size_t vCoarseEdges = getGridEdges(coarse, coarse.m_vEdgeSrc, coarse.m_vEdgeDst, coarseSize, CGraphPairwise::EDGE_NONE);
+			for (size_t n = 0; n < coarse.getNumNodes(); n++) {
+				const int X = static_cast<int>(n % coarseSize.width);
+				const int Y = static_cast<int>(n / coarseSize.width);
+				for (int dir = 0; dir < 4; dir++) {
+					const size_t ce = vCoarseEdges[n * 4 + dir];
+					if (ce == CGraphPairwise::EDGE_NONE) continue;
+					const int x = MIN(2 * X + (dir == 0 ? 1 : 0), size.width - 1);
+					const int y = MIN(2 * Y + (dir == 2 ? 1 : 0), size.height - 1);
+					const size_t fe = vFineEdges[(static_cast<size_t>(y) * size.width + x) * 4 + dir];
+					if (fe == CGraphPairwise::EDGE_NONE) continue;
+					
+					const byte flags = graph.m_vEdgeFlags[fe];
+					if (!(flags & CGraphPairwise::EDGE_POT)) continue;
+					if (flags & CGraphPairwise::EDGE_SHARED) {
+						coarse.m_vEdgeGroup[ce] = graph.m_vEdgeGroup[fe];
+						coarse.m_vEdgeFlags[ce] = CGraphPairwise::EDGE_POT | CGraphPairwise::EDGE_SHARED;
+					} else {
+						coarse.allocateEdgePots();
+						memcpy(coarse.m_vEdgePots.data() + ce * nStates * nStates, graph.getEdgePot(fe), nStates * nStates * sizeof(float));
+						coarse.m_vEdgeFlags[ce] = CGraphPairwise::EDGE_POT | (flags & CGraphPairwise::EDGE_POTTS);
+					}
+				} // dir
+			} // n
+			coarse.m_vGroupPots	  = graph.m_vGroupPots;
+			coarse.m_vGroupModels = graph.m_vGroupModels;
+
+			// ==================================== Coarser inference ====================================
+			CInferMultiScaleBP coarseInferer(coarse, m_nLevels - 1);
+			coarseInferer.setLogDomain(logDomain);
+			coarseInferer.setTolerance(getTolerance());
+			if (logDomain) {
+				coarseInferer.createLogPotentials();
+				coarseInferer.createMessages(0.0f);
+			} else
+				coarseInferer.createMessages(1.0f / nStates);
+			coarseInferer.calculateMessages(nIt);
+
+			// Initialization of the messages with the coarser messages in the same direction
+			for (size_t n = 0; n < graph.getNumNodes(); n++) {
+				const int x = static_cast<int>(n % size.width);
+				const int y = static_cast<int>(n / size.width);
+				for (int dir = 0; dir < 4; dir++) {
+					const size_t e = vFineEdges[n * 4 + dir];
+					const size_t ce = vCoarseEdges[coarseGrid.getNodeIdx(x / 2, y / 2) * 4 + dir];
+					if (e != CGraphPairwise::EDGE_NONE && ce != CGraphPairwise::EDGE_NONE) 
+						memcpy(getMessage(e), coarseInferer.getMessage(ce), nStates * sizeof(float));
+				} // dir
+			} // n
+
+			coarseInferer.deleteMessages();
+			coarseInferer.deleteLogPotentials();
+		}
+
+		// ==================================== Finer inference ====================================
+		CInferLBP::calculateMessages(nIt);
+	}
+}
@@ -0,0 +1,50 @@
+// Multi-scale (coarse-to-fine) Belief Propagation inference class interface
+#pragma once
+
+#include "InferLBP.h"
+
+namespace DirectGraphicalModels
+{
+	// ==================== Multi-scale Belief Propagation Infer Class ==================
+	/**
+	* @ingroup moduleDecode
+	* @brief Sum product Multi-scale (coarse-to-fine) Belief Propagation inference class
+	* @details This class is based on the hierarchical belief propagation, described in the paper 
+	* \"Efficient Belief Propagation for Early Vision\" by P. Felzenszwalb and D. Huttenlocher (IJCV 2006).
+	* The graph must be a 4-connected single-layer grid, \a i.e. CGraphGrid or the CGraphPairwise built with CGraphLayeredExt::buildGraph().
+	* A pyramid of coarser grids is built, where every node of a coarser grid corresponds to a block of 2 x 2 nodes of the finer grid: its potential 
+	* is the product of the potentials of the block nodes, and its edges get the potentials of the finer edges, crossing the block boundaries.
+	* The loopy belief propagation (ref. CInferLBP) is run for \a nIt iterations on every level of the pyramid, starting from the coarsest one, 
+	* and the messages of every finer level are initialized with the messages of the corresponding coarser level, sent in the same direction. 
+	* Thus the information is propagated across large homogeneous regions within a few iterations, and much less iterations are needed on the
+	* original grid to reach the same quality.
+	* > The function CInfer::getNumIterations() returns the number of iterations, performed on the original grid.
+	*/
+	class CInferMultiScaleBP : public CInferLBP
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		* @param nLevels The number of levels of the pyramid, including the original grid
+		*/			
+		DllExport CInferMultiScaleBP(CGraphPairwise &graph, byte nLevels = 5) : CInferLBP(graph), m_nLevels(nLevels), m_size(Size(0, 0)) {}
+		DllExport virtual ~CInferMultiScaleBP(void) = default;
+
+		/**
+		* @brief Sets the size of the grid
+		* @details This function is needed only for the CGraphPairwise graphs: the size of the CGraphGrid graphs is known
+		* @param size The size of the grid (image resolution), as given to CGraphLayeredExt::buildGraph()
+		*/
+		DllExport void	setSize(Size size) { m_size = size; }
+
+
+	protected:
+		DllExport virtual void	calculateMessages(unsigned int nIt);
+
+
+	private:
+		byte	m_nLevels;		///< Number of levels of the pyramid
+		Size	m_size;			///< Size of the grid
+	};
+}
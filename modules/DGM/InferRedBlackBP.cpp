@@ -0,0 +1,57 @@
+#include "InferRedBlackBP.h"
+#include "GraphPairwise.h"
+#include "parallel.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	void CInferRedBlackBP::calculateMessages(unsigned int nIt)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();						// number of states
+		const float		  tolerance = getTolerance();
+
+		const std::vector<vec_size_t> &vvNodes = graph.colorNodes();
+
+		// ======================== Main loop (iterative messages calculation) ========================
+		vec_float_t		vDelta;														// maximal change of the messages in every range of nodes
+		unsigned int	i;
+		for (i = 0; i < nIt; i++) {												// iterations
+#ifdef DEBUG_PRINT_INFO
+			if (i == 0) printf("\n");
+			if (i % 5 == 0) printf("--- It: %d ---\n", i);
+#endif
+			float maxDelta = 0;
+			for (const vec_size_t &vNodes : vvNodes) {								// colors
+				const size_t nNodes = vNodes.size();
+#ifdef ENABLE_PPL
+				size_t rangeSize = MAX(1, nNodes / (parallel::getNumThreads() * 10));
+#else
+				size_t rangeSize = MAX(1, nNodes);
+#endif
+				vDelta.assign((nNodes + rangeSize - 1) / rangeSize, 0.0f);
+				parallel::parallel_for(size_t(0), nNodes, rangeSize, [&, nStates, rangeSize](size_t first) {
+					float *temp	  = new float[2 * nStates];
+					float *newMsg = temp + nStates;
+					float  delta  = 0;
+					for (size_t k = first; (k < first + rangeSize) && (k < nNodes); k++)	// nodes of the current color
+						// Calculate a message to each neighbor in place
+						for (size_t e_t : graph.getOutEdges(vNodes[k])) {				// outgoing edges
+							float *msg = getMessage(e_t);
+							calculateMessage(e_t, temp, newMsg, m_maxSum);
+							for (byte s = 0; s < nStates; s++) delta = MAX(delta, fabs(newMsg[s] - msg[s]));
+							memcpy(msg, newMsg, nStates * sizeof(float));
+						}
+					vDelta[first / rangeSize] = delta;
+					delete[] temp;
+				}); // nodes
+				for (float delta : vDelta) maxDelta = MAX(maxDelta, delta);
+			} // colors
+			if (tolerance > 0 && maxDelta < tolerance) {
+				i++;
+				break;
+			}
+		} // iterations
+		setNumIterations(i);
+	}
+}
@@ -0,0 +1,42 @@
+// Red-Black Belief Propagation inference class interface
+#pragma once
+
+#include "MessagePassing.h"
+
+namespace DirectGraphicalModels
+{
+	// ==================== Red-Black Belief Propagation Infer Class ==================
+	/**
+	* @ingroup moduleDecode
+	* @brief Sum product Red-Black (checkerboard) Belief Propagation inference class
+	* @details In contrast to the CInferLBP class, which calculates all the messages of an iteration from the messages of the previous iteration
+	* (\a Jacobi scheduling) and thus needs the temp message container, this class updates the messages in place (\a Gauss-Seidel scheduling). 
+	* The nodes of the graph are colored (ref. CGraphPairwise::colorNodes()), such that no two adjacent nodes have the same color; then in every iteration the outgoing messages 
+	* of all nodes of the first color are calculated in parallel, then of all nodes of the second color, \a etc. Since a message depends only on 
+	* the incoming messages of its source node, no message is read and written in the same phase. 
+	* For the 4-connected grid graphs (ref. CGraphGrid and CGraphLayeredExt) the coloring results in the red-black checkerboard pattern with 2 colors;
+	* the multi-layer and 8-connected grids need more colors.
+	* > The in-place updates propagate the information faster than the Jacobi scheduling, thus less iterations are needed for convergence 
+	* (ref. CInfer::setTolerance()), while only one message container is allocated.
+	*/
+	class CInferRedBlackBP : public CMessagePassing
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		*/			
+		DllExport CInferRedBlackBP(CGraphPairwise &graph) : CMessagePassing(graph, false), m_maxSum(false) {}
+		DllExport virtual ~CInferRedBlackBP(void) = default;
+
+
+	protected:
+		DllExport virtual void	calculateMessages(unsigned int nIt);
+		void					setMaxSum(bool maxSum) { m_maxSum = maxSum; }
+		bool					isMaxSum(void) const { return m_maxSum; }
+
+
+	private:
+		bool m_maxSum;			///< Flag indicating weather the max-sum messages should be calculated
+	};
+}
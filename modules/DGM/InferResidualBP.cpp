@@ -0,0 +1,72 @@
+#include "InferResidualBP.h"
+#include "GraphPairwise.h"
+#include "parallel.h"
+#include "macroses.h"
+#include <queue>
+
+namespace DirectGraphicalModels
+{
+	void CInferResidualBP::calculateMessages(unsigned int nIt)
+	{
+		CGraphPairwise	& graph		 = getGraphPairwise();
+		const byte		  nStates	 = graph.getNumStates();						// number of states
+		const size_t	  nEdges	 = graph.getNumEdges();							// number of edges
+		const size_t	  maxUpdates = static_cast<size_t>(nIt) * nEdges;			// the same number of updates as in nIt iterations of LBP
+		const float		  tolerance	 = getTolerance() > 0 ? getTolerance() : FLT_EPSILON;
+
+		vec_float_t vResidual(nEdges);												// residuals of the pending messages (kept in the temp messages)
+		
+		// Calculates the pending message and its residual
+		auto calculateResidual = [&, nStates](size_t edge, float *temp) {
+			float		*newMsg = getMessageTemp(edge);
+			const float *msg	= getMessage(edge);
+			calculateMessage(edge, temp, newMsg, m_maxSum);
+			float residual = 0;
+			for (byte s = 0; s < nStates; s++) residual = MAX(residual, fabs(newMsg[s] - msg[s]));
+			vResidual[edge] = residual;
+		};
+
+		// ====================================== Initialization ======================================
+#ifdef ENABLE_PPL
+		size_t rangeSize = MAX(1, nEdges / (parallel::getNumThreads() * 10));
+#else
+		size_t rangeSize = MAX(1, nEdges);
+#endif
+		parallel::parallel_for(size_t(0), nEdges, rangeSize, [&, nStates, rangeSize](size_t first) {
+			float *temp = new float[nStates];
+			for (size_t e = first; (e < first + rangeSize) && (e < nEdges); e++)
+				calculateResidual(e, temp);
+			delete[] temp;
+		});
+
+		std::priority_queue<std::pair<float, size_t>> queue;						// (residual, edge)
+		for (size_t e = 0; e < nEdges; e++)
+			if (vResidual[e] >= tolerance) queue.emplace(vResidual[e], e);
+
+		// =================================== Calculating messages ==================================
+		float  *temp	 = new float[nStates];
+		size_t	nUpdates = 0;
+		while (!queue.empty() && nUpdates < maxUpdates) {
+			auto [residual, e] = queue.top();
+			queue.pop();
+			if (residual != vResidual[e]) continue;								// outdated entry
+
+			// Update the message with the largest residual
+			memcpy(getMessage(e), getMessageTemp(e), nStates * sizeof(float));
+			vResidual[e] = 0;
+			nUpdates++;
+
+			// Recalculate the messages, which depend on the updated one
+			const size_t src = graph.m_vEdgeSrc[e];
+			const size_t dst = graph.m_vEdgeDst[e];
+			for (size_t e_t : graph.getOutEdges(dst)) {
+				if (graph.m_vEdgeDst[e_t] == src) continue;
+				calculateResidual(e_t, temp);
+				if (vResidual[e_t] >= tolerance) queue.emplace(vResidual[e_t], e_t);
+			} // e_t
+		} // while
+		delete[] temp;
+
+		setNumIterations(nEdges ? static_cast<unsigned int>((nUpdates + nEdges - 1) / nEdges) : 0);
+	}
+}
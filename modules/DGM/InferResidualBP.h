@@ -0,0 +1,42 @@
+// Residual Belief Propagation inference class interface
+#pragma once
+
+#include "MessagePassing.h"
+
+namespace DirectGraphicalModels
+{
+	// ==================== Residual Belief Propagation Infer Class ==================
+	/**
+	* @ingroup moduleDecode
+	* @brief Sum product Residual Belief Propagation inference class
+	* @details This class is based on the asynchronous message passing algorithm, described in the paper 
+	* \"Residual Belief Propagation: Informed Scheduling for Asynchronous Message Passing\" by G. Elidan, I. McGraw and D. Koller (UAI 2006).
+	* In contrast to the CInferLBP class, which recalculates all the messages in every iteration, this class keeps a priority queue of the 
+	* pending messages, ordered by their residuals (\a i.e. the maximal difference between the pending and the current message), and always 
+	* updates the message with the largest residual first. After the update only the messages, which depend on the updated message, are recalculated.
+	* Thus the regions of the graph, where the messages have already converged, are not processed any more.
+	* > The algorithm stops when all residuals are smaller than the tolerance (ref. CInfer::setTolerance(); FLT_EPSILON if not set) or when the number of 
+	* message updates reaches \a nIt x \a nEdges, \a i.e. the number of updates, performed by CInferLBP in \a nIt iterations. 
+	* The function CInfer::getNumIterations() returns the number of performed message updates, divided by the number of edges.
+	*/
+	class CInferResidualBP : public CMessagePassing
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		*/			
+		DllExport CInferResidualBP(CGraphPairwise &graph) : CMessagePassing(graph), m_maxSum(false) {}
+		DllExport virtual ~CInferResidualBP(void) = default;
+
+
+	protected:
+		DllExport virtual void	calculateMessages(unsigned int nIt);
+		void					setMaxSum(bool maxSum) { m_maxSum = maxSum; }
+		bool					isMaxSum(void) const { return m_maxSum; }
+
+
+	private:
+		bool m_maxSum;			///< Flag indicating weather the max-sum messages should be calculated
+	};
+}
@@ -1,145 +1,276 @@
 #include "InferTRW.h"
 #include "GraphPairwise.h"
+#include "parallel.h"
+#include "kernels.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels
 {
 	void CInferTRW::infer(unsigned int nIt)
 	{
-		const byte nStates = getGraph().getNumStates();					// number of states (classes)
-
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();					// number of states (classes)
+		const size_t	  nNodes  = graph.getNumNodes();					// number of nodes
+		
 		// ====================================== Initialization ======================================			
-		createMessages(1.0f);
+		graph.updateAdjacency();
+		if (isLogDomain()) {
+			createLogPotentials();
+			createMessages(0.0f);
+		} else
+			createMessages(1.0f);
 
 		// =================================== Calculating messages ==================================	
-
 		calculateMessages(nIt);
 
 		// =================================== Calculating beliefs ===================================	
+		vec_byte_t sol(nNodes, 0);
+		for (size_t n = 0; n < nNodes; n++) {
+			float *pot = graph.getNodePot(n);
+			
+			if (isLogDomain()) {
+				// backward edges
+				for (size_t e_f : graph.getInEdges(n)) {
+					size_t src = graph.m_vEdgeSrc[e_f];
+					if (src > n) continue;
+					const float *logEdgePot = getLogEdgePot(e_f);
+					if (logEdgePot)
+						for (byte s = 0; s < nStates; s++) pot[s] += logEdgePot[sol[src] * nStates + s];
+				}
+
+				// forward edges
+				for (size_t e_t : graph.getOutEdges(n)) {
+					if (n > graph.m_vEdgeDst[e_t]) continue;
+					float *msg = getMessage(e_t);
+					for (byte s = 0; s < nStates; s++) pot[s] += msg[s];
+				}
+
+				sol[n] = static_cast<byte>(std::max_element(pot, pot + nStates) - pot);
+
+				// Conversion to the probability domain
+				float max = pot[sol[n]];
+				if (max == -std::numeric_limits<float>::infinity())
+					std::fill(pot, pot + nStates, 1.0f);
+				else
+					for (byte s = 0; s < nStates; s++) pot[s] = expf(pot[s] - max);
+				continue;
+			}
 
-		for (ptr_node_t &node : getGraphPairwise().m_vNodes) {
 			// backward edges
-			for (size_t e_f : node->from) {
-				Edge * edge_from = getGraphPairwise().m_vEdges[e_f].get();
-				if (edge_from->node1 > edge_from->node2) continue;
-				Node *src = getGraphPairwise().m_vNodes[edge_from->node1].get();
-				for (byte s = 0; s < nStates; s++) node->Pot.at<float>(s, 0) *= edge_from->Pot.at<float>(src->sol, s);
+			for (size_t e_f : graph.getInEdges(n)) {
+				size_t src = graph.m_vEdgeSrc[e_f];
+				if (src > n) continue;
+				const float *edgePot = graph.getEdgePot(e_f);
+				if (edgePot) 
+					for (byte s = 0; s < nStates; s++) pot[s] *= edgePot[sol[src] * nStates + s];
 			}
+
 			// forward edges
-			for (size_t e_t : node->to) {
-				Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-				if (edge_to->node1 > edge_to->node2) continue;
+			for (size_t e_t : graph.getOutEdges(n)) {
+				if (n > graph.m_vEdgeDst[e_t]) continue;
 				float *msg = getMessage(e_t);
-				for (byte s = 0; s < nStates; s++) node->Pot.at<float>(s, 0) *= msg[s];
+				for (byte s = 0; s < nStates; s++) pot[s] *= msg[s];
 			}
 
-			Point extremumLoc;
-			minMaxLoc(node->Pot, NULL, NULL, NULL, &extremumLoc);
-			node->sol = static_cast<byte> (extremumLoc.y);
+			sol[n] = static_cast<byte>(std::max_element(pot, pot + nStates) - pot);
 		}
 
 		deleteMessages();
+		deleteLogPotentials();
 	}
 
 	void CInferTRW::calculateMessages(unsigned int nIt)
 	{
-		const    byte	  nStates	= getGraph().getNumStates();										// number of states
-		float			* data		= new float[nStates];
-		float			* temp		= new float[nStates];
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const byte		  nStates	= graph.getNumStates();								// number of states
+		const size_t	  nNodes	= graph.getNumNodes();								// number of nodes
+		const size_t	  nEdges	= graph.getNumEdges();								// number of edges
+		const bool		  logDomain	= isLogDomain();
+		const float		  tolerance	= getTolerance();
+
+		// data = data * msg in the probability domain and data = data + msg in the log domain
+		auto combine = [nStates, logDomain](float *data, const float *msg) {
+			if (logDomain)	for (byte s = 0; s < nStates; s++) data[s] += msg[s];
+			else			for (byte s = 0; s < nStates; s++) data[s] *= msg[s];
+		};
+		// data = data ^ (1 / k) in the probability domain and data = data / k in the log domain
+		auto scale = [nStates, logDomain](float *data, int k) {
+			if (logDomain)	for (byte s = 0; s < nStates; s++) data[s] /= k;
+			else			for (byte s = 0; s < nStates; s++) data[s] = static_cast<float>(fastPow(data[s], 1.0f / k));
+		};
+
+		// Forward pass step: pass messages from node n to the nodes with higher m_ordering
+		auto forward = [&, nStates](size_t n) {
+			float data[256], temp[256];
+			memcpy(data, graph.getNodePot(n), nStates * sizeof(float));				// data = node.pot
+			
+			int	nForward = 0;
+			for (size_t e_t : graph.getOutEdges(n)) {
+				if (n > graph.m_vEdgeDst[e_t]) continue;
+				combine(data, getMessage(e_t));											// data = node.pot * edge_to.msg
+				nForward++;
+			} // e_t
+			
+			int	nBackward = 0;
+			for (size_t e_f : graph.getInEdges(n)) {
+				if (graph.m_vEdgeSrc[e_f] > n) continue;
+				combine(data, getMessage(e_f));											// data = node.pot * edge_to.msg * edge_from.msg
+				nBackward++;
+			} // e_f
+
+			scale(data, MAX(nForward, nBackward));
+
+			for (size_t e_t : graph.getOutEdges(n))
+				if (n < graph.m_vEdgeDst[e_t]) calculateMessage(getMessage(e_t), e_t, temp, data);
+		};
+
+		// Backward pass step: pass messages from node n to the nodes with smaller m_ordering
+		auto backward = [&, nStates](size_t n) {
+			float data[256], temp[256];
+			memcpy(data, graph.getNodePot(n), nStates * sizeof(float));				// data = node.pot
+			
+			int	nForward = 0;
+			for (size_t e_t : graph.getOutEdges(n)) {
+				if (n > graph.m_vEdgeDst[e_t]) continue;
+				combine(data, getMessage(e_t));
+				nForward++;
+			} // e_t
+
+			int	nBackward = 0;
+			for (size_t e_f : graph.getInEdges(n)) {
+				if (graph.m_vEdgeSrc[e_f] > n) continue;
+				combine(data, getMessage(e_f));
+				nBackward++;
+			} // e_f
+
+			// normalize data
+			float max = data[0];
+			for (byte s = 1; s < nStates; s++) if (max < data[s]) max = data[s];
+			if (logDomain)	for (byte s = 0; s < nStates; s++) data[s] -= max;
+			else			for (byte s = 0; s < nStates; s++) data[s] /= max;
+
+			scale(data, MAX(nForward, nBackward));
+
+			for (size_t e_f : graph.getInEdges(n))
+				if (graph.m_vEdgeSrc[e_f] < n) calculateMessage(getMessage(e_f), e_f, temp, data);
+		};
+
+#ifdef ENABLE_PPL
+		// Wavefronts: a node depends only on its neighbors, preceding it in the pass, thus all nodes with the same distance from 
+		// the beginning of the pass are independent and may be processed concurrently with the same result as in the sequential order
+		// (for the grid graphs the wavefronts are the anti-diagonals of the grid)
+		std::vector<vec_size_t> vvForward, vvBackward;
+		vec_size_t vLevel(nNodes, 0);
+		for (size_t n = 0; n < nNodes; n++) {
+			for (size_t e_f : graph.getInEdges(n)) {
+				size_t src = graph.m_vEdgeSrc[e_f];
+				if (src < n) vLevel[n] = MAX(vLevel[n], vLevel[src] + 1);
+			}
+			if (vLevel[n] == vvForward.size()) vvForward.emplace_back();
+			vvForward[vLevel[n]].push_back(n);
+		} // n
+		std::fill(vLevel.begin(), vLevel.end(), 0);
+		for (size_t n = nNodes; n-- > 0; ) {
+			for (size_t e_t : graph.getOutEdges(n)) {
+				size_t dst = graph.m_vEdgeDst[e_t];
+				if (dst > n) vLevel[n] = MAX(vLevel[n], vLevel[dst] + 1);
+			}
+			if (vLevel[n] == vvBackward.size()) vvBackward.emplace_back();
+			vvBackward[vLevel[n]].push_back(n);
+		} // n
+#endif
 
 		// main loop
-		for (unsigned int i = 0; i < nIt; i++) {										// iterations
+		unsigned int i;
+		for (i = 0; i < nIt; i++) {														// iterations
 	#ifdef DEBUG_PRINT_INFO
 			if (i == 0) printf("\n");
 			if (i % 5 == 0) printf("--- It: %d ---\n", i);
 	#endif
-			// Forward pass
-			std::for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&](ptr_node_t &node) {
-				memcpy(data, node->Pot.data, nStates * sizeof(float));					// data = node.pot
-
-				int	nForward = 0;
-				for (size_t e_t : node->to) {
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					if (edge_to->node1 > edge_to->node2) continue;
-					float *msg = getMessage(e_t);
-					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];				// data = node.pot * edge_to.msg
-					nForward++;
-				} // e_t
-			
-				int	nBackward = 0;
-				for (size_t e_f : node->from) {
-					Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();
-					if (edge_from->node1 > edge_from->node2) continue;
-					float *msg = getMessage(e_f);
-					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];				// data = node.pot * edge_to.msg * edge_from.msg
-					nBackward++;
-				} // e_f
-
-				for (byte s = 0; s < nStates; s++) data[s] = static_cast<float>(fastPow(data[s], 1.0f / MAX(nForward, nBackward)));
-
-				// pass messages from i to nodes with higher m_ordering
-				for (size_t e_t : node->to) {
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					if (edge_to->node1 < edge_to->node2) calculateMessage(getMessage(e_t), *edge_to, temp, data);
-				} // e_t
-			});
-
-			// Backward pass
-			std::for_each(getGraphPairwise().m_vNodes.rbegin(), getGraphPairwise().m_vNodes.rend(), [&](ptr_node_t &node) {
-				memcpy(data, node->Pot.data, nStates * sizeof(float));							// data = node.pot
-
-				int	nForward = 0;
-				for (size_t e_t : node->to) {
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					if (edge_to->node1 > edge_to->node2) continue;
-					float *msg = getMessage(e_t);
-					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];
-					nForward++;
-				} // e_t
-			
-				int	nBackward = 0;
-				for (size_t e_f : node->from) {
-					Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();
-					if (edge_from->node1 > edge_from->node2) continue;
-					float *msg = getMessage(e_f);
-					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];
-					nBackward++;
-				} // e_f
-
-				// normalize data
-				float max = data[0];
-				for (byte s = 1; s < nStates; s++) if (max < data[s]) max = data[s];
-				for (byte s = 0; s < nStates; s++) data[s] /= max;
-				for (byte s = 0; s < nStates; s++) data[s] = static_cast<float>(fastPow(data[s], 1.0f / MAX(nForward, nBackward)));
-
-				// pass messages from i to nodes with smaller m_ordering
-				for (size_t e_f : node->from) {
-					Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();
-					if (edge_from->node1 < edge_from->node2) calculateMessage(getMessage(e_f), *edge_from, temp, data);
-				} // e_f
-			}); // All Nodes
-		} // iterations
 
-		delete[] data;
-		delete[] temp;
+#ifdef ENABLE_PPL
+			for (const vec_size_t &vNodes : vvForward)									// Forward pass
+				parallel::parallel_for_each(vNodes.begin(), vNodes.end(), forward);
+			for (const vec_size_t &vNodes : vvBackward)									// Backward pass
+				parallel::parallel_for_each(vNodes.begin(), vNodes.end(), backward);
+#else
+			for (size_t n = 0; n < nNodes; n++) forward(n);							// Forward pass
+			for (size_t n = nNodes; n-- > 0; ) backward(n);								// Backward pass
+#endif
+
+			// Convergence check: maximal change of the messages since the previous iteration (kept in the temp messages)
+			if (tolerance > 0) {
+				float delta = 0;
+				for (size_t e = 0; e < nEdges; e++) {
+					const float *msg  = getMessage(e);
+					float		*prev = getMessageTemp(e);
+					for (byte s = 0; s < nStates; s++) {
+						delta = MAX(delta, fabs(msg[s] - prev[s]));
+						prev[s] = msg[s];
+					}
+				} // e
+				if (delta < tolerance) {
+					i++;
+					break;
+				}
+			}
+		} // iterations
+		setNumIterations(i);
 	}
 
 	// Updates edge->msg = F(data, edge.Pot)
-	void CInferTRW::calculateMessage(float *msg, Edge &edge, float *temp, float *data)
+	void CInferTRW::calculateMessage(float *msg, size_t edge, float *temp, float *data)
 	{
-		const byte nStates = getGraph().getNumStates();
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();
+		const EdgePotModel model  = graph.getEdgePotModel(edge);
+		const bool		  isTruncated = model == EdgePotModel::truncatedLinear || model == EdgePotModel::truncatedQuadratic;
+		
+		if (isLogDomain()) {
+			const float *logPot = getLogEdgePot(edge);
+			if (!logPot) {																				// no edge potential: uniform message
+				std::fill(msg, msg + nStates, 0.0f);
+				return;
+			}
 
-		for (byte s = 0; s < nStates; s++) temp[s] = data[s] / MAX(FLT_EPSILON, msg[s]); 				// tmp = gamma * data / edge.msg
+			for (byte s = 0; s < nStates; s++) 																// tmp = gamma * data - edge.msg
+				temp[s] = msg[s] > -std::numeric_limits<float>::infinity() ? data[s] - msg[s] : data[s];
+			if (model == EdgePotModel::Potts)
+				kernels::pottsMaxProd(logPot, nStates, temp, msg, true);
+			else if (isTruncated) {																		// distance transform on energies
+				auto [lambda, tau] = graph.getEdgePotParams(edge);
+				for (byte s = 0; s < nStates; s++) temp[s] = -temp[s];
+				kernels::minConvolution(temp, nStates, msg, model == EdgePotModel::truncatedQuadratic, lambda, tau);
+				for (byte s = 0; s < nStates; s++) msg[s] = -msg[s];
+			} else
+				for (byte y = 0; y < nStates; y++)
+					msg[y] = kernels::maxSum(temp, logPot + y * nStates, nStates);				// msg = max(tmp + log(edge.Pot))
 
-		for (byte y = 0; y < nStates; y++) {
-			float *pPot = edge.Pot.ptr<float>(y);
-			float max = temp[0] * pPot[0];																// vMin = tmp + edge.Pot(0, kdest)
-			for (byte x = 1; x < nStates; x++) {
-				float val = temp[x] * pPot[x];
-				if (max < val) max = val;
-			}
-			msg[y] = max;
+			// Normalization
+			float max = *std::max_element(msg, msg + nStates);
+			if (max == -std::numeric_limits<float>::infinity()) std::fill(msg, msg + nStates, 0.0f);
+			else for (byte s = 0; s < nStates; s++) msg[s] -= max;
+			return;
+		}
+
+		const float		* pot	  = graph.getEdgePot(edge);
+		
+		if (!pot) {																						// no edge potential: uniform message
+			std::fill(msg, msg + nStates, 1.0f);
+			return;
 		}
+		
+		for (byte s = 0; s < nStates; s++) temp[s] = data[s] / MAX(FLT_EPSILON, msg[s]); 				// tmp = gamma * data / edge.msg
+		if (model == EdgePotModel::Potts)
+			kernels::pottsMaxProd(pot, nStates, temp, msg, false);
+		else if (isTruncated) {																			// distance transform on energies
+			auto [lambda, tau] = graph.getEdgePotParams(edge);
+			for (byte s = 0; s < nStates; s++) temp[s] = -logf(temp[s]);
+			kernels::minConvolution(temp, nStates, msg, model == EdgePotModel::truncatedQuadratic, lambda, tau);
+			for (byte s = 0; s < nStates; s++) msg[s] = expf(-msg[s]);
+		} else
+			for (byte y = 0; y < nStates; y++)
+				msg[y] = kernels::maxProd(temp, pot + y * nStates, nStates);							// msg = max(tmp * edge.Pot)
 
 		// Normalization
 		float max = msg[0];
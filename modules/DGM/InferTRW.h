@@ -6,14 +6,15 @@
 
 namespace DirectGraphicalModels
 {
-	struct Edge;
-	
 	// ==================== Microsoft TRW Decode Class ==================
 	/**
 	* @ingroup moduleDecode
 	* @brief Tree-reweighted inference class
 	* @details This class is based on the Tree-reweighted message passing algorithm (a modification of a max-poduct LBP algorithm), 
 	* described in the paper <a href="http://pub.ist.ac.at/~vnk/papers/TRW-S-PAMI.pdf" target="_blank">Convergent Tree-reweighted Message Passing for Energy Minimization</a>
+	* > The nodes are processed in the order of their indexes in the forward pass and in the reverse order in the backward pass. With the parallel 
+	* processing enabled (ref. ENABLE_PPL), the nodes of every \a wavefront, \a i.e. the nodes, which do not depend on each other within the pass
+	* (anti-diagonals of a grid graph with the raster order of nodes), are processed concurrently. The result is identical to the sequential processing.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CInferTRW : public CMessagePassing
@@ -31,6 +32,6 @@ namespace DirectGraphicalModels
 
 	protected:
 		DllExport virtual void	calculateMessages(unsigned int nIt);
-		void					calculateMessage(float* msg, Edge& edge, float* temp, float* data);
+		void					calculateMessage(float* msg, size_t edge, float* temp, float* data);
 	};
 }
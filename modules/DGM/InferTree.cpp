@@ -1,89 +1,80 @@
 #include "InferTree.h"
 #include "GraphPairwise.h"
+#include "parallel.h"
 
 namespace DirectGraphicalModels
 {
 	void CInferTree::calculateMessages(unsigned int)
 	{
-		const byte		nStates	= getGraph().getNumStates();
-		const size_t	nNodes	= getGraph().getNumNodes();
-		const size_t	nEdges	= getGraph().getNumEdges();
+		CGraphPairwise& graph	= getGraphPairwise();
+		const size_t	nNodes	= graph.getNumNodes();
+		const size_t	NONE	= std::numeric_limits<size_t>::max();
 
 		// ====================================== Initialization ======================================
-		vec_bool_t		isReady(nEdges, false);								// Flags indicating whether the messages were already calculated
-		vec_bool_t		suspend(nEdges, false);								// Flags indicating weather the message calculation must be postponed
-		
-		// =================================== Computing messages ===================================
-		size_t  * nFromEdges = new size_t[nNodes];							// Count number of neighbors
-		std::deque<size_t> nodeQueue;
-		for (ptr_node_t &node: getGraphPairwise().m_vNodes) {
-			nFromEdges[node->id] = node->from.size();						// number of incoming edges
-			if (nFromEdges[node->id] <= 1) nodeQueue.push_back(node->id);	// Add all leafs to the queue
+		// The leafs are peeled off the tree level by level: a node gets the level, at which at most one of its neighbours is left.
+		// The messages towards the root, sent by the nodes of one level, depend only on the messages from the previous levels
+		vec_size_t	vLevel(nNodes, NONE);											// Level of every node (NONE for the nodes in loops)
+		vec_size_t	nFromEdges(nNodes);												// Number of the not yet peeled neighbours
+		vec_size_t	vFront, vNextFront;
+		for (size_t n = 0; n < nNodes; n++) {
+			nFromEdges[n] = graph.getInEdges(n).size();							// number of incoming edges
+			if (nFromEdges[n] <= 1) {												// all leafs
+				vLevel[n] = 0;
+				vFront.push_back(n);
+			}
 		}
+		for (size_t l = 1; !vFront.empty(); l++) {
+			for (size_t n : vFront)
+				for (size_t e_t : graph.getOutEdges(n)) {
+					size_t n2 = graph.m_vEdgeDst[e_t];
+					if (vLevel[n2] != NONE) continue;
+					if (--nFromEdges[n2] <= 1) {
+						vLevel[n2] = l;
+						vNextFront.push_back(n2);
+					}
+				} // e_t
+			vFront.swap(vNextFront);
+			vNextFront.clear();
+		} // l
 
+		// The last two nodes of a tree are peeled at the same level: one of them becomes the root
+		for (size_t n = 0; n < nNodes; n++) {
+			if (vLevel[n] == NONE) continue;
+			for (size_t e_t : graph.getOutEdges(n)) {
+				size_t n2 = graph.m_vEdgeDst[e_t];
+				if (vLevel[n2] == vLevel[n] && n2 > n) vLevel[n2]++;
+			}
+		} // n
 
-		float *temp = new float[nStates];
-		while (!nodeQueue.empty()) {
-			//for (size_t q = 0; q < nodeQueue.size(); q++) printf("%d, ", nodeQueue[q]);	printf("\n");
-			
-			size_t n = nodeQueue.front();									// n - node with one neighbour
-			nodeQueue.pop_front();
-
-			Node  *node = getGraphPairwise().m_vNodes[n].get();				// Node with one neighbour
-			
-			bool allSuspend = true;
-			for (size_t e_t : node->to)
-				if (!suspend[e_t]) {
-					allSuspend = false;
+		std::vector<vec_size_t>	vvLevels;											// Nodes of every level
+		vec_size_t				vParentEdge(nNodes, NONE);							// The edge towards the root
+		for (size_t n = 0; n < nNodes; n++) {
+			if (vLevel[n] == NONE) continue;
+			if (vLevel[n] >= vvLevels.size()) vvLevels.resize(vLevel[n] + 1);
+			vvLevels[vLevel[n]].push_back(n);
+			for (size_t e_t : graph.getOutEdges(n)) {
+				size_t n2 = graph.m_vEdgeDst[e_t];
+				if (vLevel[n2] > vLevel[n]) {							// the nodes in loops are treated as roots
+					vParentEdge[n] = e_t;
 					break;
 				}
+			} // e_t
+		} // n
 
-			if (allSuspend) {	// Now prepare messages for suspending edges
-				for (size_t e_t : node->to) {
-					if (isReady[e_t]) continue;
-					
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					calculateMessage(*edge_to, temp, getMessage(e_t));
-					isReady[e_t] = true;
-					
-					// ------
-					size_t n1 = edge_to->node1;
-					size_t n2 = edge_to->node2;
-					auto it = std::find_if(getGraphPairwise().m_vNodes[n1]->from.begin(), getGraphPairwise().m_vNodes[n1]->from.end(), [&](size_t e) {
-						return (getGraphPairwise().m_vEdges[e]->node1 == n2);
-					});
-					if (it != getGraphPairwise().m_vNodes[n1]->from.end())
-						suspend[*it] = true;
-					// ------
-					
-					nFromEdges[n2]--;
-					if (nFromEdges[n2] <= 1) nodeQueue.push_back(n2);
-				}
-			} else {			// Prepare messages for all non-suspending edges
-				for (size_t e_t : node->to) {
-					if (suspend[e_t]) continue;
-					if (isReady[e_t]) continue;
-					
-					Edge * edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					calculateMessage(*edge_to, temp, getMessage(e_t));
-					isReady[e_t] = true;
-					// ------
-					size_t n1 = edge_to->node1;
-					size_t n2 = edge_to->node2;
-					auto it = std::find_if(getGraphPairwise().m_vNodes[n1]->from.begin(), getGraphPairwise().m_vNodes[n1]->from.end(), [&](size_t e) {
-						return (getGraphPairwise().m_vEdges[e]->node1 == n2);
-					});
-					if (it != getGraphPairwise().m_vNodes[n1]->from.end())
-						suspend[*it] = true;
-					// ------
-					
-					nFromEdges[n2]--;
-					if (nFromEdges[n2] <= 1) nodeQueue.push_back(n2);
-				}
-			}
-		} // while
+		// =================================== Computing messages ===================================
+		// Upward pass: from the leafs to the roots
+		for (const vec_size_t &vNodes : vvLevels)
+			parallel::parallel_for_each(vNodes.begin(), vNodes.end(), [&](size_t n) {
+				float temp[256];
+				if (vParentEdge[n] != NONE) calculateMessage(vParentEdge[n], temp, getMessage(vParentEdge[n]));
+			});
 
-		delete[] temp;
-		delete[] nFromEdges;
+		// Downward pass: from the roots to the leafs
+		for (auto it = vvLevels.rbegin(); it != vvLevels.rend(); it++)
+			parallel::parallel_for_each(it->begin(), it->end(), [&](size_t n) {
+				float temp[256];
+				for (size_t e_t : graph.getOutEdges(n))
+					if (e_t != vParentEdge[n]) calculateMessage(e_t, temp, getMessage(e_t));
+			});
 	}
 }
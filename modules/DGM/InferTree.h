@@ -10,6 +10,9 @@ namespace DirectGraphicalModels
 	/**
 	* @ingroup moduleDecode
 	* @brief Inference for tree graphs (undirected graphs without loops)
+	* @details The leafs are peeled off the trees level by level, until only the roots are left. The messages are then sent upwards, from the 
+	* leafs to the roots, and downwards, from the roots to the leafs, one level at a time. All the messages of one level are independent and 
+	* are calculated concurrently, thus the inference in large trees and forests (\a e.g. the spanning trees of images) scales with the number of cores.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	* @todo Check the application of this class to DAGs and mixed graphs
 	*/
@@ -28,6 +31,7 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Calculates messages for exact inference in a tree graph
 		* @details This function estimates the marginal potentials for each graph node and stores them as node potentials.
+		* > The nodes, which belong to loops, are never peeled: they are treated as roots of the trees, attached to them.
 		* @param nIt is not used
 		*/
 		DllExport virtual void calculateMessages(unsigned int nIt);
@@ -0,0 +1,335 @@
+#include "MaxFlow.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	void CMaxFlow::reset(size_t nNodes)
+	{
+		DGM_ASSERT_MSG(nNodes < ORPHAN, "The number of nodes %zu exceeds the 32-bit index range", nNodes);
+		m_vNodes.assign(nNodes, { NONE, NONE, 0, 0, 0.0f, 0.0f, 0.0f, false, false, false });
+		m_vArcs.clear();															// the capacity is kept
+		m_vChanged.clear();
+		m_hasTrees = false;
+	}
+
+	void CMaxFlow::addTWeights(size_t node, float capSource, float capSink)
+	{
+		DGM_ASSERT_MSG(node < m_vNodes.size(), "Node %zu is out of range %zu", node, m_vNodes.size());
+		setTWeights(node, m_vNodes[node].capSource + capSource, m_vNodes[node].capSink + capSink);
+	}
+
+	size_t CMaxFlow::addEdge(size_t node1, size_t node2, float cap, float revCap)
+	{
+		DGM_ASSERT_MSG(node1 < m_vNodes.size(), "Node %zu is out of range %zu", node1, m_vNodes.size());
+		DGM_ASSERT_MSG(node2 < m_vNodes.size(), "Node %zu is out of range %zu", node2, m_vNodes.size());
+		DGM_ASSERT(node1 != node2);
+		DGM_ASSERT_MSG(m_vArcs.size() + 2 < ORPHAN, "The number of arcs exceeds the 32-bit index range");
+
+		const dword arc = static_cast<dword>(m_vArcs.size());
+		m_vArcs.push_back({ static_cast<dword>(node2), m_vNodes[node1].first, cap, cap });
+		m_vNodes[node1].first = arc;
+		m_vArcs.push_back({ static_cast<dword>(node1), m_vNodes[node2].first, revCap, revCap });
+		m_vNodes[node2].first = sister(arc);
+		setChanged(static_cast<dword>(node1));
+		setChanged(static_cast<dword>(node2));
+		return arc / 2;
+	}
+
+	void CMaxFlow::setTWeights(size_t node, float capSource, float capSink)
+	{
+		DGM_ASSERT_MSG(node < m_vNodes.size(), "Node %zu is out of range %zu", node, m_vNodes.size());
+		Node &n = m_vNodes[node];
+		if (n.capSource == capSource && n.capSink == capSink) return;
+
+		// The flow through the t-links is kept: the excess of the flow over the new capacity of a t-link is equivalent to adding 
+		// the same value to the capacities of both t-links of the node, which does not change the minimal cut
+		n.trCap		+= (capSource - n.capSource) - (capSink - n.capSink);
+		n.capSource	 = capSource;
+		n.capSink	 = capSink;
+		setChanged(static_cast<dword>(node));
+	}
+
+	void CMaxFlow::setEdge(size_t edge, float cap, float revCap)
+	{
+		DGM_ASSERT_MSG(2 * edge < m_vArcs.size(), "Edge %zu is out of range %zu", edge, m_vArcs.size() / 2);
+		Arc &arc	= m_vArcs[2 * edge];
+		Arc &revArc = m_vArcs[2 * edge + 1];
+		if (arc.cap == cap && revArc.cap == revCap) return;
+
+		// The flow, exceeding the new capacities, is moved to the t-links of the end nodes
+		const float flow	= arc.cap - arc.rCap;											// flow (node1) --> (node2)
+		const float newFlow	= MIN(MAX(flow, -revCap), cap);
+		m_vNodes[revArc.head].trCap += flow - newFlow;
+		m_vNodes[arc.head].trCap	-= flow - newFlow;
+		arc.rCap	= cap - newFlow;
+		arc.cap		= cap;
+		revArc.rCap = revCap + newFlow;
+		revArc.cap	= revCap;
+		setChanged(revArc.head);
+		setChanged(arc.head);
+	}
+
+	float CMaxFlow::maxFlow(bool reuseTrees)
+	{
+		// ====================================== Initialization ======================================
+		m_qActive.clear();
+		m_qOrphans.clear();
+		if (reuseTrees && m_hasTrees) updateTrees();
+		else buildTrees();
+		m_hasTrees = true;
+
+		// ======================================== Main loop ========================================
+		dword current = NONE;
+		for (;;) {
+			dword i = current;
+			if (i == NONE || m_vNodes[i].parent == NONE) {
+				i = nextActive();
+				if (i == NONE) break;
+			}
+			const Node &node = m_vNodes[i];
+
+			// Growth: looking for a path from the source to the sink
+			dword middleArc = NONE;
+			for (dword a = node.first; a != NONE; a = m_vArcs[a].next) {
+				const float cap = node.isSink ? m_vArcs[sister(a)].rCap : m_vArcs[a].rCap;
+				if (cap <= 0) continue;
+				
+				const dword j = m_vArcs[a].head;
+				Node &child = m_vNodes[j];
+				if (child.parent == NONE) {													// free node: add it to the tree
+					child.isSink = node.isSink;
+					child.parent = sister(a);
+					child.ts	 = node.ts;
+					child.dist	 = node.dist + 1;
+					setActive(j);
+				} else if (child.isSink != node.isSink) {									// the trees meet
+					middleArc = node.isSink ? sister(a) : a;
+					break;
+				} else if (child.ts <= node.ts && child.dist > node.dist) {					// shorten the path to the terminal
+					child.parent = sister(a);
+					child.ts	 = node.ts;
+					child.dist	 = node.dist + 1;
+				}
+			} // a
+
+			m_time++;
+			if (middleArc != NONE) {
+				current = i;																// the node may still have more paths
+				augment(middleArc);
+				while (!m_qOrphans.empty()) {												// Adoption
+					dword orphan = m_qOrphans.front();
+					m_qOrphans.pop_front();
+					adopt(orphan);
+				}
+			} else
+				current = NONE;
+		}
+
+		// The capacity of the minimal cut
+		float res = 0;
+		for (dword i = 0; i < m_vNodes.size(); i++) res += isSink(i) ? m_vNodes[i].capSource : m_vNodes[i].capSink;
+		for (dword a = 0; a < m_vArcs.size(); a++)
+			if (!isSink(m_vArcs[sister(a)].head) && isSink(m_vArcs[a].head)) res += m_vArcs[a].cap;
+		return res;
+	}
+
+	// ------------------------------ PRIVATE ------------------------------
+	void CMaxFlow::setActive(dword node)
+	{
+		if (m_vNodes[node].isActive) return;
+		m_vNodes[node].isActive = true;
+		m_qActive.push_back(node);
+	}
+
+	void CMaxFlow::setOrphan(dword node)
+	{
+		m_vNodes[node].parent = ORPHAN;
+		m_qOrphans.push_back(node);
+	}
+
+	void CMaxFlow::setChanged(dword node)
+	{
+		if (m_vNodes[node].isChanged) return;
+		m_vNodes[node].isChanged = true;
+		m_vChanged.push_back(node);
+	}
+
+	void CMaxFlow::buildTrees(void)
+	{
+		m_time = 0;
+		for (dword i = 0; i < m_vNodes.size(); i++) {
+			Node &node = m_vNodes[i];
+			node.isActive  = false;
+			node.isChanged = false;
+			node.ts = 0;
+			if (node.trCap == 0) {
+				node.parent = NONE;
+				continue;
+			}
+			node.isSink = node.trCap < 0;
+			node.parent = TERMINAL;
+			node.dist	= 1;
+			setActive(i);
+		} // i
+		m_vChanged.clear();
+	}
+
+	void CMaxFlow::updateTrees(void)
+	{
+		if (m_time == std::numeric_limits<dword>::max()) {								// the time stamps would overflow
+			for (Node &node : m_vNodes) node.ts = 0;
+			m_time = 0;
+		}
+		m_time++;																	// the cached distances are not valid anymore
+		for (dword i : m_vChanged) {
+			Node &node = m_vNodes[i];
+			node.isChanged = false;
+
+			// The node itself: it is attached to the terminal, if the t-link has residual capacity
+			if (node.trCap != 0) {
+				node.isSink = node.trCap < 0;
+				node.parent = TERMINAL;
+				node.ts		= m_time;
+				node.dist	= 1;
+			} else if (node.parent == TERMINAL) setOrphan(i);
+			else if (node.parent != NONE && node.parent != ORPHAN) {
+				const float cap = node.isSink ? m_vArcs[node.parent].rCap : m_vArcs[sister(node.parent)].rCap;
+				if (cap <= 0) setOrphan(i);
+			}
+
+			// The neighbors may grow to the node, if it moved to another tree; its children, which are not connected to it anymore, become orphans
+			for (dword a = node.first; a != NONE; a = m_vArcs[a].next) {
+				const dword j = m_vArcs[a].head;
+				Node &child = m_vNodes[j];
+				if (child.parent != NONE) setActive(j);
+				if (child.parent == NONE || child.parent == TERMINAL || child.parent == ORPHAN || m_vArcs[child.parent].head != i) continue;
+				const float cap = child.isSink ? m_vArcs[child.parent].rCap : m_vArcs[sister(child.parent)].rCap;
+				if (node.parent == NONE || child.isSink != node.isSink || cap <= 0) setOrphan(j);
+			} // a
+
+			if (node.parent != NONE) setActive(i);
+		} // i
+		m_vChanged.clear();
+
+		while (!m_qOrphans.empty()) {												// Adoption
+			dword orphan = m_qOrphans.front();
+			m_qOrphans.pop_front();
+			adopt(orphan);
+		}
+	}
+
+	dword CMaxFlow::nextActive(void)
+	{
+		while (!m_qActive.empty()) {
+			dword node = m_qActive.front();
+			m_qActive.pop_front();
+			m_vNodes[node].isActive = false;
+			if (m_vNodes[node].parent != NONE) return node;								// skip the nodes, which became free
+		}
+		return NONE;
+	}
+
+	// middleArc goes from the source tree to the sink tree
+	void CMaxFlow::augment(dword middleArc)
+	{
+		const dword sourceNode = m_vArcs[sister(middleArc)].head;
+		const dword sinkNode	= m_vArcs[middleArc].head;
+		dword i, a;
+
+		// Bottleneck capacity of the path
+		float bottleneck = m_vArcs[middleArc].rCap;
+		for (i = sourceNode; (a = m_vNodes[i].parent) != TERMINAL; i = m_vArcs[a].head)
+			bottleneck = MIN(bottleneck, m_vArcs[sister(a)].rCap);
+		bottleneck = MIN(bottleneck, m_vNodes[i].trCap);
+		for (i = sinkNode; (a = m_vNodes[i].parent) != TERMINAL; i = m_vArcs[a].head)
+			bottleneck = MIN(bottleneck, m_vArcs[a].rCap);
+		bottleneck = MIN(bottleneck, -m_vNodes[i].trCap);
+
+		// Augmentation; the nodes, connected to their parents with saturated arcs, become orphans
+		m_vArcs[sister(middleArc)].rCap += bottleneck;
+		m_vArcs[middleArc].rCap			-= bottleneck;
+		for (i = sourceNode; (a = m_vNodes[i].parent) != TERMINAL; i = m_vArcs[a].head) {
+			m_vArcs[a].rCap			+= bottleneck;
+			m_vArcs[sister(a)].rCap -= bottleneck;
+			if (m_vArcs[sister(a)].rCap <= 0) setOrphan(i);
+		}
+		m_vNodes[i].trCap -= bottleneck;
+		if (m_vNodes[i].trCap <= 0) setOrphan(i);
+		for (i = sinkNode; (a = m_vNodes[i].parent) != TERMINAL; i = m_vArcs[a].head) {
+			m_vArcs[a].rCap			-= bottleneck;
+			m_vArcs[sister(a)].rCap += bottleneck;
+			if (m_vArcs[a].rCap <= 0) setOrphan(i);
+		}
+		m_vNodes[i].trCap += bottleneck;
+		if (m_vNodes[i].trCap >= 0) setOrphan(i);
+	}
+
+	void CMaxFlow::adopt(dword node)
+	{
+		Node &orphan = m_vNodes[node];
+		if (orphan.parent != ORPHAN) return;										// the node was attached to the terminal in updateTrees()
+		
+		// Looking for a new parent in the same tree, which is connected to the terminal
+		dword	parent	= NONE;
+		dword	minDist	= std::numeric_limits<dword>::max();
+		for (dword a = orphan.first; a != NONE; a = m_vArcs[a].next) {
+			const float cap = orphan.isSink ? m_vArcs[a].rCap : m_vArcs[sister(a)].rCap;
+			if (cap <= 0) continue;
+			const dword j = m_vArcs[a].head;
+			if (m_vNodes[j].parent == NONE || m_vNodes[j].isSink != orphan.isSink) continue;
+
+			// Distance to the terminal (the distances, checked at the current time are cached)
+			dword	dist  = 0;
+			bool	valid = false;
+			for (dword k = j; ; ) {
+				Node &n = m_vNodes[k];
+				if (n.ts == m_time) {
+					dist += n.dist;
+					valid = true;
+					break;
+				}
+				dist++;
+				if (n.parent == TERMINAL) {
+					n.ts   = m_time;
+					n.dist = 1;
+					valid = true;
+					break;
+				}
+				if (n.parent == ORPHAN || n.parent == NONE) break;
+				k = m_vArcs[n.parent].head;
+			}
+			if (!valid) continue;
+
+			if (dist < minDist) {
+				parent	= a;
+				minDist = dist;
+			}
+			for (dword k = j; m_vNodes[k].ts != m_time; k = m_vArcs[m_vNodes[k].parent].head) {
+				m_vNodes[k].ts	 = m_time;
+				m_vNodes[k].dist = dist--;
+			}
+		} // a
+
+		if (parent != NONE) {
+			orphan.parent = parent;
+			orphan.ts	  = m_time;
+			orphan.dist	  = minDist + 1;
+			return;
+		}
+
+		// No parent is found: the node becomes free, its children become orphans and its neighbors may grow the tree again
+		orphan.parent = NONE;
+		for (dword a = orphan.first; a != NONE; a = m_vArcs[a].next) {
+			const dword j = m_vArcs[a].head;
+			Node &neighbor = m_vNodes[j];
+			if (neighbor.parent == NONE || neighbor.isSink != orphan.isSink) continue;
+			
+			const float cap = orphan.isSink ? m_vArcs[a].rCap : m_vArcs[sister(a)].rCap;
+			if (cap > 0) setActive(j);
+			if (neighbor.parent != TERMINAL && neighbor.parent != ORPHAN && m_vArcs[neighbor.parent].head == node) {
+				neighbor.parent = ORPHAN;
+				m_qOrphans.push_back(j);
+			}
+		} // a
+	}
+}
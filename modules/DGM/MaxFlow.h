@@ -0,0 +1,139 @@
+// Max-flow / min-cut class interface
+#pragma once
+
+#include "types.h"
+#include <deque>
+
+namespace DirectGraphicalModels
+{
+	// ================================ Max-Flow Class ================================
+	/**
+	* @brief Max-flow / min-cut class
+	* @details This class implements the augmenting paths algorithm, described in the paper
+	* \"An Experimental Comparison of Min-Cut/Max-Flow Algorithms for Energy Minimization in Vision\" by Y. Boykov and V. Kolmogorov (PAMI 2004).
+	* Two search trees, growing from the source and from the sink, are kept between the augmentations: after an augmentation only the
+	* nodes, which lost their parents (orphans), are re-attached to the trees, instead of building the trees from scratch.
+	* > The memory, allocated for the network, is kept by reset(), thus the same object may be re-used for solving a series of
+	* problems of the same size without any memory allocations. The nodes and the arcs are indexed with 32-bit integers.
+	* 
+	* After maxFlow() the capacities of the network may be changed with setTWeights() and setEdge() and the flow may be re-calculated
+	* with maxFlow(true), which re-uses the flow and the search trees of the previous solution, as described in the paper
+	* \"Efficiently Solving Dynamic Markov Random Fields Using Graph Cuts\" by P. Kohli and P.H.S. Torr (ICCV 2005). The flow through an arc,
+	* which exceeds its new capacity, is moved to the t-links of its end nodes, which does not change the minimal cut. Only the nodes,
+	* whose capacities were changed, and their neighbors are revised in the search trees.
+	* @ingroup moduleDecode
+	*/
+	class CMaxFlow
+	{
+	public:
+		DllExport CMaxFlow(void) = default;
+		DllExport ~CMaxFlow(void) = default;
+
+		/**
+		* @brief Resets the network
+		* @details Removes all the arcs and creates \b nNodes nodes without terminal capacities
+		* @param nNodes The number of nodes (excluding the source and the sink)
+		*/
+		DllExport void	reset(size_t nNodes);
+		/**
+		* @brief Adds the capacities of the terminal arcs (t-links) of a node
+		* @param node The node index
+		* @param capSource The capacity of the arc (source) --> (\b node)
+		* @param capSink The capacity of the arc (\b node) --> (sink)
+		*/
+		DllExport void	addTWeights(size_t node, float capSource, float capSink);
+		/**
+		* @brief Adds a pair of arcs between two nodes (n-links)
+		* @param node1 The first node index
+		* @param node2 The second node index
+		* @param cap The capacity of the arc (\b node1) --> (\b node2)
+		* @param revCap The capacity of the arc (\b node2) --> (\b node1)
+		* @return The index of the edge
+		*/
+		DllExport size_t addEdge(size_t node1, size_t node2, float cap, float revCap);
+		/**
+		* @brief Sets the capacities of the terminal arcs (t-links) of a node
+		* @details In contrast to addTWeights(), the previous capacities are replaced
+		* @param node The node index
+		* @param capSource The capacity of the arc (source) --> (\b node)
+		* @param capSink The capacity of the arc (\b node) --> (sink)
+		*/
+		DllExport void	setTWeights(size_t node, float capSource, float capSink);
+		/**
+		* @brief Sets the capacities of a pair of arcs between two nodes (n-links)
+		* @param edge The index of the edge, returned by addEdge()
+		* @param cap The capacity of the arc (\b node1) --> (\b node2)
+		* @param revCap The capacity of the arc (\b node2) --> (\b node1)
+		*/
+		DllExport void	setEdge(size_t edge, float cap, float revCap);
+		/**
+		* @brief Calculates the maximal flow
+		* @param reuseTrees Flag indicating whether the flow and the search trees of the previous call should be re-used.
+		* Only the changes of the capacities since the previous call are then processed (ref. setTWeights() and setEdge()).
+		* @return The value of the maximal flow, \a i.e. the capacity of the minimal cut
+		*/
+		DllExport float	maxFlow(bool reuseTrees = false);
+		/**
+		* @brief Returns the segment of the node in the minimal cut
+		* @details This function may be called only after maxFlow()
+		* @param node The node index
+		* @retval true if the node belongs to the sink segment
+		* @retval false if the node belongs to the source segment
+		*/
+		DllExport bool	isSink(size_t node) const { return m_vNodes[node].parent != NONE && m_vNodes[node].isSink; }
+		/**
+		* @brief Returns the size of the memory, needed for a network
+		* @param nNodes The number of nodes (excluding the source and the sink)
+		* @param nEdges The number of edges (pairs of arcs)
+		* @return The size of the memory in bytes
+		*/
+		DllExport static size_t getMemorySize(size_t nNodes, size_t nEdges) { return nNodes * sizeof(Node) + 2 * nEdges * sizeof(Arc); }
+
+
+	private:
+		static constexpr dword	NONE	 = static_cast<dword>(-1);		// No parent: free node / end of a list
+		static constexpr dword	TERMINAL = static_cast<dword>(-2);		// The parent is the terminal
+		static constexpr dword	ORPHAN	 = static_cast<dword>(-3);		// The parent is lost
+
+		struct Node {
+			dword	first;		// First outgoing arc
+			dword	parent;		// Arc to the parent in the search tree, or NONE / TERMINAL / ORPHAN
+			dword	ts;			// Time stamp of the distance
+			dword	dist;		// Distance to the terminal
+			float	trCap;		// Residual capacity of the t-link: from the source if positive, to the sink if negative
+			float	capSource;	// Capacity of the arc (source) --> (node)
+			float	capSink;	// Capacity of the arc (node) --> (sink)
+			bool	isSink;		// The search tree of the node (only valid if parent != NONE)
+			bool	isActive;	// The node is in the queue of active nodes
+			bool	isChanged;	// The node is in the list of the changed nodes
+		};
+		struct Arc {
+			dword	head;		// Node, the arc points to
+			dword	next;		// Next arc, coming out of the same node
+			float	rCap;		// Residual capacity
+			float	cap;		// Capacity
+		};
+
+		// The arcs are added in pairs, thus the reverse arc has index a ^ 1
+		static dword sister(dword arc) { return arc ^ 1; }
+
+		void	setActive(dword node);
+		void	setOrphan(dword node);
+		void	setChanged(dword node);
+		dword	nextActive(void);
+		void	buildTrees(void);
+		void	updateTrees(void);
+		void	augment(dword middleArc);
+		void	adopt(dword node);
+
+
+	private:
+		std::vector<Node>	m_vNodes;
+		std::vector<Arc>	m_vArcs;
+		std::deque<dword>	m_qActive;		///< Queue of the active nodes
+		std::deque<dword>	m_qOrphans;		///< Queue of the orphan nodes
+		std::vector<dword>	m_vChanged;		///< The nodes, whose capacities were changed after the last maxFlow()
+		dword				m_time = 0;		///< Time stamp of the current augmentation
+		bool				m_hasTrees = false;	///< Flag indicating whether the search trees of the last maxFlow() are available
+	};
+}
@@ -1,68 +1,126 @@
 #include "MessagePassing.h"
 #include "GraphPairwise.h"
+#include "parallel.h"
+#include "kernels.h"
 #include "macroses.h"
+#include <numeric>
 
 namespace DirectGraphicalModels
 {
 	void CMessagePassing::infer(unsigned int nIt)
 	{
-		const byte   nStates = getGraph().getNumStates();
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();
 
 		// ====================================== Initialization ======================================
-		createMessages(1.0f / nStates);				// msg[] = 1 / nStates; msg_temp[] = 1 / nStates;
+		graph.updateAdjacency();
+		if (m_logDomain) {
+			createLogPotentials();					// pot = log(pot)
+			createMessages(0.0f);					// msg[] = log(1); msg_temp[] = log(1);
+		} else
+			createMessages(1.0f / nStates);			// msg[] = 1 / nStates; msg_temp[] = 1 / nStates;
 
 		// =================================== Calculating messages ==================================
 		calculateMessages(nIt);
 
 		// =================================== Calculating beliefs ===================================
-#ifdef ENABLE_PPL
-		concurrency::parallel_for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&, nStates](ptr_node_t &node) {
-#else
-		std::for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&,nStates](ptr_node_t &node) {
-#endif
-			for (size_t e_f : node->from) {
-				float *msg = getMessage(e_f);				// message of current incoming edge
-				float epsilon = FLT_EPSILON;
-				for (byte s = 0; s < nStates; s++) { 		// states
-					// node->Pot.at<float>(s,0) *= msg[s];
-					node->Pot.at<float>(s, 0) = (epsilon + node->Pot.at<float>(s, 0)) * (epsilon + msg[s]);		// Soft multiplication
-				} //s
-			} // e_f
-			
-			// Normalization
-			float SUM_pot = 0;
-			for (byte s = 0; s < nStates; s++)				// states
-				SUM_pot += node->Pot.at<float>(s, 0);
-			for (byte s = 0; s < nStates; s++) {			// states
-				node->Pot.at<float>(s, 0) /= SUM_pot;
-				DGM_ASSERT_MSG(!std::isnan(node->Pot.at<float>(s, 0)), "The lower precision boundary for the potential of the node %zu is reached.\n \
-						SUM_pot = %f\n", node->id, SUM_pot);
-			}
-		});
+		if (m_logDomain)
+			parallel::parallel_for(size_t(0), graph.getNumNodes(), [&, nStates](size_t n) {
+				float *pot = graph.getNodePot(n);
+				for (size_t e_f : graph.getInEdges(n)) {
+					float *msg = getMessage(e_f);				// message of current incoming edge
+					for (byte s = 0; s < nStates; s++)			// states
+						pot[s] += msg[s];
+				} // e_f
+
+				// Conversion to the probability domain
+				float max = *std::max_element(pot, pot + nStates);
+				if (max == -std::numeric_limits<float>::infinity()) {
+					std::fill(pot, pot + nStates, 1.0f / nStates);
+					return;
+				}
+				float SUM_pot = 0;
+				for (byte s = 0; s < nStates; s++) {			// states
+					pot[s] = expf(pot[s] - max);
+					SUM_pot += pot[s];
+				}
+				for (byte s = 0; s < nStates; s++)				// states
+					pot[s] /= SUM_pot;
+			});
+		else
+			parallel::parallel_for(size_t(0), graph.getNumNodes(), [&, nStates](size_t n) {
+				float *pot = graph.getNodePot(n);
+				for (size_t e_f : graph.getInEdges(n)) {
+					float *msg = getMessage(e_f);				// message of current incoming edge
+					float epsilon = FLT_EPSILON;
+					for (byte s = 0; s < nStates; s++) { 		// states
+						// pot[s] *= msg[s];
+						pot[s] = (epsilon + pot[s]) * (epsilon + msg[s]);		// Soft multiplication
+					} //s
+				} // e_f
+
+				// Normalization
+				float SUM_pot = 0;
+				for (byte s = 0; s < nStates; s++)				// states
+					SUM_pot += pot[s];
+				for (byte s = 0; s < nStates; s++) {			// states
+					pot[s] /= SUM_pot;
+					DGM_ASSERT_MSG(!std::isnan(pot[s]), "The lower precision boundary for the potential of the node %zu is reached.\n \
+						SUM_pot = %f\n", n, SUM_pot);
+				}
+			});
 
 		deleteMessages();
+		deleteLogPotentials();
 	}
 
 	// dst: usually edge msg or edge msg_temp
-	void CMessagePassing::calculateMessage(const Edge& edge_to, float* temp, float* dst, bool maxSum)
+	void CMessagePassing::calculateMessage(size_t edge, float* temp, float* dst, bool maxSum)
 	{
-		Node		* node = getGraphPairwise().m_vNodes[edge_to.node1].get();		// source node
-		const byte	  nStates = getGraph().getNumStates();							// number of states
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const size_t	  srcNode = graph.m_vEdgeSrc[edge];							// source node
+		const size_t	  dstNode = graph.m_vEdgeDst[edge];							// destination node
+		const byte		  nStates = graph.getNumStates();							// number of states
+
+		if (m_logDomain) {
+			// Compute temp = sum of all incoming log msgs except edge
+			const float *pot = graph.getNodePot(srcNode);
+			for (byte s = 0; s < nStates; s++) temp[s] = pot[s];					// temp = log(node.Pot)
+
+			for (size_t e_f : graph.getInEdges(srcNode)) {							// incoming edges
+				if (graph.m_vEdgeSrc[e_f] != dstNode) {
+					float *msg = getMessage(e_f);									// message of current incoming edge
+					for (byte s = 0; s < nStates; s++)
+						temp[s] += msg[s];											// temp = temp + msg
+				}
+			} // e_f
+
+			// Compute new message: new_msg = log((edge.Pot^2)^t x exp(temp))
+			float max = getLogEdgePot(edge) ? edgeLogMatMul(edge, temp, dst, maxSum) : -std::numeric_limits<float>::infinity();
+
+			// Shifting the message to keep it bounded in loopy graphs
+			if (max > -std::numeric_limits<float>::infinity())
+				for (byte s = 0; s < nStates; s++)
+					dst[s] -= max;
+			else
+				std::fill(dst, dst + nStates, 0.0f);
+			return;
+		}
 
-		// Compute temp = product of all incoming msgs except e_t
-		for (byte s = 0; s < nStates; s++) temp[s] = node->Pot.at<float>(s, 0);		// temp = node.Pot
+		// Compute temp = product of all incoming msgs except edge
+		const float *pot = graph.getNodePot(srcNode);
+		for (byte s = 0; s < nStates; s++) temp[s] = pot[s];						// temp = node.Pot
 
-		for (size_t e_f : node->from) {												// incoming edges
-			Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();				// current incoming edge
-			if (edge_from->node1 != edge_to.node2) {
+		for (size_t e_f : graph.getInEdges(srcNode)) {								// incoming edges
+			if (graph.m_vEdgeSrc[e_f] != dstNode) {
 				float *msg = getMessage(e_f);										// message of current incoming edge
 				for (byte s = 0; s < nStates; s++)
 					temp[s] *= msg[s];												// temp = temp * msg
 			}
 		} // e_f
 
-		// Compute new message: new_msg = (edge_to.Pot^2)^t x temp
-		float Z = MatMul(edge_to.Pot, temp, dst, maxSum);
+		// Compute new message: new_msg = (edge.Pot^2)^t x temp
+		float Z = graph.getEdgePot(edge) ? edgeMatMul(edge, temp, dst, maxSum) : 0;
 
 		// Normalization and setting new values
 		if (Z > FLT_EPSILON)
@@ -73,6 +131,98 @@ namespace DirectGraphicalModels
 				dst[s] = 1.0f / nStates;
 	}
 
+	// dst = (edge.Pot^2)^t x v
+	float CMessagePassing::edgeMatMul(size_t edge, float* v, float* dst, bool maxSum)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();
+		const float		* pot	  = graph.getEdgePot(edge);
+		
+		const EdgePotModel model = graph.getEdgePotModel(edge);
+		switch (model) {
+			case EdgePotModel::Potts: 
+				kernels::pottsMatMulSq(pot, nStates, v, dst, maxSum);
+				return std::accumulate(dst, dst + nStates, 0.0f);
+			case EdgePotModel::truncatedLinear:
+			case EdgePotModel::truncatedQuadratic:
+				if (maxSum) {																	// distance transform on energies
+					auto [lambda, tau] = graph.getEdgePotParams(edge);
+					for (byte s = 0; s < nStates; s++) v[s] = -logf(v[s]);
+					kernels::minConvolution(v, nStates, dst, model == EdgePotModel::truncatedQuadratic, 2 * lambda, 2 * tau);
+					for (byte s = 0; s < nStates; s++) dst[s] = expf(-dst[s]);
+					return std::accumulate(dst, dst + nStates, 0.0f);
+				}
+				[[fallthrough]];
+			default:
+				return MatMul(pot, nStates, v, dst, maxSum);
+		}
+	}
+
+	// dst = log((exp(edge.LogPot)^2)^t x exp(v))
+	float CMessagePassing::edgeLogMatMul(size_t edge, float* v, float* dst, bool maxSum)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const byte		  nStates = graph.getNumStates();
+		const float		* logPot  = getLogEdgePot(edge);
+
+		const EdgePotModel model = graph.getEdgePotModel(edge);
+		switch (model) {
+			case EdgePotModel::Potts:
+				kernels::logPottsMatMulSq(logPot, nStates, v, dst, maxSum);
+				return *std::max_element(dst, dst + nStates);
+			case EdgePotModel::truncatedLinear:
+			case EdgePotModel::truncatedQuadratic:
+				if (maxSum) {																	// distance transform on energies
+					auto [lambda, tau] = graph.getEdgePotParams(edge);
+					for (byte s = 0; s < nStates; s++) v[s] = -v[s];
+					kernels::minConvolution(v, nStates, dst, model == EdgePotModel::truncatedQuadratic, 2 * lambda, 2 * tau);
+					for (byte s = 0; s < nStates; s++) dst[s] = -dst[s];
+					return *std::max_element(dst, dst + nStates);
+				}
+				[[fallthrough]];
+			default:
+				return LogMatMul(logPot, nStates, v, dst, maxSum);
+		}
+	}
+
+	void CMessagePassing::createLogPotentials(void)
+	{
+		CGraphPairwise	& graph	  = getGraphPairwise();
+		const size_t	  nEdges  = graph.getNumEdges();
+		const byte		  nStates = graph.getNumStates();
+		const size_t	  potSize = static_cast<size_t>(nStates) * nStates;
+
+		// Node potentials
+		for (float &pot : graph.m_vNodePots) pot = logf(pot);
+
+		// Edge potentials: one logarithm per distinct potential
+		std::unordered_map<const float*, size_t> offsets;
+		vec_size_t vOffset(nEdges, std::numeric_limits<size_t>::max());
+		m_vLogEdgePots.clear();
+		for (size_t e = 0; e < nEdges; e++) {
+			const float *pot = graph.getEdgePot(e);
+			if (!pot) continue;
+			auto it = offsets.find(pot);
+			if (it == offsets.end()) {
+				it = offsets.emplace(pot, m_vLogEdgePots.size()).first;
+				for (size_t i = 0; i < potSize; i++) m_vLogEdgePots.push_back(logf(pot[i]));
+			}
+			vOffset[e] = it->second;
+		} // e
+
+		m_vpLogEdgePots.resize(nEdges);
+		for (size_t e = 0; e < nEdges; e++)
+			m_vpLogEdgePots[e] = vOffset[e] == std::numeric_limits<size_t>::max() ? NULL : m_vLogEdgePots.data() + vOffset[e];
+	}
+
+	void CMessagePassing::deleteLogPotentials(void)
+	{
+		m_vLogEdgePots.clear();
+		m_vLogEdgePots.shrink_to_fit();
+		m_vpLogEdgePots.clear();
+		m_vpLogEdgePots.shrink_to_fit();
+	}
+
 	void CMessagePassing::createMessages(std::optional<float> val)
 	{
 		const size_t nEdges = getGraph().getNumEdges();
@@ -80,12 +230,14 @@ namespace DirectGraphicalModels
 		
 		m_msg = new float[nEdges * nStates];
 		DGM_ASSERT_MSG(m_msg, "Out of Memory");
-		m_msg_temp = new float[nEdges * nStates];
-		DGM_ASSERT_MSG(m_msg_temp, "Out of Memory");
+		if (m_useTempMessages) {
+			m_msg_temp = new float[nEdges * nStates];
+			DGM_ASSERT_MSG(m_msg_temp, "Out of Memory");
+		}
 
 		if (val) {
 			std::fill(m_msg, m_msg + nEdges * nStates, val.value());
-			std::fill(m_msg_temp, m_msg_temp + nEdges * nStates, val.value());
+			if (m_msg_temp) std::fill(m_msg_temp, m_msg_temp + nEdges * nStates, val.value());
 		}
 	}
 
@@ -119,21 +271,37 @@ namespace DirectGraphicalModels
 	}
 
 	// dst = (M * M)^T x v
-	float CMessagePassing::MatMul(const Mat& M, const float* v, float* dst, bool maxSum)
+	float CMessagePassing::MatMul(const float* M, byte nStates, const float* v, float* dst, bool maxSum)
 	{
+		DGM_ASSERT(dst);
+		std::fill(dst, dst + nStates, 0.0f);
+		kernels::matMulSq(M, nStates, v, dst, maxSum);
+		
 		float res = 0;
+		for (byte x = 0; x < nStates; x++) res += dst[x];
+		return res;
+	}
+
+	// dst = log((exp(L) * exp(L))^T x exp(v))
+	float CMessagePassing::LogMatMul(const float* L, byte nStates, const float* v, float* dst, bool maxSum)
+	{
 		DGM_ASSERT(dst);
-		for (int x = 0; x < M.cols; x++) {
-			float sum = 0;
-			for (int y = 0; y < M.rows; y++) {
-				float m = M.at<float>(y, x);
-				float prod = v[y] * m * m;
-				if (maxSum) { if (prod > sum) sum = prod; }
-				else sum += prod;
+		const float inf = std::numeric_limits<float>::infinity();
+		std::fill(dst, dst + nStates, -inf);
+		kernels::logMatMulSqMax(L, nStates, v, dst);
+
+		if (!maxSum) {																// log-sum-exp around the maximum
+			float sum[256] = { 0 };
+			for (byte y = 0; y < nStates; y++) {
+				const float *pL = L + y * nStates;
+				const float  vy = v[y];
+				for (byte x = 0; x < nStates; x++)
+					if (dst[x] > -inf) sum[x] += expf(vy + 2 * pL[x] - dst[x]);
 			} // y
-			dst[x] = sum;
-			res += sum;
-		} // x
-		return res;
+			for (byte x = 0; x < nStates; x++)
+				if (dst[x] > -inf) dst[x] += logf(sum[x]);
+		}
+
+		return *std::max_element(dst, dst + nStates);
 	}
 }
@@ -7,8 +7,6 @@
 
 namespace DirectGraphicalModels
 {
-	struct Edge;
-
 	// ==================== Message Passing Base Abstract Class ==================
 	/**
 	* @ingroup moduleDecode
@@ -21,11 +19,28 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Constructor
 		* @param graph The graph
+		* @param useTempMessages Flag indicating whether the algorithm needs the temp message container (ref. getMessageTemp()). 
+		* The in-place message passing algorithms may set it to false in order to halve the memory, needed for the messages.
 		*/
-		DllExport CMessagePassing(CGraphPairwise &graph) : CInfer(graph) {}
+		DllExport CMessagePassing(CGraphPairwise &graph, bool useTempMessages = true) : CInfer(graph), m_useTempMessages(useTempMessages) {}
 		DllExport virtual ~CMessagePassing(void) = default;
 		
 		DllExport virtual void	  infer(unsigned int nIt = 1);
+		/**
+		* @brief Switches between the probability and the log domain message passing
+		* @details In the log domain the potentials are converted to energies (logarithms of potentials) before inference, the messages are
+		* combined with additions instead of multiplications and the \a sum-product / \a max-product operations are replaced with the
+		* \a log-sum-exp / \a max-sum ones. The resulting marginals are converted back to the (normalized) probabilities.
+		* This mode is numerically stable for large graphs and small potentials, which would underflow the single precision in the probability domain.
+		* @param logDomain Flag indicating whether the message passing should be performed in the log domain
+		*/
+		DllExport void		  setLogDomain(bool logDomain) { m_logDomain = logDomain; }
+		/**
+		* @brief Checks whether the message passing is performed in the log domain
+		* @retval true if the message passing is performed in the log domain
+		* @retval false otherwise
+		*/
+		DllExport bool		  isLogDomain(void) const { return m_logDomain; }
 
 
 	protected:
@@ -33,33 +48,72 @@ namespace DirectGraphicalModels
 		* @brief Returns the graph
 		* @return The graph
 		*/
-		CGraphPairwise& getGraphPairwise(void) const { return dynamic_cast<CGraphPairwise&>(getGraph()); }
+		CGraphPairwise& getGraphPairwise(void) const { return static_cast<CGraphPairwise&>(getGraph()); }
 		/**
 		* @brief Calculates messages, associated with the edges of corresponding graphical model
-		* @details > This function may modify Edge::msg and Edge::msg_temp containers of graph edges
+		* @details > This function may modify the message containers (ref. getMessage() and getMessageTemp())
 		* @param nIt Number of iterations
 		*/
 		virtual void calculateMessages(unsigned int nIt) = 0;
 		/**
 		* @brief Calculates one message for the specified edge \b edge
 		* @details > PPL-safe function.
-		* @param[in] edge Graph edge
+		* @param[in] edge The %Edge index
 		* @param[in] temp Auxilary array of \b nStates values. Introduced for higher perfomance reasons.
-		* @param[out] dst Destination array for calculated message. Usually \b edge->msg or \b edge->msg_temp.
+		* @param[out] dst Destination array for calculated message. Usually getMessage(edge) or getMessageTemp(edge).
 		* @param[in] maxSum Flag indicating weather the message must be calculated according to the \a sum-product (false) or \a max-product (true) algorithm.
+		* @note In the log domain (ref. setLogDomain()) the node potentials and the messages are energies and the message is calculated with LogMatMul().
+		*/
+		void	calculateMessage(size_t edge, float* temp, float* dst, bool maxSum = false);
+		/**
+		* @brief Calculates the product of the squared edge potential and a vector
+		* @details This function calculates \f$\vec{dst} = (M\cdot M)^\top\times\vec{v}\f$ for the potential \f$M\f$ of the edge \b edge. 
+		* For the Potts and truncated edge potentials (ref. CGraphPairwise::setEdges()) the structure of the potential is used to calculate
+		* the product in \a O(nStates) time. Otherwise MatMul() is used.
+		* @param[in] edge The %Edge index
+		* @param[in,out] v Vector of length \b nStates. It may be modified by this function
+		* @param[out] dst Resulting vector of length \b nStates
+		* @param[in] maxSum Flag indicating weather the \a max-sum multiplication should be performed
+		* @return The sum of all elemts in vector \b dst
+		*/
+		float	edgeMatMul(size_t edge, float* v, float* dst, bool maxSum);
+		/**
+		* @brief Log domain counterpart of the edgeMatMul() function
+		* @param[in] edge The %Edge index
+		* @param[in,out] v Vector of length \b nStates. It may be modified by this function
+		* @param[out] dst Resulting vector of length \b nStates
+		* @param[in] maxSum Flag indicating weather the \a max-sum operation should be performed
+		* @return The maximal element in vector \b dst
+		*/
+		float	edgeLogMatMul(size_t edge, float* v, float* dst, bool maxSum);
+		/**
+		* @brief Converts the node potentials to the log domain and prepares the logarithms of the edge potentials
+		* @details The logarithms of the edge potentials are calculated once for every distinct potential, thus the edges sharing a
+		* potential (ref. CGraphPairwise::setEdges()) share also its logarithm.
+		*/
+		void	createLogPotentials(void);
+		/**
+		* @brief Deletes the logarithms of the edge potentials
 		*/
-		void	calculateMessage(const Edge& edge, float* temp, float* dst, bool maxSum = false);
+		void	deleteLogPotentials(void);
 		/**
-		* @brief Allocates memory for Edge::msg and Edge::msg_temp containers for all edges in the graph
-		* @param val Default value to fill in the Edge::msg and Edge::msg_temp containers 
+		* @brief Returns the pointer to the logarithm of the edge potential
+		* @param edge The %Edge index
+		* @return The pointer to the logarithm of the edge potential or NULL if the edge has no potential
+		*/
+		const float* getLogEdgePot(size_t edge) const { return m_vpLogEdgePots[edge]; }
+		/**
+		* @brief Allocates memory for the message and temp message containers for all edges in the graph
+		* @details The temp message container is allocated only if the derived class requests it in the constructor
+		* @param val Default value to fill in the message and temp message containers
 		*/
 		void	createMessages(std::optional<float> val = std::nullopt);
 		/**
-		* @brief Deletes memory for Edge::msg and Edge::msg_temp containers for all edges in the graph
+		* @brief Deletes memory for the message and temp message containers for all edges in the graph
 		*/
 		void	deleteMessages(void);
 		/**
-		* @brief Swaps Edge::msg and Edge::msg_temp for all edges in the graph 
+		* @brief Swaps the message and temp message containers for all edges in the graph
 		*/
 		void	swapMessages(void);
 		/**
@@ -71,24 +125,42 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Returns the pointer to the edge temp messages
 		* @param edge The %Edge index
-		* @return The pointer to the edge temp messages
+		* @return The pointer to the edge temp messages or NULL if the temp message container is not used
 		*/
 		float*	getMessageTemp(size_t edge);
 		/**
 		* @brief Specific matrix multiplication
 		* @details This function calculates the result of multiplying square of matrix \b M by vector \b v as following:
 		* \f$\vec{dst} = (M\cdot M)^\top\times\vec{v}\f$
-		* @param[in] M Matrix: Mat(size: \a M.height x \a M.width; type: CV_32FC1)
-		* @param[in] v Vector of length \a M.height
-		* @param[out] dst Resulting vector of length \a M.width.
+		* > The matrix is traversed row by row, \em i.e. in the order it is stored in memory.
+		* @param[in] M Square matrix of size \b nStates x \b nStates, stored in row-major order
+		* @param[in] nStates The number of states
+		* @param[in] v Vector of length \b nStates
+		* @param[out] dst Resulting vector of length \b nStates.
 		* @param[in] maxSum Flag indicating weather the \a max-sum multiplication should be performed
 		* @return The sum of all elemts in vector \b dst
 		*/
-		static float MatMul(const Mat& M, const float* v, float* dst, bool maxSum = false);
+		static float MatMul(const float* M, byte nStates, const float* v, float* dst, bool maxSum = false);
+		/**
+		* @brief Specific matrix multiplication in the log domain
+		* @details This function is the log domain counterpart of MatMul(): for the logarithm \b L of matrix \b M it calculates
+		* \f$dst_x = \log\sum_y\exp(v_y + 2L_{y,x})\f$ or \f$dst_x = \max_y(v_y + 2L_{y,x})\f$ for the \a max-sum case.
+		* @param[in] L Logarithm of the square matrix of size \b nStates x \b nStates, stored in row-major order
+		* @param[in] nStates The number of states
+		* @param[in] v Vector of length \b nStates
+		* @param[out] dst Resulting vector of length \b nStates.
+		* @param[in] maxSum Flag indicating weather the \a max-sum operation should be performed
+		* @return The maximal element in vector \b dst
+		*/
+		static float LogMatMul(const float* L, byte nStates, const float* v, float* dst, bool maxSum = false);
 
 
 	private:
-		float	* m_msg;			///< Message: Mat(size: nStates x 1; type: CV_32FC1)
-		float	* m_msg_temp;		///< Temp Message: Mat(size: nStates x 1; type: CV_32FC1)
+		float					* m_msg			= NULL;		///< Messages: nEdges x nStates
+		float					* m_msg_temp	= NULL;		///< Temp Messages: nEdges x nStates
+		bool					  m_logDomain	= false;	///< Flag indicating whether the message passing is performed in the log domain
+		bool					  m_useTempMessages;		///< Flag indicating whether the temp message container is allocated
+		vec_float_t				  m_vLogEdgePots;			///< Logarithms of the distinct edge potentials: nStates x nStates each
+		std::vector<const float*> m_vpLogEdgePots;			///< Pointers to the logarithms of the edge potentials: nEdges
 	};
 }
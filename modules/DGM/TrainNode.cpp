@@ -11,6 +11,7 @@
 #include "TrainNodeMsRF.h"
 #include "TrainNodeCvANN.h"
 #include "TrainNodeCvSVM.h"
+#include "parallel.h"
 
 #include "macroses.h"
 
@@ -63,7 +64,7 @@ namespace DirectGraphicalModels
 
 		Mat res(featureVectors.size(), CV_32FC(m_nStates));
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, res.rows, [&] (int y) {
+		parallel::parallel_for(0, res.rows, [&] (int y) {
 			Mat pot;
 			Mat vec(getNumFeatures(), 1, CV_8UC1);
 #else
@@ -99,7 +100,7 @@ namespace DirectGraphicalModels
 
 		Mat res(featureVectors[0].size(), CV_32FC(m_nStates));
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, res.rows, [&](int y) {
+		parallel::parallel_for(0, res.rows, [&](int y) {
 			Mat pot;
 			Mat vec(getNumFeatures(), 1, CV_8UC1);
 #else
@@ -0,0 +1,521 @@
+// Vectorized kernels for the message passing inference
+#pragma once
+
+#include "types.h"
+#include <cstring>
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define DGM_SSE
+#endif
+#if defined(__AVX__)
+#define DGM_AVX
+#endif
+
+namespace DirectGraphicalModels
+{
+	// ================================ Kernels Namespace ==============================
+	/**
+	* @brief Message passing kernels
+	* @details This namespace collects the inner loops of the message passing algorithms and of the permutohedral lattice, used in the dense inference. The kernels use the AVX (8 floats) and / or
+	* SSE (4 floats) vector instructions, when they are available at compile time (ref. ENABLE_AVX CMake option), and scalar code otherwise.
+	* For the most common numbers of states (2, 4, 8, 16 and 32) the kernels are instantiated with the number of states known at compile time,
+	* which allows the compiler to fully unroll the loops; the other numbers of states are processed by the generic instantiation.
+	* > The vector kernels perform exactly the same floating-point operations in the same order, as the scalar ones, thus the results do not
+	* depend on the instruction set.
+	*/
+	namespace kernels {
+		/// @cond
+		namespace impl {
+			// Calls f(std::integral_constant<int, K>) with K = nStates for the specialized numbers of states and K = 0 otherwise
+			template <typename F>
+			inline auto dispatch(byte nStates, F &&f)
+			{
+				switch (nStates) {
+					case 2:  return f(std::integral_constant<int, 2>());
+					case 4:  return f(std::integral_constant<int, 4>());
+					case 8:  return f(std::integral_constant<int, 8>());
+					case 16: return f(std::integral_constant<int, 16>());
+					case 32: return f(std::integral_constant<int, 32>());
+					default: return f(std::integral_constant<int, 0>());
+				}
+			}
+
+			template <int K, bool maxSum>
+			inline void matMulSq(const float *M, int n, const float *v, float *dst)
+			{
+				const int nStates = K ? K : n;
+				for (int y = 0; y < nStates; y++) {
+					const float *pM = M + y * nStates;
+					const float  vy = v[y];
+					int x = 0;
+#ifdef DGM_AVX
+					const __m256 vy8 = _mm256_set1_ps(vy);
+					for (; x + 8 <= nStates; x += 8) {
+						__m256 m	= _mm256_loadu_ps(pM + x);
+						__m256 prod	= _mm256_mul_ps(_mm256_mul_ps(vy8, m), m);
+						__m256 d	= _mm256_loadu_ps(dst + x);
+						_mm256_storeu_ps(dst + x, maxSum ? _mm256_max_ps(d, prod) : _mm256_add_ps(d, prod));
+					}
+#endif
+#ifdef DGM_SSE
+					const __m128 vy4 = _mm_set1_ps(vy);
+					for (; x + 4 <= nStates; x += 4) {
+						__m128 m	= _mm_loadu_ps(pM + x);
+						__m128 prod	= _mm_mul_ps(_mm_mul_ps(vy4, m), m);
+						__m128 d	= _mm_loadu_ps(dst + x);
+						_mm_storeu_ps(dst + x, maxSum ? _mm_max_ps(d, prod) : _mm_add_ps(d, prod));
+					}
+#endif
+					for (; x < nStates; x++) {
+						float prod = vy * pM[x] * pM[x];
+						if (maxSum) { if (prod > dst[x]) dst[x] = prod; }
+						else dst[x] += prod;
+					} // x
+				} // y
+			}
+
+			template <int K>
+			inline void logMatMulSqMax(const float *L, int n, const float *v, float *dst)
+			{
+				const int nStates = K ? K : n;
+				for (int y = 0; y < nStates; y++) {
+					const float *pL = L + y * nStates;
+					const float  vy = v[y];
+					int x = 0;
+#ifdef DGM_AVX
+					const __m256 vy8 = _mm256_set1_ps(vy);
+					const __m256 two8 = _mm256_set1_ps(2.0f);
+					for (; x + 8 <= nStates; x += 8) {
+						__m256 val = _mm256_add_ps(vy8, _mm256_mul_ps(two8, _mm256_loadu_ps(pL + x)));
+						_mm256_storeu_ps(dst + x, _mm256_max_ps(_mm256_loadu_ps(dst + x), val));
+					}
+#endif
+#ifdef DGM_SSE
+					const __m128 vy4 = _mm_set1_ps(vy);
+					const __m128 two4 = _mm_set1_ps(2.0f);
+					for (; x + 4 <= nStates; x += 4) {
+						__m128 val = _mm_add_ps(vy4, _mm_mul_ps(two4, _mm_loadu_ps(pL + x)));
+						_mm_storeu_ps(dst + x, _mm_max_ps(_mm_loadu_ps(dst + x), val));
+					}
+#endif
+					for (; x < nStates; x++) {
+						float val = vy + 2 * pL[x];
+						if (val > dst[x]) dst[x] = val;
+					} // x
+				} // y
+			}
+
+			// Returns max(a[x] * b[x]) if mul is true and max(a[x] + b[x]) otherwise
+			template <int K, bool mul>
+			inline float reduceMax(const float *a, const float *b, int n)
+			{
+				const int nStates = K ? K : n;
+				float res = mul ? a[0] * b[0] : a[0] + b[0];
+				int x = 0;
+#ifdef DGM_SSE
+				if (nStates >= 4) {
+					__m128 max4 = _mm_set1_ps(res);
+#ifdef DGM_AVX
+					if (nStates >= 8) {
+						__m256 max8 = _mm256_set1_ps(res);
+						for (; x + 8 <= nStates; x += 8) {
+							__m256 a8 = _mm256_loadu_ps(a + x);
+							__m256 b8 = _mm256_loadu_ps(b + x);
+							max8 = _mm256_max_ps(max8, mul ? _mm256_mul_ps(a8, b8) : _mm256_add_ps(a8, b8));
+						}
+						max4 = _mm_max_ps(_mm256_castps256_ps128(max8), _mm256_extractf128_ps(max8, 1));
+					}
+#endif
+					for (; x + 4 <= nStates; x += 4) {
+						__m128 a4 = _mm_loadu_ps(a + x);
+						__m128 b4 = _mm_loadu_ps(b + x);
+						max4 = _mm_max_ps(max4, mul ? _mm_mul_ps(a4, b4) : _mm_add_ps(a4, b4));
+					}
+					max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+					max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, 1));
+					res = _mm_cvtss_f32(max4);
+				}
+#endif
+				for (; x < nStates; x++) {
+					float val = mul ? a[x] * b[x] : a[x] + b[x];
+					if (res < val) res = val;
+				} // x
+				return res;
+			}
+
+			// Polynomial approximation of e^x (Cephes expf): e^x = 2^n e^r with |r| <= ln(2) / 2
+			// The rounding to the nearest integer uses the magic number 1.5 * 2^23, since |x log2(e)| < 2^22
+			constexpr float EXP_HI		= 88.3762626647949f;
+			constexpr float EXP_LO		= -87.3365447504019f;
+			constexpr float LOG2E		= 1.44269504088896341f;
+			constexpr float LN2_HI		= 0.693359375f;
+			constexpr float LN2_LO		= -2.12194440e-4f;
+			constexpr float ROUND		= 12582912.0f;
+			constexpr float EXP_P[6]	= { 1.9875691500E-4f, 1.3981999507E-3f, 8.3334519073E-3f, 4.1665795894E-2f, 1.6666665459E-1f, 5.0000001201E-1f };
+
+			inline float fastExp(float x)
+			{
+				x = MIN(MAX(x, EXP_LO), EXP_HI);
+				float n = (x * LOG2E + ROUND) - ROUND;
+				float r = (x - n * LN2_HI) - n * LN2_LO;
+				float p = EXP_P[0];
+				for (int i = 1; i < 6; i++) p = p * r + EXP_P[i];
+				p = (p * (r * r) + r) + 1.0f;
+				int e = (static_cast<int>(n) + 127) << 23;
+				float pow2n;
+				memcpy(&pow2n, &e, sizeof(float));
+				return p * pow2n;
+			}
+
+#ifdef DGM_SSE
+			inline __m128 fastExp(__m128 x)
+			{
+				x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_LO)), _mm_set1_ps(EXP_HI));
+				__m128 n = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(LOG2E)), _mm_set1_ps(ROUND)), _mm_set1_ps(ROUND));
+				__m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(LN2_HI))), _mm_mul_ps(n, _mm_set1_ps(LN2_LO)));
+				__m128 p = _mm_set1_ps(EXP_P[0]);
+				for (int i = 1; i < 6; i++) p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(EXP_P[i]));
+				p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), r), _mm_set1_ps(1.0f));
+				__m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+				return _mm_mul_ps(p, _mm_castsi128_ps(e));
+			}
+#endif
+#ifdef DGM_AVX
+			inline __m256 fastExp(__m256 x)
+			{
+				// AVX has no 256-bit integer operations, thus the power of two is assembled from two SSE halves
+				x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_LO)), _mm256_set1_ps(EXP_HI));
+				__m256 n = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(LOG2E)), _mm256_set1_ps(ROUND)), _mm256_set1_ps(ROUND));
+				__m256 r = _mm256_sub_ps(_mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(LN2_HI))), _mm256_mul_ps(n, _mm256_set1_ps(LN2_LO)));
+				__m256 p = _mm256_set1_ps(EXP_P[0]);
+				for (int i = 1; i < 6; i++) p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(EXP_P[i]));
+				p = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p, _mm256_mul_ps(r, r)), r), _mm256_set1_ps(1.0f));
+				__m256i ni = _mm256_cvttps_epi32(n);
+				__m128i lo = _mm_slli_epi32(_mm_add_epi32(_mm256_castsi256_si128(ni), _mm_set1_epi32(127)), 23);
+				__m128i hi = _mm_slli_epi32(_mm_add_epi32(_mm256_extractf128_si256(ni, 1), _mm_set1_epi32(127)), 23);
+				__m256 pow2n = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_castsi128_ps(lo)), _mm_castsi128_ps(hi), 1);
+				return _mm256_mul_ps(p, pow2n);
+			}
+#endif
+		}
+		/// @endcond
+
+		/**
+		* @brief Accumulates the product of the squared matrix and a vector
+		* @details This function calculates \f$dst_x \mathrel{+}= \sum_y v_y M_{y,x}^2\f$, or \f$dst_x = \max(dst_x, \max_y v_y M_{y,x}^2)\f$ for the \a max-sum case.
+		* > The matrix is traversed row by row, \em i.e. in the order it is stored in memory.
+		* @param[in] M Square matrix of size \b nStates x \b nStates, stored in row-major order
+		* @param[in] nStates The number of states
+		* @param[in] v Vector of length \b nStates
+		* @param[in,out] dst Resulting vector of length \b nStates
+		* @param[in] maxSum Flag indicating weather the \a max-sum multiplication should be performed
+		*/
+		inline void matMulSq(const float *M, byte nStates, const float *v, float *dst, bool maxSum)
+		{
+			impl::dispatch(nStates, [&](auto K) {
+				if (maxSum) impl::matMulSq<decltype(K)::value, true>(M, nStates, v, dst);
+				else		impl::matMulSq<decltype(K)::value, false>(M, nStates, v, dst);
+			});
+		}
+		/**
+		* @brief Log domain counterpart of the matMulSq() function for the \a max-sum case
+		* @details This function calculates \f$dst_x = \max(dst_x, \max_y(v_y + 2L_{y,x}))\f$
+		* @param[in] L Square matrix of size \b nStates x \b nStates, stored in row-major order
+		* @param[in] nStates The number of states
+		* @param[in] v Vector of length \b nStates
+		* @param[in,out] dst Resulting vector of length \b nStates
+		*/
+		inline void logMatMulSqMax(const float *L, byte nStates, const float *v, float *dst)
+		{
+			impl::dispatch(nStates, [&](auto K) { impl::logMatMulSqMax<decltype(K)::value>(L, nStates, v, dst); });
+		}
+		/**
+		* @brief Returns the maximum of the element-wise product of two vectors: \f$\max_x(a_x b_x)\f$
+		* @param a The first vector of length \b nStates
+		* @param b The second vector of length \b nStates
+		* @param nStates The number of states
+		* @return The maximal product
+		*/
+		inline float maxProd(const float *a, const float *b, byte nStates)
+		{
+			return impl::dispatch(nStates, [&](auto K) { return impl::reduceMax<decltype(K)::value, true>(a, b, nStates); });
+		}
+		/**
+		* @brief Returns the maximum of the element-wise sum of two vectors: \f$\max_x(a_x + b_x)\f$
+		* @param a The first vector of length \b nStates
+		* @param b The second vector of length \b nStates
+		* @param nStates The number of states
+		* @return The maximal sum
+		*/
+		inline float maxSum(const float *a, const float *b, byte nStates)
+		{
+			return impl::dispatch(nStates, [&](auto K) { return impl::reduceMax<decltype(K)::value, false>(a, b, nStates); });
+		}
+		/**
+		* @brief Potts counterpart of the matMulSq() function
+		* @details This function calculates \f$dst_x = \sum_y v_y M_{y,x}^2\f$, or \f$dst_x = \max_y v_y M_{y,x}^2\f$ for the \a max-sum case, 
+		* in \a O(nStates) time for the matrix \b M, whose off-diagonal elements are equal in each row (ref. CGraphPairwise::isPotts()).
+		* @param[in] M Square matrix of size \b nStates x \b nStates, stored in row-major order
+		* @param[in] nStates The number of states
+		* @param[in] v Vector of length \b nStates
+		* @param[out] dst Resulting vector of length \b nStates
+		* @param[in] maxSum Flag indicating weather the \a max-sum multiplication should be performed
+		*/
+		inline void pottsMatMulSq(const float *M, byte nStates, const float *v, float *dst, bool maxSum)
+		{
+			if (maxSum) {
+				float max1 = -std::numeric_limits<float>::infinity();			// the largest and the second largest off-diagonal products
+				float max2 = max1;
+				byte  arg1 = 0;
+				for (byte y = 0; y < nStates; y++) {
+					const float off = M[y * nStates + (y == 0 ? 1 : 0)];
+					const float val = v[y] * off * off;
+					if (val > max1) { max2 = max1; max1 = val; arg1 = y; }
+					else if (val > max2) max2 = val;
+				} // y
+				for (byte x = 0; x < nStates; x++) {
+					const float diag = M[x * nStates + x];
+					dst[x] = MAX(x == arg1 ? max2 : max1, v[x] * diag * diag);
+				} // x
+			} else {
+				float sum = 0;
+				for (byte y = 0; y < nStates; y++) {
+					const float off = M[y * nStates + (y == 0 ? 1 : 0)];
+					sum += v[y] * off * off;
+				} // y
+				for (byte x = 0; x < nStates; x++) {
+					const float off	 = M[x * nStates + (x == 0 ? 1 : 0)];
+					const float diag = M[x * nStates + x];
+					dst[x] = MAX(0.0f, sum + v[x] * (diag * diag - off * off));
+				} // x
+			}
+		}
+		/**
+		* @brief Log domain counterpart of the pottsMatMulSq() function
+		* @details This function calculates \f$dst_x = \log\sum_y\exp(v_y + 2L_{y,x})\f$, or \f$dst_x = \max_y(v_y + 2L_{y,x})\f$ for the \a max-sum case,
+		* in \a O(nStates) time for the matrix \b L, whose off-diagonal elements are equal in each row.
+		* @param[in] L Square matrix of size \b nStates x \b nStates, stored in row-major order
+		* @param[in] nStates The number of states
+		* @param[in] v Vector of length \b nStates
+		* @param[out] dst Resulting vector of length \b nStates
+		* @param[in] maxSum Flag indicating weather the \a max-sum operation should be performed
+		*/
+		inline void logPottsMatMulSq(const float *L, byte nStates, const float *v, float *dst, bool maxSum)
+		{
+			const float inf = std::numeric_limits<float>::infinity();
+			if (maxSum) {
+				float max1 = -inf;												// the largest and the second largest off-diagonal sums
+				float max2 = max1;
+				byte  arg1 = 0;
+				for (byte y = 0; y < nStates; y++) {
+					const float val = v[y] + 2 * L[y * nStates + (y == 0 ? 1 : 0)];
+					if (val > max1) { max2 = max1; max1 = val; arg1 = y; }
+					else if (val > max2) max2 = val;
+				} // y
+				for (byte x = 0; x < nStates; x++)
+					dst[x] = MAX(x == arg1 ? max2 : max1, v[x] + 2 * L[x * nStates + x]);
+			} else {
+				float max = -inf;
+				for (byte y = 0; y < nStates; y++)
+					max = MAX(max, v[y] + 2 * MAX(L[y * nStates + y], L[y * nStates + (y == 0 ? 1 : 0)]));
+				if (max == -inf) {
+					std::fill(dst, dst + nStates, -inf);
+					return;
+				}
+				float sum = 0;
+				for (byte y = 0; y < nStates; y++)
+					sum += expf(v[y] + 2 * L[y * nStates + (y == 0 ? 1 : 0)] - max);
+				for (byte x = 0; x < nStates; x++) {
+					const float val = sum + expf(v[x] + 2 * L[x * nStates + x] - max) - expf(v[x] + 2 * L[x * nStates + (x == 0 ? 1 : 0)] - max);
+					dst[x] = max + logf(MAX(0.0f, val));
+				} // x
+			}
+		}
+		/**
+		* @brief Potts counterpart of the maxProd() function, applied to every row of the matrix
+		* @details This function calculates \f$dst_y = \max_x(v_x M_{y,x})\f$ in \a O(nStates) time for the matrix \b M, whose off-diagonal elements are equal in each row.
+		* @param[in] M Square matrix of size \b nStates x \b nStates, stored in row-major order
+		* @param[in] nStates The number of states
+		* @param[in] v Vector of length \b nStates
+		* @param[out] dst Resulting vector of length \b nStates
+		* @param[in] logDomain Flag indicating whether the matrix and the vector are in the log domain, \a i.e. \f$dst_y = \max_x(v_x + M_{y,x})\f$ should be calculated
+		*/
+		inline void pottsMaxProd(const float *M, byte nStates, const float *v, float *dst, bool logDomain)
+		{
+			float max1 = -std::numeric_limits<float>::infinity();				// the largest and the second largest elements of v
+			float max2 = max1;
+			byte  arg1 = 0;
+			for (byte x = 0; x < nStates; x++) {
+				if (v[x] > max1) { max2 = max1; max1 = v[x]; arg1 = x; }
+				else if (v[x] > max2) max2 = v[x];
+			} // x
+			for (byte y = 0; y < nStates; y++) {
+				const float off	 = M[y * nStates + (y == 0 ? 1 : 0)];
+				const float diag = M[y * nStates + y];
+				const float max	 = y == arg1 ? max2 : max1;
+				dst[y] = logDomain ? MAX(off + max, diag + v[y]) : MAX(off * max, diag * v[y]);
+			} // y
+		}
+		/**
+		* @brief Min-convolution of a vector with a truncated linear or quadratic function
+		* @details This function calculates \f$dst_x = \min_y\left(f_y + \min(\lambda d(x, y), \tau)\right)\f$ with \f$d(x, y) = |x - y|\f$ or 
+		* \f$d(x, y) = (x - y)^2\f$ in \a O(nStates) time with the distance transform, described in the paper 
+		* <a href="http://cs.brown.edu/people/pfelzens/papers/dt-final.pdf" target="_blank">Distance Transforms of Sampled Functions</a>.
+		* It is the energy form of the max-product message for the truncated linear and truncated quadratic edge potentials.
+		* @param[in] f Vector of length \b nStates. Its elements may be \f$+\infty\f$
+		* @param[in] nStates The number of states
+		* @param[out] dst Resulting vector of length \b nStates. It must not overlap with \b f
+		* @param[in] quadratic Flag indicating whether \f$d(x, y)\f$ is quadratic
+		* @param[in] lambda The weight \f$\lambda \geq 0\f$
+		* @param[in] tau The truncation threshold \f$\tau\f$
+		*/
+		inline void minConvolution(const float *f, byte nStates, float *dst, bool quadratic, float lambda, float tau)
+		{
+			const float inf  = std::numeric_limits<float>::infinity();
+			const float minF = *std::min_element(f, f + nStates);
+
+			if (!quadratic || lambda == 0) {
+				std::copy(f, f + nStates, dst);
+				for (int x = 1; x < nStates; x++)		dst[x] = MIN(dst[x], dst[x - 1] + lambda);
+				for (int x = nStates - 2; x >= 0; x--)	dst[x] = MIN(dst[x], dst[x + 1] + lambda);
+			} else if (minF == inf) {
+				std::fill(dst, dst + nStates, inf);
+			} else {
+				// Lower envelope of the parabolas
+				int	  v[256];														// locations of the parabolas in the lower envelope
+				float z[257];														// boundaries between the parabolas
+				int	  k = -1;
+				for (int q = 0; q < nStates; q++) {
+					if (f[q] == inf) continue;
+					if (k < 0) {
+						k = 0;
+						v[0] = q;
+						z[0] = -inf;
+						z[1] = inf;
+						continue;
+					}
+					float s;
+					while (true) {
+						s = ((f[q] + lambda * q * q) - (f[v[k]] + lambda * v[k] * v[k])) / (2 * lambda * (q - v[k]));
+						if (s > z[k]) break;
+						k--;
+					}
+					k++;
+					v[k] = q;
+					z[k] = s;
+					z[k + 1] = inf;
+				} // q
+
+				k = 0;
+				for (int x = 0; x < nStates; x++) {
+					while (z[k + 1] < x) k++;
+					dst[x] = lambda * (x - v[k]) * (x - v[k]) + f[v[k]];
+				} // x
+			}
+
+			// Truncation
+			for (int x = 0; x < nStates; x++) dst[x] = MIN(dst[x], minF + tau);
+		}
+		/**
+		* @brief Accumulates the scaled vector
+		* @details This function calculates \f$dst_x \mathrel{+}= a v_x b\f$. It is used for splatting and slicing the values in the permutohedral lattice.
+		* @param[in] a The first scale factor
+		* @param[in] v Vector of length \b n
+		* @param[in,out] dst Resulting vector of length \b n
+		* @param[in] n The length of the vectors
+		* @param[in] b The second scale factor
+		*/
+		inline void axpy(float a, const float *v, float *dst, int n, float b = 1.0f)
+		{
+			int x = 0;
+#ifdef DGM_AVX
+			const __m256 a8 = _mm256_set1_ps(a);
+			const __m256 b8 = _mm256_set1_ps(b);
+			for (; x + 8 <= n; x += 8)
+				_mm256_storeu_ps(dst + x, _mm256_add_ps(_mm256_loadu_ps(dst + x), _mm256_mul_ps(_mm256_mul_ps(a8, _mm256_loadu_ps(v + x)), b8)));
+#endif
+#ifdef DGM_SSE
+			const __m128 a4 = _mm_set1_ps(a);
+			const __m128 b4 = _mm_set1_ps(b);
+			for (; x + 4 <= n; x += 4)
+				_mm_storeu_ps(dst + x, _mm_add_ps(_mm_loadu_ps(dst + x), _mm_mul_ps(_mm_mul_ps(a4, _mm_loadu_ps(v + x)), b4)));
+#endif
+			for (; x < n; x++) dst[x] += a * v[x] * b;
+		}
+		/**
+		* @brief Multiplies the vector with the exponent of the scaled vector
+		* @details This function calculates \f$dst_x = u_x e^{a v_x}\f$. It is used for applying the dense edge models (ref. CEdgeModelPotts) to the node potentials.
+		* > The exponent is approximated by a polynomial with the relative error of about 1e-7. The argument of the exponent is clamped to [-87.3; 88.3], 
+		* \a i.e. the normalized range of the single-precision floating-point numbers.
+		* @param[in] a The scale factor
+		* @param[in] v Vector of length \b n
+		* @param[in] u Vector of length \b n
+		* @param[out] dst Resulting vector of length \b n. It may be the same as \b u
+		* @param[in] n The length of the vectors
+		*/
+		inline void mulExp(float a, const float *v, const float *u, float *dst, int n)
+		{
+			int x = 0;
+#ifdef DGM_AVX
+			const __m256 a8 = _mm256_set1_ps(a);
+			for (; x + 8 <= n; x += 8)
+				_mm256_storeu_ps(dst + x, _mm256_mul_ps(_mm256_loadu_ps(u + x), impl::fastExp(_mm256_mul_ps(a8, _mm256_loadu_ps(v + x)))));
+#endif
+#ifdef DGM_SSE
+			const __m128 a4 = _mm_set1_ps(a);
+			for (; x + 4 <= n; x += 4)
+				_mm_storeu_ps(dst + x, _mm_mul_ps(_mm_loadu_ps(u + x), impl::fastExp(_mm_mul_ps(a4, _mm_loadu_ps(v + x)))));
+#endif
+			for (; x < n; x++) dst[x] = u[x] * impl::fastExp(a * v[x]);
+		}
+		/**
+		* @brief Normalizes the vector
+		* @details This function calculates \f$dst_x = v_x / \sum_y v_y\f$. If the sum is too small, the vector is copied unchanged.
+		* @param[in] v Vector of length \b n
+		* @param[out] dst Resulting vector of length \b n. It may be the same as \b v
+		* @param[in] n The length of the vectors
+		*/
+		inline void normalize(const float *v, float *dst, int n)
+		{
+			float sum = 0;
+			for (int x = 0; x < n; x++) sum += v[x];
+			const float k = sum > DBL_EPSILON ? 1.0f / sum : 1.0f;
+			int x = 0;
+#ifdef DGM_AVX
+			const __m256 k8 = _mm256_set1_ps(k);
+			for (; x + 8 <= n; x += 8)
+				_mm256_storeu_ps(dst + x, _mm256_mul_ps(k8, _mm256_loadu_ps(v + x)));
+#endif
+#ifdef DGM_SSE
+			const __m128 k4 = _mm_set1_ps(k);
+			for (; x + 4 <= n; x += 4)
+				_mm_storeu_ps(dst + x, _mm_mul_ps(k4, _mm_loadu_ps(v + x)));
+#endif
+			for (; x < n; x++) dst[x] = k * v[x];
+		}
+		/**
+		* @brief Blurs the vector with its two neighbours
+		* @details This function calculates \f$dst_x = v_x + 0.5(n1_x + n2_x)\f$. It is used for blurring the values in the permutohedral lattice.
+		* @param[in] v Vector of length \b n
+		* @param[in] n1 The first neighbour vector of length \b n
+		* @param[in] n2 The second neighbour vector of length \b n
+		* @param[out] dst Resulting vector of length \b n. It must not overlap with the other vectors
+		* @param[in] n The length of the vectors
+		*/
+		inline void blur(const float *v, const float *n1, const float *n2, float *dst, int n)
+		{
+			int x = 0;
+#ifdef DGM_AVX
+			const __m256 half8 = _mm256_set1_ps(0.5f);
+			for (; x + 8 <= n; x += 8)
+				_mm256_storeu_ps(dst + x, _mm256_add_ps(_mm256_loadu_ps(v + x), _mm256_mul_ps(half8, _mm256_add_ps(_mm256_loadu_ps(n1 + x), _mm256_loadu_ps(n2 + x)))));
+#endif
+#ifdef DGM_SSE
+			const __m128 half4 = _mm_set1_ps(0.5f);
+			for (; x + 4 <= n; x += 4)
+				_mm_storeu_ps(dst + x, _mm_add_ps(_mm_loadu_ps(v + x), _mm_mul_ps(half4, _mm_add_ps(_mm_loadu_ps(n1 + x), _mm_loadu_ps(n2 + x)))));
+#endif
+			for (; x < n; x++) dst[x] = v[x] + 0.5f * (n1[x] + n2[x]);
+		}
+	}
+}
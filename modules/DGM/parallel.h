@@ -4,10 +4,225 @@
 #include "types.h"
 #include "macroses.h"
 #include "random.h"
+#if defined(ENABLE_PPL) && !defined(_MSC_VER)
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#endif
 
 namespace DirectGraphicalModels { namespace parallel {
+// ------------------------------------------ BACKEND ----------------------------------------
+// ------------- PPL with MSVC compiler, portable std::thread pool with all others -----------
+	/// @cond
+	namespace impl {
+#if defined(ENABLE_PPL) && !defined(_MSC_VER)
+		// Pool of worker threads shared by all the parallel regions of the process
+		class CThreadPool {
+		public:
+			CThreadPool(const CThreadPool&) = delete;
+			~CThreadPool(void)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+				m_cv.notify_all();
+				for (std::thread &worker : m_vWorkers) worker.join();
+			}
+			const CThreadPool& operator= (const CThreadPool&) = delete;
+
+			static CThreadPool& getInstance(void)
+			{
+				static CThreadPool instance;
+				return instance;
+			}
+
+			size_t getNumThreads(void) const { return m_vWorkers.size() + 1; }
+
+			// Executes body(begin, end) over the chunks of [0; size), the calling thread takes part in the work.
+			// Chunks are distributed dynamically, so the faster threads take over the work of the slower ones.
+			// The first exception, thrown by the body in any thread, is re-thrown in the calling thread after all the taken chunks are finished.
+			void run(size_t size, size_t grain, const std::function<void(size_t, size_t)> &body)
+			{
+				if (size == 0) return;
+				size_t nTasks = MIN(m_vWorkers.size(), (size - 1) / grain);
+				if (nTasks == 0) { body(0, size); return; }
+
+				auto region = std::make_shared<SRegion>(size, grain, body);
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					for (size_t t = 0; t < nTasks; t++) m_queue.push_back(region);
+				}
+				m_cv.notify_all();
+				
+				region->execute();
+				while (region->nActive.load() > 0) std::this_thread::yield();			// wait for the chunks taken by the workers
+				if (region->error) std::rethrow_exception(region->error);
+			}
+
+
+		private:
+			struct SRegion {
+				SRegion(size_t _size, size_t _grain, const std::function<void(size_t, size_t)> &_body) : size(_size), grain(_grain), body(_body), next(0), nActive(0) {}
+				
+				void execute(void)
+				{
+					nActive++;															// must be increased before a chunk is taken
+					for (size_t begin = next.fetch_add(grain); begin < size; begin = next.fetch_add(grain))
+						try {
+							body(begin, MIN(begin + grain, size));
+						} catch (...) {
+							std::lock_guard<std::mutex> lock(mtxError);
+							if (!error) error = std::current_exception();
+							next = size;												// no more chunks are taken
+						}
+					nActive--;
+				}
+
+				const size_t								  size;
+				const size_t								  grain;
+				const std::function<void(size_t, size_t)>	& body;		// valid as long as there are chunks to take
+				std::atomic<size_t>							  next;
+				std::atomic<int>							  nActive;
+				std::exception_ptr							  error;	// the first exception, thrown by the body
+				std::mutex									  mtxError;
+			};
+
+
+		private:
+			CThreadPool(void)
+			{
+				size_t nWorkers = MAX(1U, std::thread::hardware_concurrency()) - 1;
+				for (size_t w = 0; w < nWorkers; w++)
+					m_vWorkers.emplace_back([this] {
+						for (;;) {
+							std::shared_ptr<SRegion> region;
+							{
+								std::unique_lock<std::mutex> lock(m_mutex);
+								m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+								if (m_queue.empty()) return;
+								region = m_queue.front();
+								m_queue.pop_front();
+							}
+							region->execute();
+						}
+					});
+			}
+
+
+		private:
+			std::vector<std::thread>				m_vWorkers;
+			std::deque<std::shared_ptr<SRegion>>	m_queue;
+			std::mutex								m_mutex;
+			std::condition_variable					m_cv;
+			bool									m_stop = false;
+		};
+#endif
+	}
+	///@endcond
+
+	/**
+	* @brief Returns the number of threads, which may be used for the parallel computing
+	* @return The number of hardware threads if ENABLE_PPL is defined, 1 otherwise
+	*/
+	inline size_t getNumThreads(void)
+	{
+#ifdef ENABLE_PPL
+#ifdef _MSC_VER
+		return MAX(1U, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+#else
+		return impl::CThreadPool::getInstance().getNumThreads();
+#endif
+#else
+		return 1;
+#endif
+	}
+
+	/**
+	* @brief Parallel for-loop
+	* @details Executes \b func(i) for \f$ i = first, first + step, \dots < last \f$. Iterations are distributed among the threads of the parallel backend: 
+	* Parallel Pattern Library with MSVC compiler, or the portable thread pool with other compilers. Without ENABLE_PPL the iterations are performed sequentially.
+	* @tparam _Index_type The type of the loop index
+	* @tparam _Function The type of the function object, which has signature \a void(_Index_type)
+	* @param first The first index
+	* @param last The index one past the last index
+	* @param step The increment value
+	* @param func The function object to be executed at each iteration
+	*/
+	template <typename _Index_type, typename _Function>
+	inline void parallel_for(_Index_type first, _Index_type last, _Index_type step, const _Function &func)
+	{
+		DGM_ASSERT(step > 0);
+#ifdef ENABLE_PPL
+#ifdef _MSC_VER
+		concurrency::parallel_for(first, last, step, func);
+#else
+		if (!(first < last)) return;
+		const size_t size  = (static_cast<size_t>(last - first) + static_cast<size_t>(step) - 1) / static_cast<size_t>(step);
+		const size_t grain = MAX(1, size / (getNumThreads() * 16));
+		impl::CThreadPool::getInstance().run(size, grain, [first, step, &func](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				func(static_cast<_Index_type>(first + static_cast<_Index_type>(i) * step));
+		});
+#endif
+#else
+		for (_Index_type i = first; i < last; i += step) func(i);
+#endif
+	}
+
+	/**
+	* @brief Parallel for-loop
+	* @details Executes \b func(i) for \f$ i \in [first; last) \f$ in parallel (ref. @ref parallel_for(_Index_type, _Index_type, _Index_type, const _Function &))
+	* @tparam _Index_type The type of the loop index
+	* @tparam _Function The type of the function object, which has signature \a void(_Index_type)
+	* @param first The first index
+	* @param last The index one past the last index
+	* @param func The function object to be executed at each iteration
+	*/
+	template <typename _Index_type, typename _Function>
+	inline void parallel_for(_Index_type first, _Index_type last, const _Function &func)
+	{
+		parallel_for(first, last, _Index_type(1), func);
+	}
+
+	/**
+	* @brief Parallel for-each loop
+	* @details Applies \b func to every element in range [\b first; \b last) in parallel
+	* @tparam _Iterator The type of the random-access iterator
+	* @tparam _Function The type of the function object, which has signature \a void(T&)
+	* @param first The beginning of the range
+	* @param last The end of the range
+	* @param func The function object to be applied to every element
+	*/
+	template <typename _Iterator, typename _Function>
+	inline void parallel_for_each(_Iterator first, _Iterator last, const _Function &func)
+	{
+#if defined(ENABLE_PPL) && defined(_MSC_VER)
+		concurrency::parallel_for_each(first, last, func);
+#else
+		parallel_for<ptrdiff_t>(0, last - first, [first, &func](ptrdiff_t i) { func(*(first + i)); });
+#endif
+	}
+
+	/**
+	* @brief Executes two function objects in parallel
+	* @param func1 The first function object with signature \a void(void)
+	* @param func2 The second function object with signature \a void(void)
+	*/
+	template <typename _Function1, typename _Function2>
+	inline void parallel_invoke(const _Function1 &func1, const _Function2 &func2)
+	{
+#if defined(ENABLE_PPL) && defined(_MSC_VER)
+		concurrency::parallel_invoke(func1, func2);
+#else
+		parallel_for(0, 2, [&func1, &func2](int i) { if (i == 0) func1(); else func2(); });
+#endif
+	}
+
 // ------------------------------------------- GEMM ------------------------------------------
-// --------------------- fast generalized matrix multiplication with PPL ---------------------
+// --------------- fast generalized matrix multiplication with parallel backend --------------
 	/// @cond
 	namespace impl {
 #ifdef ENABLE_AMP
@@ -63,7 +278,7 @@ namespace DirectGraphicalModels { namespace parallel {
 			DGM_ASSERT(res.cols == B.cols);
 
 			const Mat _B = B.t();
-			concurrency::parallel_for(0, res.rows, [&](int y) {
+			parallel_for(0, res.rows, [&](int y) {
 				float * pRes = res.ptr<float>(y);
 				const float * pA = A.ptr<float>(y);
 				for (int x = 0; x < res.cols; x++) {
@@ -84,7 +299,7 @@ namespace DirectGraphicalModels { namespace parallel {
 			DGM_ASSERT(res.cols == B.cols && res.cols == C.cols);
 
 			const Mat _B = B.t();
-			concurrency::parallel_for(0, res.rows, [&](int y) {
+			parallel_for(0, res.rows, [&](int y) {
 				float * pRes = res.ptr<float>(y);
 				const float * pA = A.ptr<float>(y);
 				const float * pC = C.ptr<float>(y);
@@ -189,7 +404,7 @@ namespace DirectGraphicalModels { namespace parallel {
 					while (m.at<T>(_begin, x) < pivot) _begin++;
 					while (m.at<T>(_end,   x) > pivot) _end--;
 					if (_begin <= _end) {
-						Swap(m.row(_begin), m.row(_end));
+						Swap(lvalue_cast(m.row(_begin)), lvalue_cast(m.row(_end)));
 						_begin++;
 						_end--;
 					}
@@ -197,7 +412,7 @@ namespace DirectGraphicalModels { namespace parallel {
 
 				// recursion 
 				if (depthRemaining > 0)
-					concurrency::parallel_invoke(
+					parallel_invoke(
 						[&, x, begin, _end] { if (begin < _end)	parallel_quick_sort<T>(m, x, begin, _end, threshold, depthRemaining - 1); },
 						[&, x, end, _begin] { if (_begin < end)	parallel_quick_sort<T>(m, x, _begin, end, threshold, depthRemaining - 1); }
 				);
@@ -223,7 +438,7 @@ namespace DirectGraphicalModels { namespace parallel {
 	{
 		DGM_ASSERT(x < m.cols);
 #ifdef ENABLE_PPL
-		const int nCores = MAX(1, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+		const int nCores = static_cast<int>(getNumThreads());
 		parallel_quick_sort<T>(m, x, 0, m.rows - 1, 200, static_cast<int>(log2f(float(nCores))) + 4);
 #else 
 		sequential_quick_sort<T>(m, x, 0, m.rows - 1, 200);
@@ -238,7 +453,7 @@ namespace DirectGraphicalModels { namespace parallel {
 			if (begin == end)    return;				// do not sort one element
 
 #ifdef ENABLE_PPL
-			const int nCores = MAX(1, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+			const int nCores = static_cast<int>(getNumThreads());
 			parallel_quick_sort<T>(m, depth, begin, end, 200, static_cast<int>(log2f(float(nCores))) + 4);
 #else 
 			sequential_quick_sort<T>(m, depth, begin, end, 200);
@@ -282,15 +497,14 @@ namespace DirectGraphicalModels { namespace parallel {
 	DllExport inline void shuffleRows(Mat &m)
 	{
 #ifdef ENABLE_PPL
-		// int nCores = MAX(1, std::thread::hardware_concurrency());
-		int nCores = MAX(1, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+		int nCores = static_cast<int>(getNumThreads());
 		int step = MAX(2, m.rows / (nCores * 10));
-		concurrency::parallel_for(0, m.rows, step, [step, &m](int S) {
+		parallel_for(0, m.rows, step, [step, &m](int S) {
 			Mat tmp;
 			int last = MIN(S + step, m.rows);
 			for (int s = last - 1; s > S; s--) {									// s = [last - 1; S + 1]
 				dword r = DirectGraphicalModels::random::u<dword>(S, s);			// r = [S; s] = [S; S + 1] -> [S; last - 1]
-				if (r != s) Swap(m.row(s), m.row(r), tmp);
+				if (r != s) Swap(lvalue_cast(m.row(s)), lvalue_cast(m.row(r)), tmp);
 			}
 		});
 #else	
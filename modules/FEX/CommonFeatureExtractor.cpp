@@ -1,4 +1,5 @@
 #include "CommonFeatureExtractor.h"
+#include "DGM/parallel.h"
 
 namespace DirectGraphicalModels { namespace fex
 {
@@ -24,7 +25,7 @@ CCommonFeatureExtractor CCommonFeatureExtractor::autoContrast(void) const
 	vec_mat_t vChannels;
 	split(m_img, vChannels);
 #ifdef ENABLE_PPL
-	concurrency::parallel_for_each(vChannels.begin(), vChannels.end(), [](Mat &c) {
+	parallel::parallel_for_each(vChannels.begin(), vChannels.end(), [](Mat &c) {
 #else
 	for (Mat &c : vChannels) {
 #endif
@@ -1,6 +1,7 @@
 #include "SparseCoding.h"
 #include "SparseDictionary.h"
 #include "LinearMapper.h"
+#include "DGM/parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels { namespace fex
@@ -36,7 +37,7 @@ vec_mat_t CSparseCoding::get_v(const Mat &img, const Mat &D, SqNeighbourhood nbh
 		res[w] = Mat(img.size(), CV_8UC1, cv::Scalar(0));
 
 #ifdef ENABLE_PPL
-	concurrency::parallel_for(0, dataHeight, 1, [&](int y) {
+	parallel::parallel_for(0, dataHeight, 1, [&](int y) {
 #else
 	for (int y = 0; y < dataHeight; y++) {
 #endif
@@ -121,7 +121,7 @@ Mat CSparseDictionary::TEST_decode(const Mat &X, cv::Size imgSize) const
 	Mat cover(imgSize, CV_32FC1, Scalar(0));
 
 #ifdef ENABLE_PPL
-	concurrency::parallel_for(0, dataHeight, blockSize, [&](int y) {
+	parallel::parallel_for(0, dataHeight, blockSize, [&](int y) {
 #else
 	for (int y = 0; y < dataHeight; y += blockSize) {
 #endif
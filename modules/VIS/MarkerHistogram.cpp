@@ -1,6 +1,7 @@
 #include "MarkerHistogram.h"
 #include "DGM/TrainNodeNaiveBayes.h"
 #include "DGM/IPDF.h"
+#include "DGM/parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels { namespace vis 
@@ -23,7 +24,7 @@ Mat	CMarkerHistogram::drawClassificationMap2D(float Z) const
 
 	if (nFeatures == 2) {
 #ifdef ENABLE_PPL
-		concurrency::parallel_for(0, 256, [&](int y) {
+		parallel::parallel_for(0, 256, [&](int y) {
 #else
 		for (int y = 0; y < 256; y++) {
 #endif
@@ -143,10 +143,93 @@ void testGraphPairwiseBuilding(IGraphPairwise& graph, byte nStates)
 			ASSERT_EQ(sqrtf(pIn[x]), pOut[x]);
 	}
 
+	// Test that the edges of one group do not affect each other
+	graph.getEdge(0, 1, pot);
+	ASSERT_EQ(0, pot.at<float>(0, 0));
+	graph.setEdgeGroup(n - 1, n, 0);
+	graph.getEdge(n - 1, n, pot);
+	ASSERT_EQ(1, pot.at<float>(0, 0));
+	graph.setEdges(0, Mat::ones(nStates, nStates, CV_32FC1) * 3);
+	graph.getEdge(n - 1, n, pot);
+	ASSERT_EQ(3, pot.at<float>(0, 0));
+	graph.getEdge(0, 1, pot);
+	ASSERT_EQ(3, pot.at<float>(0, 0));
+
 	// graph.marginalize(const vec_size_t &nodes);
 	// graph.setEdge(size_t srcNode, size_t dstNode, const Mat &pot);
 }
 
+// ======================================== IGraphPairwise Bulk Building ========================================
+void testGraphPairwiseBulkBuilding(IGraphPairwise& graph, byte nStates)
+{
+	// Build a random graph with edges (i) -> (i + 1) and (i + 1) -> (i) for even i
+	const int nNodes = random::u<int>(100, 1000);
+	Mat nodePots = random::U(Size(nStates, nNodes), CV_32FC1, 0.0, 100.0);
+	graph.addNodes(nodePots);
+	ASSERT_EQ(nNodes, graph.getNumNodes());
+
+	const int nEdges = nNodes - 1 + nNodes / 2;
+	Mat srcDst(nEdges, 2, CV_32SC1);
+	Mat groups(nEdges, 1, CV_8UC1);
+	Mat edgePots = random::U(Size(nStates * nStates, nEdges), CV_32FC1, 0.0, 100.0);
+	int e = 0;
+	for (int i = 0; i < nNodes - 1; i++) {
+		srcDst.at<int>(e, 0) = i;
+		srcDst.at<int>(e, 1) = i + 1;
+		groups.at<byte>(e++, 0) = static_cast<byte>(i % 7);
+		if (i % 2 == 0) {
+			srcDst.at<int>(e, 0) = i + 1;
+			srcDst.at<int>(e, 1) = i;
+			groups.at<byte>(e++, 0) = static_cast<byte>(i % 5);
+		}
+	}
+	ASSERT_EQ(nEdges, e);
+	graph.addEdges(srcDst, groups, edgePots, true);
+	ASSERT_EQ(nEdges, graph.getNumEdges());
+
+	Mat pot;
+	for (int n = 0; n < nNodes; n++) {
+		graph.getNode(n, pot);
+		for (byte s = 0; s < nStates; s++)
+			ASSERT_EQ(nodePots.at<float>(n, s), pot.at<float>(s, 0));
+	}
+	for (e = 0; e < nEdges; e++) {
+		size_t src = srcDst.at<int>(e, 0);
+		size_t dst = srcDst.at<int>(e, 1);
+		ASSERT_TRUE(graph.isEdgeExists(src, dst));
+		ASSERT_EQ(groups.at<byte>(e, 0), graph.getEdgeGroup(src, dst));
+		graph.getEdge(src, dst, pot);
+		for (byte y = 0; y < nStates; y++)
+			for (byte x = 0; x < nStates; x++)
+				ASSERT_EQ(edgePots.at<float>(e, y * nStates + x), pot.at<float>(y, x));
+	}
+
+	// Add more edges without potentials
+	srcDst = Mat(1, 2, CV_32SC1);
+	srcDst.at<int>(0, 0) = 0;
+	srcDst.at<int>(0, 1) = nNodes - 1;
+	graph.addEdges(srcDst);
+	ASSERT_EQ(nEdges + 1, graph.getNumEdges());
+	ASSERT_EQ(0, graph.getEdgeGroup(0, nNodes - 1));
+	vec_size_t vNodes;
+	graph.getChildNodes(0, vNodes);
+	ASSERT_EQ(2, vNodes.size());
+}
+
+TEST_F(CTestGraph, IGP_pairwise_bulk_building)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 16));
+	CGraphPairwise graph(nStates);
+	testGraphPairwiseBulkBuilding(graph, nStates);
+}
+
+TEST_F(CTestGraph, IGP_weiss_bulk_building)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 16));
+	CGraphWeiss graph(nStates);
+	testGraphPairwiseBulkBuilding(graph, nStates);
+}
+
 TEST_F(CTestGraph, IGP_pairwise_building)
 {
 	const byte nStates = static_cast<byte>(random::u(10, 255));
@@ -154,6 +237,58 @@ TEST_F(CTestGraph, IGP_pairwise_building)
 	testGraphPairwiseBuilding(graph, nStates);
 }
 
+TEST_F(CTestGraph, IGP_pairwise_indexed_building)
+{
+	const byte nStates = static_cast<byte>(random::u(10, 255));
+	CGraphPairwise graph(nStates);
+	graph.enableEdgeIndex();
+	testGraphPairwiseBuilding(graph, nStates);
+}
+
+TEST_F(CTestGraph, IGP_pairwise_compact)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 16));
+	const size_t nNodes = random::u<size_t>(100, 1000);
+	CGraphPairwise graph(nStates);
+	for (size_t i = 0; i < nNodes; i++) graph.addNode();
+	for (size_t i = 1; i < nNodes; i++) {
+		Mat pot(nStates, nStates, CV_32FC1, Scalar(static_cast<float>(i)));
+		graph.addArc(i - 1, i, static_cast<byte>(i % 3), pot.mul(pot));
+	}
+	
+	// Remove every third arc
+	size_t nEdges = graph.getNumEdges();
+	for (size_t i = 3; i < nNodes; i += 3) {
+		graph.removeArc(i - 1, i);
+		nEdges -= 2;
+	}
+	graph.compact();
+	ASSERT_EQ(nEdges, graph.getNumEdges());
+
+	Mat pot;
+	vec_size_t vNodes;
+	for (size_t i = 1; i < nNodes; i++) {
+		if (i % 3 == 0) {
+			ASSERT_FALSE(graph.isEdgeExists(i - 1, i));
+			ASSERT_FALSE(graph.isEdgeExists(i, i - 1));
+			continue;
+		}
+		ASSERT_TRUE(graph.isArcExists(i - 1, i));
+		ASSERT_EQ(i % 3, graph.getEdgeGroup(i, i - 1));
+		graph.getEdge(i - 1, i, pot);
+		ASSERT_EQ(static_cast<float>(i), pot.at<float>(0, 0));
+		graph.getChildNodes(i - 1, vNodes);
+		ASSERT_TRUE(std::find(vNodes.begin(), vNodes.end(), i) != vNodes.end());
+		graph.getParentNodes(i - 1, vNodes);
+		ASSERT_TRUE(std::find(vNodes.begin(), vNodes.end(), i) != vNodes.end());
+	}
+
+	// The graph remains modifiable
+	graph.addArc(2, 3);
+	ASSERT_EQ(nEdges + 2, graph.getNumEdges());
+	ASSERT_TRUE(graph.isArcExists(2, 3));
+}
+
 TEST_F(CTestGraph, IGP_weiss_building)
 {
 	const byte nStates = static_cast<byte>(random::u(10, 255));
@@ -202,6 +337,47 @@ TEST_F(CTestGraph, CG_dense_extension)
 	testGraphExtension(graphExt, graph);
 }
 
+TEST_F(CTestGraph, CG_dense_gaussian_lattice)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 10));
+	const Size graphSize = Size(random::u<int>(10, 40), random::u<int>(10, 40));
+	const Vec2f sigma(2.0f, 3.0f);
+	CGraphDense	graph(nStates);
+	CGraphDenseExt graphExt(graph);
+
+	// Edge model, built from scratch
+	auto applyReference = [&](Size size, float weight, const Mat &src, Mat &dst) {
+		Mat features(size.width * size.height, 2, CV_32FC1);
+		for (int y = 0; y < size.height; y++)
+			for (int x = 0; x < size.width; x++) {
+				features.at<float>(y * size.width + x, 0) = x / sigma.val[0];
+				features.at<float>(y * size.width + x, 1) = y / sigma.val[1];
+			}
+		CEdgeModelPotts(features, weight).apply(src, dst);
+	};
+	auto assertEqual = [](const Mat &a, const Mat &b) {
+		ASSERT_EQ(a.size(), b.size());
+		for (int y = 0; y < a.rows; y++)
+			for (int x = 0; x < a.cols; x++)
+				ASSERT_EQ(a.at<float>(y, x), b.at<float>(y, x));
+	};
+
+	// The lattice is re-used for the images of the same size, and rebuilt when the size changes
+	const Size newSize = Size(graphSize.width + 1, graphSize.height);
+	for (Size size : { graphSize, graphSize, newSize, newSize }) {
+		const float weight = random::u(1, 10) * 0.5f;
+		graphExt.buildGraph(size);
+		graphExt.addGaussianEdgeModel(sigma, weight);
+		ASSERT_EQ(1u, graph.getEdgeModels().size());
+
+		Mat src = random::U(Size(nStates, size.width * size.height), CV_32FC1, 0.0, 1.0);
+		Mat dst, test_dst;
+		graph.getEdgeModels()[0]->apply(src, dst);
+		applyReference(size, weight, src, test_dst);
+		assertEqual(dst, test_dst);
+	}
+}
+
 TEST_F(CTestGraph, CG_pairwise_extension)
 {
 	const byte nStates = static_cast<byte>(random::u(10, 255));
@@ -210,6 +386,83 @@ TEST_F(CTestGraph, CG_pairwise_extension)
 	testGraphExtension(graphExt, graph);
 }
 
+TEST_F(CTestGraph, CG_grid_extension)
+{
+	const byte nStates = static_cast<byte>(random::u(10, 255));
+	CGraphGrid graph(nStates);
+	CGraphPairwiseExt graphExt(graph);
+	testGraphExtension(graphExt, graph);
+}
+
+TEST_F(CTestGraph, CG_grid_layered)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 16));
+	const byte nLayers = static_cast<byte>(random::u(1, 4));
+	const byte gType = GRAPH_EDGES_GRID | GRAPH_EDGES_DIAG | GRAPH_EDGES_LINK;
+	const Size graphSize = Size(random::u<int>(1, 30), random::u<int>(1, 30));
+
+	CGraphPairwise graph(nStates);
+	CGraphLayeredExt graphExt(graph, nLayers, gType);
+	graphExt.buildGraph(graphSize);
+
+	CGraphGrid gridGraph(nStates);
+	CGraphLayeredExt gridGraphExt(gridGraph, nLayers, gType);
+	gridGraphExt.buildGraph(graphSize);
+	ASSERT_EQ(graphSize, gridGraph.getSize());
+	ASSERT_EQ(nLayers, gridGraph.getNumLayers());
+	ASSERT_EQ(gType, gridGraph.getType());
+
+	// The grid graph must have exactly the same structure
+	ASSERT_EQ(graph.getNumNodes(), gridGraph.getNumNodes());
+	ASSERT_EQ(graph.getNumEdges(), gridGraph.getNumEdges());
+	vec_size_t vNodes, vGridNodes;
+	for (size_t n = 0; n < graph.getNumNodes(); n++) {
+		graph.getChildNodes(n, vNodes);
+		gridGraph.getChildNodes(n, vGridNodes);
+		ASSERT_EQ(vNodes, vGridNodes);
+		for (size_t c : vNodes) 
+			ASSERT_EQ(graph.getEdgeGroup(n, c), gridGraph.getEdgeGroup(n, c));
+		graph.getParentNodes(n, vNodes);
+		gridGraph.getParentNodes(n, vGridNodes);
+		ASSERT_EQ(vNodes, vGridNodes);
+	}
+
+	// Every edge must be found at its own index: no two edges may share a potential
+	float val = 0;
+	for (size_t n = 0; n < gridGraph.getNumNodes(); n++) {
+		gridGraph.getChildNodes(n, vGridNodes);
+		for (size_t c : vGridNodes) gridGraph.setEdge(n, c, Mat(nStates, nStates, CV_32FC1, Scalar(++val)));
+	}
+	ASSERT_EQ(static_cast<float>(gridGraph.getNumEdges()), val);
+	val = 0;
+	for (size_t n = 0; n < gridGraph.getNumNodes(); n++) {
+		gridGraph.getChildNodes(n, vGridNodes);
+		for (size_t c : vGridNodes) {
+			Mat pot;
+			gridGraph.getEdge(n, c, pot);
+			ASSERT_EQ(++val, pot.at<float>(0, 0));
+		}
+	}
+
+	// Edge potentials
+	gridGraph.setEdges(std::nullopt, Mat::ones(nStates, nStates, CV_32FC1));
+	size_t n = random::u<size_t>(0, gridGraph.getNumNodes() - 1);
+	gridGraph.getChildNodes(n, vGridNodes);
+	for (size_t c : vGridNodes) {
+		Mat pot_in = random::U(Size(nStates, nStates), CV_32FC1, 0.0, 100.0);
+		Mat pot_out;
+		gridGraph.setEdge(n, c, pot_in);
+		gridGraph.getEdge(n, c, pot_out);
+		for (int y = 0; y < nStates; y++)
+			for (int x = 0; x < nStates; x++)
+				ASSERT_EQ(pot_in.at<float>(y, x), pot_out.at<float>(y, x));
+		if (gridGraph.isEdgeArc(n, c)) {
+			gridGraph.getEdge(c, n, pot_out);
+			ASSERT_EQ(1.0f, pot_out.at<float>(0, 0));
+		}
+	}
+}
+
 TEST_F(CTestGraph, CG_pairwise_layered) 
 {
 	const byte nStatesBase = static_cast<byte>(random::u(5, 127));
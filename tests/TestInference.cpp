@@ -1,4 +1,5 @@
 #include "TestInference.h"
+#include "DGM/random.h"
 
 void buildGraph(IGraphPairwise& graph, size_t nNodes)
 {
@@ -70,6 +71,42 @@ TEST_F(CTestInference, inference_chain)
 	testInferer(inferer);
 }
 
+TEST_F(CTestInference, inference_chain_batch)
+{
+	const byte nStates	= 3;
+	const int  nChains	= 11;
+	const int  length	= 5;
+	Mat pots = random::U(Size(length * nStates, nChains), CV_32FC1, 0.1, 1.0);
+	Mat edgePot = random::U(Size(nStates, nStates), CV_32FC1, 0.1, 1.0);
+
+	CInferChainBatch inferer(nStates);
+	inferer.setEdgePot(edgePot);
+	Mat states	  = inferer.decode(pots);
+	Mat marginals = pots.clone();
+	inferer.infer(marginals);
+	ASSERT_EQ(states.rows, nChains);
+	ASSERT_EQ(states.cols, length);
+
+	for (int c = 0; c < nChains; c++) {
+		CGraphPairwise graph(nStates);
+		for (int t = 0; t < length; t++) {
+			graph.addNode(pots.row(c).colRange(t * nStates, (t + 1) * nStates).t());
+			if (t > 0) graph.addEdge(t - 1, t, 0, edgePot);
+		}
+		vec_byte_t decoding = CDecodeExact(graph).decode();
+		for (int t = 0; t < length; t++)
+			ASSERT_EQ(states.at<byte>(c, t), decoding[t]);
+		
+		CInferExact exactInferer(graph);
+		exactInferer.infer();
+		for (byte s = 0; s < nStates; s++) {
+			vec_float_t potExact = exactInferer.getPotentials(s);
+			for (int t = 0; t < length; t++)
+				ASSERT_NEAR(marginals.at<float>(c, t * nStates + s), potExact[t], 1e-5);
+		}
+	}
+}
+
 TEST_F(CTestInference, inference_tree)
 {
 	CGraphPairwise graph(m_nStates);
@@ -80,6 +117,81 @@ TEST_F(CTestInference, inference_tree)
 	testInferer(inferer);
 }
 
+TEST_F(CTestInference, inference_tree_forest)
+{
+	// A forest of 3 random trees and an isolated node
+	const byte nStates = 2;
+	CGraphPairwise graph(nStates);
+	CGraphPairwise graphExact(nStates);
+	for (size_t n = 0; n < 13; n++) {
+		Mat nodePot = random::U(Size(1, nStates), CV_32FC1, 0.1, 1.0);
+		graph.addNode(nodePot);
+		graphExact.addNode(nodePot);
+		if (n % 4 != 0 && n != 12) {
+			size_t parent = n - 1 - random::u<size_t>(0, n % 4 - 1);
+			Mat edgePot = random::U(Size(nStates, nStates), CV_32FC1, 0.1, 1.0);
+			graph.addArc(n, parent, edgePot);
+			graphExact.addArc(n, parent, edgePot);
+		}
+	}
+
+	CInferTree inferer(graph);
+	inferer.infer();
+	CInferExact exactInferer(graphExact);
+	exactInferer.infer();
+	for (byte s = 0; s < nStates; s++) {
+		vec_float_t pot		 = inferer.getPotentials(s);
+		vec_float_t potExact = exactInferer.getPotentials(s);
+		for (size_t n = 0; n < pot.size(); n++)
+			ASSERT_NEAR(pot[n], potExact[n], 1e-5);
+	}
+}
+
+TEST_F(CTestInference, inference_junction_tree)
+{
+	const byte nStates = 3;
+	for (byte gType : { static_cast<byte>(GRAPH_EDGES_GRID), static_cast<byte>(GRAPH_EDGES_GRID | GRAPH_EDGES_DIAG) }) {
+		CGraphGrid graph(nStates);
+		CGraphGrid graphExact(nStates);
+		graph.build(Size(6, 2), 1, gType);														// a ladder
+		graphExact.build(Size(6, 2), 1, gType);
+		for (size_t n = 0; n < graph.getNumNodes(); n++) {
+			Mat nodePot = random::U(Size(1, nStates), CV_32FC1, 0.1, 1.0);
+			graph.setNode(n, nodePot);
+			graphExact.setNode(n, nodePot);
+		}
+		Mat edgePot = random::U(Size(nStates, nStates), CV_32FC1, 0.1, 1.0);
+		graph.setEdges(std::nullopt, edgePot);
+		graphExact.setEdges(std::nullopt, edgePot);
+		graph.setEdge(1, 0, random::U(Size(nStates, nStates), CV_32FC1, 0.1, 1.0));				// one individual potential
+		Mat pot;
+		graph.getEdge(1, 0, pot);
+		graphExact.setEdge(1, 0, pot);
+
+		vec_byte_t decoding = CDecodeExact(graphExact).decode();
+		std::vector<Mat> vNodePots(graph.getNumNodes());
+		for (size_t n = 0; n < graph.getNumNodes(); n++) graph.getNode(n, vNodePots[n]);
+		CInferExact exactInferer(graphExact);
+		exactInferer.infer();
+
+		CInferJunctionTree inferer(graph);
+		inferer.infer();
+		for (byte s = 0; s < nStates; s++) {
+			vec_float_t pot		 = inferer.getPotentials(s);
+			vec_float_t potExact = exactInferer.getPotentials(s);
+			for (size_t n = 0; n < pot.size(); n++)
+				ASSERT_NEAR(pot[n], potExact[n], 1e-5);
+		}
+
+		// The max-product inference of the original potentials gives the most probable configuration
+		for (size_t n = 0; n < graph.getNumNodes(); n++) graph.setNode(n, vNodePots[n]);
+		CInferJunctionTree maxInferer(graph);
+		maxInferer.setMaxSum(true);
+		maxInferer.infer();
+		ASSERT_EQ(maxInferer.decode(), decoding);
+	}
+}
+
 TEST_F(CTestInference, inference_LBP)
 {
 	CGraphPairwise graph(m_nStates);
@@ -90,6 +202,456 @@ TEST_F(CTestInference, inference_LBP)
 	testInferer(inferer);
 }
 
+TEST_F(CTestInference, inference_LBP_grid)
+{
+	CGraphGrid graph(m_nStates);
+	graph.build(Size(static_cast<int>(m_nNodes), 1));			// a chain is a grid of height 1
+	fillGraph(graph);
+
+	CInferLBP inferer(graph);
+	testInferer(inferer);
+}
+
+TEST_F(CTestInference, inference_log_domain)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	
+	fillGraph(graph);
+	CInferChain chainInferer(graph);
+	chainInferer.setLogDomain(true);
+	testInferer(chainInferer);
+
+	fillGraph(graph);
+	CInferTree treeInferer(graph);
+	treeInferer.setLogDomain(true);
+	testInferer(treeInferer);
+
+	fillGraph(graph);
+	CInferLBP lbpInferer(graph);
+	lbpInferer.setLogDomain(true);
+	testInferer(lbpInferer);
+
+	// Max-product decoding must not depend on the domain
+	fillGraph(graph);
+	CInferViterbi viterbiInferer(graph);
+	vec_byte_t decoding = viterbiInferer.decode(100);
+	fillGraph(graph);
+	viterbiInferer.setLogDomain(true);
+	ASSERT_EQ(viterbiInferer.decode(100), decoding);
+
+	fillGraph(graph);
+	CInferTRW trwInferer(graph);
+	decoding = trwInferer.decode(10);
+	fillGraph(graph);
+	trwInferer.setLogDomain(true);
+	ASSERT_EQ(trwInferer.decode(10), decoding);
+}
+
+TEST_F(CTestInference, inference_log_domain_underflow)
+{
+	// A long chain with tiny potentials underflows the single precision in the probability domain
+	const size_t nNodes = 2000;
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, nNodes);
+	fillGraph(graph);
+	Mat edgePot(m_nStates, m_nStates, CV_32FC1, Scalar(1e-20f));
+	edgePot.at<float>(0, 0) = edgePot.at<float>(1, 1) = 1e-19f;
+	graph.setEdges(std::nullopt, edgePot);
+
+	CInferChain inferer(graph);
+	inferer.setLogDomain(true);
+	inferer.infer();
+	for (size_t n = 0; n < nNodes; n++) {
+		Mat pot;
+		graph.getNode(n, pot);
+		ASSERT_FALSE(std::isnan(pot.at<float>(0, 0)));
+		ASSERT_NEAR(pot.at<float>(0, 0) + pot.at<float>(1, 0), 1.0f, 1e-5);
+	}
+}
+
+TEST_F(CTestInference, inference_parametric_edges)
+{
+	// O(nStates) messages for the Potts and truncated edge potentials must match the exact inference
+	const byte	 nStates = 5;
+	const size_t nNodes	 = 6;
+	CGraphPairwise graph(nStates);
+	buildGraph(graph, nNodes);
+	
+	auto fillNodes = [&]() {
+		for (size_t n = 0; n < nNodes; n++) {
+			Mat nodePot(nStates, 1, CV_32FC1);
+			for (byte s = 0; s < nStates; s++) nodePot.at<float>(s, 0) = static_cast<float>((n * 7 + s * 3) % 11 + 1);
+			graph.setNode(n, nodePot);
+		}
+	};
+	
+	for (EdgePotModel model : { EdgePotModel::Potts, EdgePotModel::truncatedLinear, EdgePotModel::truncatedQuadratic }) {
+		fillNodes();
+		graph.setEdges(std::nullopt, model, 0.5f, 1.2f);
+		Mat pot;
+		graph.getEdge(0, 1, pot);
+		ASSERT_FLOAT_EQ(pot.at<float>(0, 0), 1.0f);
+		const float energy = model == EdgePotModel::Potts ? 0.5f : model == EdgePotModel::truncatedLinear ? 1.0f : 1.2f;
+		ASSERT_FLOAT_EQ(pot.at<float>(0, 2), expf(-energy));
+		
+		CDecodeExact exactDecoder(graph);
+		vec_byte_t exactDecoding = exactDecoder.decode();
+		CInferExact exactInferer(graph);
+		exactInferer.infer();
+		vec_float_t exactPot = exactInferer.getPotentials(1);
+
+		for (bool logDomain : { false, true }) {
+			fillNodes();
+			CInferViterbi viterbiInferer(graph);
+			viterbiInferer.setLogDomain(logDomain);
+			ASSERT_EQ(viterbiInferer.decode(10), exactDecoding);
+
+			fillNodes();
+			CInferLBP lbpInferer(graph);
+			lbpInferer.setLogDomain(logDomain);
+			lbpInferer.infer(10);
+			vec_float_t pot = lbpInferer.getPotentials(1);
+			for (size_t n = 0; n < nNodes; n++) ASSERT_NEAR(pot[n], exactPot[n], 1e-5);
+
+			// TRW does not square the edge potentials
+			fillNodes();
+			graph.setEdges(std::nullopt, model, 1.0f, 2.4f);
+			CInferTRW trwInferer(graph);
+			trwInferer.setLogDomain(logDomain);
+			ASSERT_EQ(trwInferer.decode(10), exactDecoding);
+			graph.setEdges(std::nullopt, model, 0.5f, 1.2f);
+		}
+	}
+}
+
+TEST_F(CTestInference, inference_convergence)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	
+	// On a chain the messages converge after the number of iterations, equal to its length
+	for (bool logDomain : { false, true }) {
+		fillGraph(graph);
+		CInferLBP lbpInferer(graph);
+		lbpInferer.setLogDomain(logDomain);
+		lbpInferer.setTolerance(1e-6f);
+		ASSERT_FLOAT_EQ(lbpInferer.getTolerance(), 1e-6f);
+		testInferer(lbpInferer);
+		ASSERT_LE(lbpInferer.getNumIterations(), m_nNodes + 1);
+		ASSERT_GE(lbpInferer.getNumIterations(), 1u);
+
+		fillGraph(graph);
+		CInferTRW trwInferer(graph);
+		vec_byte_t decoding = trwInferer.decode(100);
+		ASSERT_EQ(trwInferer.getNumIterations(), 100u);
+		fillGraph(graph);
+		trwInferer.setLogDomain(logDomain);
+		trwInferer.setTolerance(1e-6f);
+		ASSERT_EQ(trwInferer.decode(100), decoding);
+		ASSERT_LT(trwInferer.getNumIterations(), 100u);
+	}
+}
+
+TEST_F(CTestInference, inference_residual_BP)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	
+	for (bool logDomain : { false, true }) {
+		fillGraph(graph);
+		CInferResidualBP inferer(graph);
+		inferer.setLogDomain(logDomain);
+		testInferer(inferer);
+		ASSERT_LE(inferer.getNumIterations(), 100u);
+	}
+
+	// On a loopy grid residual BP must converge to the same fixed point as LBP
+	CGraphGrid grid(m_nStates);
+	grid.build(Size(5, 4));
+	fillGraph(grid);
+	CInferLBP lbpInferer(grid);
+	lbpInferer.infer(200);
+	fillGraph(grid);
+	CInferResidualBP rbpInferer(grid);
+	rbpInferer.setTolerance(1e-7f);
+	rbpInferer.infer(200);
+	for (byte s = 0; s < m_nStates; s++) {
+		vec_float_t potLBP = lbpInferer.getPotentials(s);
+		vec_float_t potRBP = rbpInferer.getPotentials(s);
+		ASSERT_EQ(potLBP.size(), potRBP.size());
+		for (size_t n = 0; n < potLBP.size(); n++)
+			ASSERT_NEAR(potLBP[n], potRBP[n], 1e-4);
+	}
+}
+
+TEST_F(CTestInference, inference_red_black_BP)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	
+	for (bool logDomain : { false, true }) {
+		fillGraph(graph);
+		CInferRedBlackBP inferer(graph);
+		inferer.setLogDomain(logDomain);
+		testInferer(inferer);
+	}
+
+	// On loopy grids red-black BP must converge to the same fixed point as LBP, but in less iterations
+	for (byte gType : { static_cast<byte>(GRAPH_EDGES_GRID), static_cast<byte>(GRAPH_EDGES_GRID | GRAPH_EDGES_DIAG) }) {
+		CGraphGrid grid(m_nStates);
+		grid.build(Size(7, 5), 1, gType);
+		fillGraph(grid);
+		CInferLBP lbpInferer(grid);
+		lbpInferer.setTolerance(1e-7f);
+		lbpInferer.infer(500);
+		fillGraph(grid);
+		CInferRedBlackBP rbInferer(grid);
+		rbInferer.setTolerance(1e-7f);
+		rbInferer.infer(500);
+		ASSERT_LT(rbInferer.getNumIterations(), lbpInferer.getNumIterations());
+		for (byte s = 0; s < m_nStates; s++) {
+			vec_float_t potLBP = lbpInferer.getPotentials(s);
+			vec_float_t potRB  = rbInferer.getPotentials(s);
+			ASSERT_EQ(potLBP.size(), potRB.size());
+			for (size_t n = 0; n < potLBP.size(); n++)
+				ASSERT_NEAR(potLBP[n], potRB[n], 1e-4);
+		}
+	}
+}
+
+TEST_F(CTestInference, inference_multi_scale_BP)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	
+	for (bool logDomain : { false, true }) {
+		fillGraph(graph);
+		CInferMultiScaleBP inferer(graph, 3);
+		inferer.setSize(Size(static_cast<int>(m_nNodes), 1));			// a chain is a grid of height 1
+		inferer.setLogDomain(logDomain);
+		testInferer(inferer);
+	}
+
+	// Evidence at the left border of a homogeneous grid must reach the right border within a few iterations
+	const int	size = 64;
+	CGraphGrid	grid(m_nStates);
+	grid.build(Size(size, size));
+	Mat nodePot(m_nStates, 1, CV_32FC1, Scalar(0.5f));
+	Mat evidencePot(m_nStates, 1, CV_32FC1, Scalar(0.1f));
+	evidencePot.at<float>(1, 0) = 0.9f;
+	Mat edgePot(m_nStates, m_nStates, CV_32FC1, Scalar(1.0f));
+	for (byte s = 0; s < m_nStates; s++) edgePot.at<float>(s, s) = 2.0f;
+	auto fillGrid = [&]() {
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+				grid.setNode(grid.getNodeIdx(x, y), x == 0 ? evidencePot : nodePot);
+		grid.setEdges(std::nullopt, edgePot);
+	};
+
+	fillGrid();
+	CInferLBP lbpInferer(grid);
+	lbpInferer.infer(10);
+	vec_float_t potLBP = lbpInferer.getPotentials(1);
+
+	fillGrid();
+	CInferMultiScaleBP msInferer(grid);
+	msInferer.infer(10);
+	ASSERT_EQ(msInferer.getNumIterations(), 10u);
+	vec_float_t potMS = msInferer.getPotentials(1);
+
+	const size_t farNode = grid.getNodeIdx(size - 1, size / 2);
+	ASSERT_LT(potLBP[farNode], 0.51f);
+	ASSERT_GT(potMS[farNode], 0.9f);
+}
+
+TEST_F(CTestInference, inference_graph_cut)
+{
+	// For 2 states the alpha-expansion is exact
+	CGraphGrid graph(2);
+	graph.build(Size(4, 3));
+	for (int t = 0; t < 5; t++) {
+		for (size_t n = 0; n < graph.getNumNodes(); n++)
+			graph.setNode(n, random::U(Size(1, 2), CV_32FC1, 0.1, 1.0));
+		Mat edgePot(2, 2, CV_32FC1, Scalar(1.0f));
+		edgePot.at<float>(0, 0) = edgePot.at<float>(1, 1) = random::U<float>(1.0f, 3.0f);
+		graph.setEdges(std::nullopt, edgePot);
+
+		vec_byte_t exact = CDecodeExact(graph).decode();
+		CInferGraphCut inferer(graph);
+		ASSERT_EQ(inferer.decode(10), exact);
+		ASSERT_LE(inferer.getNumIterations(), 10u);
+
+		// Without the re-use of the networks
+		inferer.setMaxMemory(0);
+		ASSERT_EQ(inferer.decode(10), exact);
+	}
+}
+
+TEST_F(CTestInference, decode_ICM)
+{
+	CGraphGrid graph(3);
+	graph.build(Size(8, 6));
+	for (size_t n = 0; n < graph.getNumNodes(); n++)
+		graph.setNode(n, random::U(Size(1, 3), CV_32FC1, 0.1, 1.0));
+	Mat edgePot(3, 3, CV_32FC1, Scalar(1.0f));
+	for (byte s = 0; s < 3; s++) edgePot.at<float>(s, s) = 3.0f;
+	graph.setEdges(std::nullopt, edgePot);
+
+	// Logarithm of the joint probability of the configuration
+	auto getLogProb = [&graph](const vec_byte_t &state) {
+		double res = 0;
+		Mat pot;
+		vec_size_t vChilds;
+		for (size_t n = 0; n < graph.getNumNodes(); n++) {
+			graph.getNode(n, pot);
+			res += log(pot.at<float>(state[n], 0));
+			graph.getChildNodes(n, vChilds);
+			for (size_t c : vChilds) {
+				graph.getEdge(n, c, pot);
+				res += log(pot.at<float>(state[n], state[c]));
+			}
+		}
+		return res;
+	};
+
+	vec_byte_t init  = CDecode::decode(graph);
+	vec_byte_t state = CDecodeICM(graph, 100).decode();
+	ASSERT_GE(getLogProb(state), getLogProb(init));
+
+	// The result is a local maximum: no single node may improve it
+	const double logProb = getLogProb(state);
+	for (size_t n = 0; n < graph.getNumNodes(); n++)
+		for (byte s = 0; s < 3; s++) {
+			vec_byte_t neighbor = state;
+			neighbor[n] = s;
+			ASSERT_LE(getLogProb(neighbor), logProb + 1e-6);
+		}
+
+	// Warm start from the local maximum does not change it
+	ASSERT_EQ(CDecodeICM(graph).decode(state, 100), state);
+
+	CInferICM inferer(graph);
+	ASSERT_EQ(inferer.decode(100), state);
+	ASSERT_GE(inferer.getNumIterations(), 1u);
+	ASSERT_LT(inferer.getNumIterations(), 100u);
+
+	// The node potentials are set to the found configuration, thus a single sweep is needed to confirm it
+	inferer.infer(100);
+	ASSERT_EQ(inferer.getNumIterations(), 1u);
+}
+
+TEST_F(CTestInference, inference_mean_field)
+{
+	const byte nStates = 3;
+	CGraphGrid graph(nStates);
+	graph.build(Size(7, 5));
+	for (size_t n = 0; n < graph.getNumNodes(); n++)
+		graph.setNode(n, random::U(Size(1, nStates), CV_32FC1, 0.1, 1.0));
+	std::vector<Mat> vNodePots(graph.getNumNodes());
+	for (size_t n = 0; n < graph.getNumNodes(); n++) graph.getNode(n, vNodePots[n]);
+
+	// Without edge potentials the marginals are the normalized node potentials
+	CInferMeanField inferer(graph);
+	inferer.infer(10);
+	ASSERT_EQ(inferer.getNumIterations(), 10u);
+	for (size_t n = 0; n < graph.getNumNodes(); n++) {
+		Mat pot;
+		graph.getNode(n, pot);
+		for (byte s = 0; s < nStates; s++)
+			ASSERT_NEAR(pot.at<float>(s, 0), vNodePots[n].at<float>(s, 0) / sum(vNodePots[n])[0], 1e-6);
+		graph.setNode(n, vNodePots[n]);
+	}
+
+	// Potts potentials for all edges and arbitrary potentials for a few of them
+	Mat edgePot(nStates, nStates, CV_32FC1, Scalar(1.0f));
+	for (byte s = 0; s < nStates; s++) edgePot.at<float>(s, s) = 4.0f;
+	graph.setEdges(std::nullopt, edgePot);
+	for (size_t n = 1; n < graph.getNumNodes(); n += 3)
+		if (n % 7 != 0) graph.setEdge(n, n - 1, random::U(Size(nStates, nStates), CV_32FC1, 0.1, 1.0));
+
+	inferer.setDamping(0.5f);
+	inferer.setTolerance(1e-9f);
+	inferer.infer(1000);
+	ASSERT_LT(inferer.getNumIterations(), 1000u);
+
+	// The marginals satisfy the mean-field equations
+	std::vector<Mat> vQ(graph.getNumNodes());
+	for (size_t n = 0; n < graph.getNumNodes(); n++) graph.getNode(n, vQ[n]);
+	vec_size_t vChilds, vParents;
+	for (size_t n = 0; n < graph.getNumNodes(); n++) {
+		Mat energy;
+		log(vNodePots[n], energy);
+		Mat pot, logPot;
+		graph.getChildNodes(n, vChilds);
+		for (size_t c : vChilds) {
+			graph.getEdge(n, c, pot);
+			log(pot, logPot);
+			energy += logPot * vQ[c];
+		}
+		graph.getParentNodes(n, vParents);
+		for (size_t p : vParents) {
+			graph.getEdge(p, n, pot);
+			log(pot, logPot);
+			energy += logPot.t() * vQ[p];
+		}
+		double max;
+		minMaxLoc(energy, NULL, &max);
+		exp(energy - max, energy);
+		energy /= sum(energy)[0];
+		for (byte s = 0; s < nStates; s++)
+			ASSERT_NEAR(vQ[n].at<float>(s, 0), energy.at<float>(s, 0), 1e-3);
+	}
+}
+
+TEST_F(CTestInference, inference_exact_enumeration)
+{
+	const byte nStates = 3;
+	CGraphGrid graph(nStates);
+	graph.build(Size(3, 3), 1, GRAPH_EDGES_GRID | GRAPH_EDGES_DIAG);
+	for (size_t n = 0; n < graph.getNumNodes(); n++)
+		graph.setNode(n, random::U(Size(1, nStates), CV_32FC1, 0.1, 1.0));
+	Mat edgePot = random::U(Size(nStates, nStates), CV_32FC1, 0.1, 1.0);
+	edgePot.at<float>(1, 2) = 0.0f;												// forbidden pair of states
+	graph.setEdges(std::nullopt, edgePot);
+
+	// Brute-force enumeration of all configurations
+	const size_t nNodes = graph.getNumNodes();
+	std::vector<Mat> vNodePots(nNodes);
+	for (size_t n = 0; n < nNodes; n++) graph.getNode(n, vNodePots[n]);
+	std::vector<std::vector<double>> vvMarginals(nNodes, std::vector<double>(nStates, 0.0));
+	vec_byte_t state(nNodes, 0), bestState;
+	double bestP = -1;
+	vec_size_t vChilds;
+	for (size_t c = 0; c < static_cast<size_t>(pow(nStates, nNodes)); c++) {
+		for (size_t n = 0, k = c; n < nNodes; n++, k /= nStates) state[n] = k % nStates;
+		double p = 1;
+		for (size_t n = 0; n < nNodes; n++) {
+			p *= vNodePots[n].at<float>(state[n], 0);
+			graph.getChildNodes(n, vChilds);
+			for (size_t child : vChilds) p *= edgePot.at<float>(state[n], state[child]);
+		}
+		if (p > bestP) {
+			bestP	  = p;
+			bestState = state;
+		}
+		for (size_t n = 0; n < nNodes; n++) vvMarginals[n][state[n]] += p;
+	}
+
+	ASSERT_EQ(CDecodeExact(graph).decode(), bestState);
+	
+	CInferExact inferer(graph);
+	inferer.infer();
+	for (byte s = 0; s < nStates; s++) {
+		vec_float_t pot = inferer.getPotentials(s);
+		for (size_t n = 0; n < nNodes; n++) {
+			double Z = 0;
+			for (double m : vvMarginals[n]) Z += m;
+			ASSERT_NEAR(pot[n], vvMarginals[n][s] / Z, 1e-5);
+		}
+	}
+}
+
 TEST_F(CTestInference, inference_exact_weiss)
 {
 	CGraphWeiss graph(m_nStates);
@@ -99,3 +661,63 @@ TEST_F(CTestInference, inference_exact_weiss)
 	CInferExact inferer(graph);
 	testInferer(inferer);
 }
+
+TEST_F(CTestInference, inference_dense)
+{
+	const byte nStates	= static_cast<byte>(random::u(2, 6));
+	const Size size		= Size(random::u<int>(8, 20), random::u<int>(8, 20));
+	const int  nNodes	= size.width * size.height;
+	const unsigned int nIt = 5;
+
+	CGraphDense graph(nStates);
+	CGraphDenseExt graphExt(graph);
+	graphExt.buildGraph(size);
+	Mat nodePots = graph.getNodePotentials();						// shares the data with the graph
+	Mat pots = random::U(Size(nStates, nNodes), CV_32FC1, 0.01, 1.0);
+	graphExt.addGaussianEdgeModel(Vec2f::all(3.0f), 1.5f);
+	graphExt.addGaussianEdgeModel(Vec2f(1.0f, 2.0f), 0.5f, [](const Mat &src, Mat &dst) {
+		for (int x = 0; x < src.cols; x++) dst.at<float>(0, x) = 2 * src.at<float>(0, x);
+	});
+
+	// Reference: the separate passes of the normalization, exponentiation and multiplication
+	Mat ref = pots.clone();
+	Mat temp, tmp;
+	for (unsigned int i = 0; i < nIt; i++) {
+		for (int n = 0; n < nNodes; n++) {
+			float *pRef = ref.ptr<float>(n);
+			float sum = 0;
+			for (byte s = 0; s < nStates; s++) sum += pRef[s];
+			for (byte s = 0; s < nStates; s++) pRef[s] /= sum;
+		}
+		temp = Mat(ref.size(), CV_32FC1, Scalar(1));
+		for (auto &edgeModel : graph.getEdgeModels()) {
+			edgeModel->apply(ref, tmp);
+			multiply(temp, tmp, temp);
+		}
+		multiply(pots, temp, ref);
+	}
+
+	CInferDense inferer(graph);
+	for (int t = 0; t < 2; t++) {									// the second run re-uses the work buffers
+		pots.copyTo(nodePots);
+		inferer.infer(nIt);
+		ASSERT_EQ(nIt, inferer.getNumIterations());
+
+		for (int n = 0; n < nNodes; n++) {
+			const float *pRes = nodePots.ptr<float>(n);
+			const float *pRef = ref.ptr<float>(n);
+			float sumRes = 0, sumRef = 0;
+			for (byte s = 0; s < nStates; s++) {
+				sumRes += pRes[s];
+				sumRef += pRef[s];
+			}
+			for (byte s = 0; s < nStates; s++) ASSERT_NEAR(pRes[s] / sumRes, pRef[s] / sumRef, 1e-4);
+		}
+	}
+
+	// Convergence
+	pots.copyTo(nodePots);
+	inferer.setTolerance(1e-3f);
+	inferer.infer(100);
+	ASSERT_LT(inferer.getNumIterations(), 100u);
+}
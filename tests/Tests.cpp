@@ -1,5 +1,7 @@
 #include "Tests.h"
 #include "DGM/parallel.h"
+#include "DGM/kernels.h"
+#include "DGM/MaxFlow.h"
 #include "DGM/random.h"
 
 using namespace DirectGraphicalModels;
@@ -24,3 +26,256 @@ TEST_F(CTests, parallel_gemm)
 #endif
 }
 
+
+TEST_F(CTests, parallel_for)
+{
+	const int size = random::u<int>(1000, 100000);
+	std::vector<int> v(size, 0);
+
+	parallel::parallel_for(0, size, [&](int i) { v[i] += i; });
+	for (int i = 0; i < size; i++) ASSERT_EQ(v[i], i);
+
+	// nested regions
+	Mat m(random::u<int>(10, 100), random::u<int>(10, 100), CV_32SC1, Scalar(0));
+	parallel::parallel_for(0, m.rows, [&](int y) {
+		int *pM = m.ptr<int>(y);
+		parallel::parallel_for(0, m.cols, [&](int x) { pM[x] = y * m.cols + x; });
+	});
+	for (int y = 0; y < m.rows; y++)
+		for (int x = 0; x < m.cols; x++)
+			ASSERT_EQ(m.at<int>(y, x), y * m.cols + x);
+
+	// exceptions are passed to the calling thread
+	const int thrower = random::u<int>(0, size - 1);
+	ASSERT_THROW(parallel::parallel_for(0, size, [thrower](int i) { if (i == thrower) throw std::runtime_error("parallel_for"); }), std::runtime_error);
+	std::atomic<int> count(0);
+	parallel::parallel_for(0, size, [&count](int) { count++; });
+	ASSERT_EQ(size, count.load());
+}
+
+TEST_F(CTests, message_kernels)
+{
+	// The vector kernels must give exactly the same results as the scalar loops
+	for (byte nStates = 1; nStates <= 40; nStates++) {
+		Mat M = random::U(Size(nStates, nStates), CV_32FC1, 0.0, 1.0);
+		Mat v = random::U(Size(nStates, 1), CV_32FC1, 0.0, 1.0);
+		const float *pM = M.ptr<float>();
+		const float *pv = v.ptr<float>();
+
+		for (bool maxSum : { false, true }) {
+			vec_float_t res(nStates, 0.0f), ref(nStates, 0.0f);
+			kernels::matMulSq(pM, nStates, pv, res.data(), maxSum);
+			for (byte y = 0; y < nStates; y++)
+				for (byte x = 0; x < nStates; x++) {
+					float prod = pv[y] * pM[y * nStates + x] * pM[y * nStates + x];
+					ref[x] = maxSum ? MAX(ref[x], prod) : ref[x] + prod;
+				}
+			ASSERT_EQ(res, ref);
+		}
+
+		vec_float_t res(nStates, -1.0f), ref(nStates, -1.0f);
+		kernels::logMatMulSqMax(pM, nStates, pv, res.data());
+		for (byte y = 0; y < nStates; y++)
+			for (byte x = 0; x < nStates; x++)
+				ref[x] = MAX(ref[x], pv[y] + 2 * pM[y * nStates + x]);
+		ASSERT_EQ(res, ref);
+
+		float maxProd = pv[0] * pM[0], maxSum = pv[0] + pM[0];
+		for (byte x = 1; x < nStates; x++) {
+			maxProd = MAX(maxProd, pv[x] * pM[x]);
+			maxSum  = MAX(maxSum,  pv[x] + pM[x]);
+		}
+		ASSERT_EQ(kernels::maxProd(pv, pM, nStates), maxProd);
+		ASSERT_EQ(kernels::maxSum(pv, pM, nStates), maxSum);
+	} // nStates
+}
+
+TEST_F(CTests, message_kernels_structured)
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	for (byte nStates = 3; nStates <= 40; nStates++) {
+		// Potts matrix: equal off-diagonal elements in each row
+		Mat M(nStates, nStates, CV_32FC1);
+		for (byte y = 0; y < nStates; y++) {
+			M.row(y).setTo(random::U<float>(0.1f, 1.0f));
+			M.at<float>(y, y) = random::U<float>(0.1f, 2.0f);
+		}
+		Mat L;
+		log(M, L);
+		Mat v = random::U(Size(nStates, 1), CV_32FC1, 0.0, 1.0);
+		const float *pM = M.ptr<float>();
+		const float *pL = L.ptr<float>();
+		const float *pv = v.ptr<float>();
+
+		for (bool maxSum : { false, true }) {
+			vec_float_t res(nStates), ref(nStates, 0.0f);
+			kernels::pottsMatMulSq(pM, nStates, pv, res.data(), maxSum);
+			kernels::matMulSq(pM, nStates, pv, ref.data(), maxSum);
+			for (byte x = 0; x < nStates; x++) ASSERT_NEAR(res[x], ref[x], 1e-5 * ref[x]);
+
+			kernels::logPottsMatMulSq(pL, nStates, pv, res.data(), maxSum);
+			for (byte x = 0; x < nStates; x++) {
+				float val = 0;
+				for (byte y = 0; y < nStates; y++) {
+					float prod = expf(pv[y] + 2 * pL[y * nStates + x]);
+					val = maxSum ? MAX(val, prod) : val + prod;
+				}
+				ASSERT_NEAR(res[x], logf(val), 1e-5);
+			}
+		}
+
+		vec_float_t res(nStates);
+		kernels::pottsMaxProd(pM, nStates, pv, res.data(), false);
+		for (byte y = 0; y < nStates; y++) ASSERT_EQ(res[y], kernels::maxProd(pv, pM + y * nStates, nStates));
+		kernels::pottsMaxProd(pL, nStates, pv, res.data(), true);
+		for (byte y = 0; y < nStates; y++) ASSERT_EQ(res[y], kernels::maxSum(pv, pL + y * nStates, nStates));
+
+		// Distance transform
+		vec_float_t f(nStates);
+		for (byte s = 0; s < nStates; s++) f[s] = random::u(0, 3) ? random::U<float>(0.0f, 10.0f) : inf;
+		for (bool quadratic : { false, true }) {
+			const float lambda = random::U<float>(0.0f, 2.0f);
+			const float tau = random::u(0, 1) ? random::U<float>(0.0f, 5.0f) : inf;
+			kernels::minConvolution(f.data(), nStates, res.data(), quadratic, lambda, tau);
+			for (int x = 0; x < nStates; x++) {
+				float ref = inf;
+				for (int y = 0; y < nStates; y++) {
+					float d = static_cast<float>(quadratic ? (x - y) * (x - y) : std::abs(x - y));
+					ref = MIN(ref, f[y] + MIN(lambda * d, tau));
+				}
+				if (ref == inf) ASSERT_EQ(res[x], inf);
+				else ASSERT_NEAR(res[x], ref, 1e-4 * MAX(1.0f, ref));
+			}
+		}
+	} // nStates
+}
+
+TEST_F(CTests, dense_kernels)
+{
+	for (int n : { 1, 3, 4, 8, 21, 64 }) {
+		Mat v = random::U(Size(n, 1), CV_32FC1, -80.0, 80.0);
+		Mat u = random::U(Size(n, 1), CV_32FC1, 0.0, 1.0);
+		const float a = random::U<float>(0.0f, 1.0f);
+		const float *pv = v.ptr<float>();
+		const float *pu = u.ptr<float>();
+
+		vec_float_t res(n);
+		kernels::mulExp(a, pv, pu, res.data(), n);
+		for (int x = 0; x < n; x++) {
+			float ref = static_cast<float>(pu[x] * exp(static_cast<double>(a * pv[x])));
+			ASSERT_NEAR(res[x], ref, 1e-6 * ref);
+		}
+
+		// In-place
+		vec_float_t dst(pu, pu + n);
+		kernels::mulExp(a, pv, dst.data(), dst.data(), n);
+		for (int x = 0; x < n; x++) ASSERT_EQ(res[x], dst[x]);
+
+		kernels::normalize(pu, res.data(), n);
+		float sum = 0;
+		for (int x = 0; x < n; x++) sum += res[x];
+		ASSERT_NEAR(sum, 1.0f, 1e-5);
+		for (int x = 1; x < n; x++) ASSERT_NEAR(res[x] * pu[0], res[0] * pu[x], 1e-6);
+	}
+}
+
+TEST_F(CTests, max_flow)
+{
+	CMaxFlow maxFlow;
+	for (int t = 0; t < 20; t++) {
+		const size_t nNodes = random::u<size_t>(2, 10);
+		vec_float_t vSource(nNodes), vSink(nNodes);
+		std::vector<std::tuple<size_t, size_t, float, float>> vEdges;
+
+		maxFlow.reset(nNodes);
+		for (size_t n = 0; n < nNodes; n++) {
+			vSource[n] = random::u<int>(0, 1) ? random::U<float>(0.0f, 10.0f) : 0.0f;
+			vSink[n]   = random::u<int>(0, 1) ? random::U<float>(0.0f, 10.0f) : 0.0f;
+			maxFlow.addTWeights(n, vSource[n], vSink[n]);
+		}
+		for (size_t n1 = 0; n1 < nNodes; n1++)
+			for (size_t n2 = n1 + 1; n2 < nNodes; n2++)
+				if (random::u<int>(0, 2) == 0) {
+					vEdges.emplace_back(n1, n2, random::U<float>(0.0f, 10.0f), random::U<float>(0.0f, 10.0f));
+					maxFlow.addEdge(n1, n2, std::get<2>(vEdges.back()), std::get<3>(vEdges.back()));
+				}
+		const float flow = maxFlow.maxFlow();
+
+		// Capacity of a cut, given by the nodes in the sink segment
+		auto getCut = [&](auto isSink) {
+			float res = 0;
+			for (size_t n = 0; n < nNodes; n++) res += isSink(n) ? vSource[n] : vSink[n];
+			for (const auto &[n1, n2, cap, revCap] : vEdges) {
+				if (!isSink(n1) && isSink(n2)) res += cap;
+				if (isSink(n1) && !isSink(n2)) res += revCap;
+			}
+			return res;
+		};
+
+		// Minimal cut with an exhaustive search
+		float minCut = std::numeric_limits<float>::max();
+		for (size_t mask = 0; mask < (size_t(1) << nNodes); mask++)
+			minCut = MIN(minCut, getCut([mask](size_t n) { return (mask >> n) & 1; }));
+
+		ASSERT_NEAR(flow, minCut, 1e-3f);
+		ASSERT_NEAR(getCut([&maxFlow](size_t n) { return maxFlow.isSink(n); }), minCut, 1e-3f);
+	}
+}
+
+TEST_F(CTests, max_flow_reuse)
+{
+	CMaxFlow maxFlow;
+	for (int t = 0; t < 20; t++) {
+		const size_t nNodes = random::u<size_t>(2, 10);
+		vec_float_t vSource(nNodes), vSink(nNodes);
+		std::vector<std::tuple<size_t, size_t, float, float>> vEdges;
+
+		maxFlow.reset(nNodes);
+		for (size_t n = 0; n < nNodes; n++) {
+			vSource[n] = random::U<float>(0.0f, 10.0f);
+			vSink[n]   = random::U<float>(0.0f, 10.0f);
+			maxFlow.addTWeights(n, vSource[n], vSink[n]);
+		}
+		for (size_t n1 = 0; n1 < nNodes; n1++)
+			for (size_t n2 = n1 + 1; n2 < nNodes; n2++)
+				if (random::u<int>(0, 2) == 0) {
+					vEdges.emplace_back(n1, n2, random::U<float>(0.0f, 10.0f), random::U<float>(0.0f, 10.0f));
+					maxFlow.addEdge(n1, n2, std::get<2>(vEdges.back()), std::get<3>(vEdges.back()));
+				}
+		maxFlow.maxFlow();
+
+		auto getCut = [&](auto isSink) {
+			float res = 0;
+			for (size_t n = 0; n < nNodes; n++) res += isSink(n) ? vSource[n] : vSink[n];
+			for (const auto &[n1, n2, cap, revCap] : vEdges) {
+				if (!isSink(n1) && isSink(n2)) res += cap;
+				if (isSink(n1) && !isSink(n2)) res += revCap;
+			}
+			return res;
+		};
+
+		// Changing some of the capacities and re-using the previous flow
+		for (int k = 0; k < 5; k++) {
+			for (size_t n = 0; n < nNodes; n++)
+				if (random::u<int>(0, 2) == 0) {
+					vSource[n] = random::u<int>(0, 1) ? random::U<float>(0.0f, 10.0f) : 0.0f;
+					vSink[n]   = random::u<int>(0, 1) ? random::U<float>(0.0f, 10.0f) : 0.0f;
+					maxFlow.setTWeights(n, vSource[n], vSink[n]);
+				}
+			for (size_t e = 0; e < vEdges.size(); e++)
+				if (random::u<int>(0, 2) == 0) {
+					std::get<2>(vEdges[e]) = random::u<int>(0, 1) ? random::U<float>(0.0f, 10.0f) : 0.0f;
+					std::get<3>(vEdges[e]) = random::u<int>(0, 1) ? random::U<float>(0.0f, 10.0f) : 0.0f;
+					maxFlow.setEdge(e, std::get<2>(vEdges[e]), std::get<3>(vEdges[e]));
+				}
+			const float flow = maxFlow.maxFlow(true);
+
+			float minCut = std::numeric_limits<float>::max();
+			for (size_t mask = 0; mask < (size_t(1) << nNodes); mask++)
+				minCut = MIN(minCut, getCut([mask](size_t n) { return (mask >> n) & 1; }));
+
+			ASSERT_NEAR(flow, minCut, 1e-3f);
+			ASSERT_NEAR(getCut([&maxFlow](size_t n) { return maxFlow.isSink(n); }), minCut, 1e-3f);
+		}
+	}
+}